@@ -0,0 +1,208 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <components/profiling/frameprofiler.hpp>
+
+namespace
+{
+    /// Peak resident set size in kilobytes (0: unknown)
+    long getPeakMemory()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        rusage usage;
+
+        if (getrusage (RUSAGE_SELF, &usage)==0)
+#if defined(__APPLE__)
+            return usage.ru_maxrss / 1024; // bytes
+#else
+            return usage.ru_maxrss;
+#endif
+#endif
+        return 0;
+    }
+
+    /// \param samples sorted
+    float getPercentile (const std::vector<float>& samples, int percent)
+    {
+        std::size_t index = (samples.size()*percent + 99) / 100;
+
+        if (index>0)
+            --index;
+
+        return samples[std::min (index, samples.size()-1)];
+    }
+
+    void writeRow (std::ostream& stream, const std::string& name, std::vector<float> samples)
+    {
+        if (samples.empty())
+            return;
+
+        std::sort (samples.begin(), samples.end());
+
+        stream
+            << std::setw (12) << std::left << name << std::right
+            << std::setw (10) << getPercentile (samples, 50)
+            << std::setw (10) << getPercentile (samples, 90)
+            << std::setw (10) << getPercentile (samples, 99)
+            << std::setw (10) << samples.back()
+            << std::endl;
+    }
+}
+
+OMW::Benchmark::Benchmark (const std::string& file)
+: mTimeStep (1.0f/60), mLastFrame (0)
+{
+    std::ifstream stream (file.c_str());
+
+    if (!stream.is_open())
+        throw std::runtime_error ("failed to open benchmark scenario " + file);
+
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline (stream, line))
+    {
+        ++lineNumber;
+
+        std::string::size_type comment = line.find ('#');
+        if (comment!=std::string::npos)
+            line.erase (comment);
+
+        std::istringstream lineStream (line);
+
+        std::string command;
+        if (!(lineStream >> command))
+            continue;
+
+        Step step;
+        step.mPos[0] = step.mPos[1] = step.mPos[2] = 0;
+        step.mFrames = 0;
+
+        bool valid = true;
+
+        if (command=="timestep")
+        {
+            lineStream >> mTimeStep;
+            valid = !lineStream.fail() && mTimeStep>0;
+
+            if (valid)
+                continue;
+        }
+        else if (command=="exterior" || command=="move")
+        {
+            step.mType = command=="move" ? Step::Type_Move : Step::Type_Exterior;
+            lineStream >> step.mPos[0] >> step.mPos[1] >> step.mPos[2] >> step.mFrames;
+            valid = !lineStream.fail();
+        }
+        else if (command=="interior")
+        {
+            step.mType = Step::Type_Interior;
+            lineStream >> step.mFrames >> std::ws;
+            std::getline (lineStream, step.mCell);
+            valid = !lineStream.fail();
+
+            while (valid && !step.mCell.empty() && std::isspace (
+                static_cast<unsigned char> (step.mCell[step.mCell.size()-1])))
+                step.mCell.erase (step.mCell.size()-1);
+
+            valid = valid && !step.mCell.empty();
+        }
+        else if (command=="wait")
+        {
+            step.mType = Step::Type_Wait;
+            lineStream >> step.mFrames;
+            valid = !lineStream.fail();
+        }
+        else
+            valid = false;
+
+        if (!valid || step.mFrames<0)
+        {
+            std::ostringstream error;
+            error << "invalid command in benchmark scenario " << file << ", line " << lineNumber;
+            throw std::runtime_error (error.str());
+        }
+
+        mSteps.push_back (step);
+    }
+
+    if (mSteps.empty())
+        throw std::runtime_error ("empty benchmark scenario " + file);
+}
+
+float OMW::Benchmark::getTimeStep() const
+{
+    return mTimeStep;
+}
+
+const std::vector<OMW::Benchmark::Step>& OMW::Benchmark::getSteps() const
+{
+    return mSteps;
+}
+
+int OMW::Benchmark::getFrameCount() const
+{
+    int frames = 0;
+
+    for (std::vector<Step>::const_iterator iter (mSteps.begin()); iter!=mSteps.end(); ++iter)
+        frames += iter->mFrames;
+
+    return frames;
+}
+
+void OMW::Benchmark::addFrame (const Profiling::FrameProfiler& profiler)
+{
+    if (profiler.getFrameCount()==0 || profiler.getFrameNumber()==mLastFrame)
+        return;
+
+    mLastFrame = profiler.getFrameNumber();
+
+    const Profiling::FrameProfiler::Frame& frame = profiler.getFrame (0);
+
+    int phases = profiler.getPhaseCount();
+
+    if (static_cast<int> (mSamples.size())<phases+1)
+        mSamples.resize (phases+1);
+
+    mSamples[0].push_back (frame.mDuration / 1000.0f);
+
+    for (int i=0; i<phases; ++i)
+        mSamples[i+1].push_back (frame.mPhases[i] / 1000.0f);
+}
+
+void OMW::Benchmark::report (std::ostream& stream, const Profiling::FrameProfiler& profiler) const
+{
+    std::size_t frames = mSamples.empty() ? 0 : mSamples[0].size();
+
+    stream
+        << "Benchmark: " << frames << " frames, time step " << mTimeStep << " s" << std::endl
+        << std::fixed << std::setprecision (2)
+        << std::setw (12) << std::left << "phase (ms)" << std::right
+        << std::setw (10) << "p50"
+        << std::setw (10) << "p90"
+        << std::setw (10) << "p99"
+        << std::setw (10) << "max"
+        << std::endl;
+
+    for (std::size_t i=1; i<mSamples.size(); ++i)
+        writeRow (stream, profiler.getPhaseName (static_cast<int> (i-1)), mSamples[i]);
+
+    if (frames)
+        writeRow (stream, "Frame", mSamples[0]);
+
+    if (long memory = getPeakMemory())
+        stream << "Peak memory: " << memory/1024 << " MiB" << std::endl;
+    else
+        stream << "Peak memory: unknown" << std::endl;
+}
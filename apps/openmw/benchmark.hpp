@@ -0,0 +1,73 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Profiling
+{
+    class FrameProfiler;
+}
+
+namespace OMW
+{
+    /// \brief Scripted camera path for the --benchmark mode
+    ///
+    /// A scenario is a text file with one command per line (# starts a comment):
+    /// - timestep \<seconds\>: fixed duration of every frame (default: 1/60)
+    /// - exterior \<x\> \<y\> \<z\> \<frames\>: teleport to an exterior position, then run frames
+    /// - interior \<frames\> \<cell name\>: teleport into an interior cell, then run frames
+    /// - move \<x\> \<y\> \<z\> \<frames\>: move in a straight line to an exterior position,
+    ///   one step per frame (crossing cell borders like a walking player)
+    /// - wait \<frames\>: run frames without moving
+    class Benchmark
+    {
+        public:
+
+            struct Step
+            {
+                enum Type
+                {
+                    Type_Exterior,
+                    Type_Interior,
+                    Type_Move,
+                    Type_Wait
+                };
+
+                Type mType;
+                float mPos[3];
+                std::string mCell;
+                int mFrames;
+            };
+
+        private:
+
+            std::vector<Step> mSteps;
+            float mTimeStep;
+            std::vector<std::vector<float> > mSamples; // milliseconds, per phase + frame total
+            unsigned int mLastFrame;
+
+        public:
+
+            Benchmark (const std::string& file);
+            ///< Load scenario from \a file.
+            /// \note Throws an exception, if the file can not be read or contains an error.
+
+            float getTimeStep() const;
+
+            const std::vector<Step>& getSteps() const;
+
+            int getFrameCount() const;
+            ///< Total number of frames of the scenario.
+
+            void addFrame (const Profiling::FrameProfiler& profiler);
+            ///< Record the most recently finished frame of \a profiler (call once per rendered
+            /// frame).
+
+            void report (std::ostream& stream, const Profiling::FrameProfiler& profiler) const;
+            ///< Write percentiles of the recorded phase timings and the peak memory usage.
+    };
+}
+
+#endif
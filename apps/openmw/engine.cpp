@@ -1,5 +1,9 @@
 #include "engine.hpp"
 
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
 
 #include <OgreRoot.h>
@@ -20,6 +24,8 @@
 
 #include <components/esm/loadcell.hpp>
 
+#include <components/misc/stringops.hpp>
+
 #include "mwinput/inputmanagerimp.hpp"
 
 #include "mwgui/windowmanagerimp.hpp"
@@ -41,6 +47,8 @@
 
 #include "mwmechanics/mechanicsmanagerimp.hpp"
 
+#include "benchmark.hpp"
+
 
 #include <SDL.h>
 
@@ -52,11 +60,11 @@ void OMW::Engine::executeLocalScripts()
 
     while (!localScripts.isFinished())
     {
-        std::pair<std::string, MWWorld::Ptr> script = localScripts.getNext();
+        MWWorld::LocalScripts::Script script = localScripts.getNext();
 
         MWScript::InterpreterContext interpreterContext (
-            &script.second.getRefData().getLocals(), script.second);
-        MWBase::Environment::get().getScriptManager()->run (script.first, interpreterContext);
+            &script.mPtr.getRefData().getLocals(), script.mPtr);
+        MWBase::Environment::get().getScriptManager()->run (script.mHandle, interpreterContext);
 
         if (MWBase::Environment::get().getWorld()->hasCellChanged())
             break;
@@ -71,6 +79,10 @@ void OMW::Engine::setAnimationVerbose(bool animverbose)
 
 bool OMW::Engine::frameStarted (const Ogre::FrameEvent& evt)
 {
+    mFrameProfiler.beginFrame();
+    static Profiling::Phase phase ("Start");
+    Profiling::ScopedTimer timer (&mFrameProfiler, phase);
+
     bool paused = MWBase::Environment::get().getWindowManager()->isGuiMode();
     MWBase::Environment::get().getWorld()->frameStarted(evt.timeSinceLastFrame, paused);
     MWBase::Environment::get().getWindowManager ()->frameStarted(evt.timeSinceLastFrame);
@@ -86,21 +98,36 @@ bool OMW::Engine::frameRenderingQueued (const Ogre::FrameEvent& evt)
         mEnvironment.setFrameDuration (frametime);
 
         // update input
-        MWBase::Environment::get().getInputManager()->update(frametime, false);
+        {
+            static Profiling::Phase phase ("Input");
+            Profiling::ScopedTimer timer (&mFrameProfiler, phase);
+            MWBase::Environment::get().getInputManager()->update(frametime, false);
+        }
 
         // sound
         if (mUseSound)
+        {
+            static Profiling::Phase phase ("Sound");
+            Profiling::ScopedTimer timer (&mFrameProfiler, phase);
             MWBase::Environment::get().getSoundManager()->update(frametime);
+        }
 
-        // global scripts
-        MWBase::Environment::get().getScriptManager()->getGlobalScripts().run();
+        bool changed;
 
-        bool changed = MWBase::Environment::get().getWorld()->hasCellChanged();
+        {
+            static Profiling::Phase phase ("Scripts");
+            Profiling::ScopedTimer timer (&mFrameProfiler, phase);
+
+            // global scripts
+            MWBase::Environment::get().getScriptManager()->getGlobalScripts().run();
+
+            changed = MWBase::Environment::get().getWorld()->hasCellChanged();
 
-        // local scripts
-        executeLocalScripts(); // This does not handle the case where a global script causes a cell
-                               // change, followed by a cell change in a local script during the same
-                               // frame.
+            // local scripts
+            executeLocalScripts(); // This does not handle the case where a global script causes a cell
+                                   // change, followed by a cell change in a local script during the same
+                                   // frame.
+        }
 
         // passing of time
         if (!MWBase::Environment::get().getWindowManager()->isGuiMode())
@@ -112,13 +139,23 @@ bool OMW::Engine::frameRenderingQueued (const Ogre::FrameEvent& evt)
             MWBase::Environment::get().getWorld()->markCellAsUnchanged();
 
         // update actors
-        MWBase::Environment::get().getMechanicsManager()->update(frametime,
-            MWBase::Environment::get().getWindowManager()->isGuiMode());
+        {
+            static Profiling::Phase phase ("Mechanics");
+            Profiling::ScopedTimer timer (&mFrameProfiler, phase);
+            MWBase::Environment::get().getMechanicsManager()->update(frametime,
+                MWBase::Environment::get().getWindowManager()->isGuiMode());
+        }
 
         // update world
-        MWBase::Environment::get().getWorld()->update(frametime, MWBase::Environment::get().getWindowManager()->isGuiMode());
+        {
+            static Profiling::Phase phase ("World");
+            Profiling::ScopedTimer timer (&mFrameProfiler, phase);
+            MWBase::Environment::get().getWorld()->update(frametime, MWBase::Environment::get().getWindowManager()->isGuiMode());
+        }
 
         // update GUI
+        static Profiling::Phase phase ("GUI");
+        Profiling::ScopedTimer timer (&mFrameProfiler, phase);
         Ogre::RenderWindow* window = mOgre->getWindow();
         unsigned int tri, batch;
         MWBase::Environment::get().getWorld()->getTriangleBatchCount(tri, batch);
@@ -139,6 +176,8 @@ OMW::Engine::Engine(Files::ConfigurationManager& configurationManager)
   : mOgre (0)
   , mFpsLevel(0)
   , mVerboseScripts (false)
+  , mOptimizeScripts (true)
+  , mPrecompileScripts (true)
   , mNewGame (false)
   , mUseSound (true)
   , mCompileAll (false)
@@ -155,6 +194,13 @@ OMW::Engine::Engine(Files::ConfigurationManager& configurationManager)
     std::srand ( std::time(NULL) );
     MWClass::registerClasses();
 
+    // fixed order of the phases in the frame timing display
+    const char *phases[] = { "Start", "Input", "Sound", "Scripts", "Mechanics", "World", "Physics", "GUI" };
+    for (std::size_t i=0; i<sizeof (phases)/sizeof (phases[0]); ++i)
+        mFrameProfiler.getPhase (phases[i]);
+
+    mEnvironment.setFrameProfiler (&mFrameProfiler);
+
     Uint32 flags = SDL_INIT_VIDEO|SDL_INIT_NOPARACHUTE;
     if(SDL_WasInit(flags) == 0)
     {
@@ -281,6 +327,126 @@ void OMW::Engine::setScriptsVerbosity(bool scriptsVerbosity)
     mVerboseScripts = scriptsVerbosity;
 }
 
+void OMW::Engine::setScriptsOptimization(bool optimize)
+{
+    mOptimizeScripts = optimize;
+}
+
+void OMW::Engine::setScriptsPrecompilation(bool precompile)
+{
+    mPrecompileScripts = precompile;
+}
+
+void OMW::Engine::setScriptsProfiling(const std::string& file)
+{
+    mScriptProfileFile = file;
+}
+
+void OMW::Engine::writeScriptProfile()
+{
+    std::string file = mScriptProfileFile;
+
+    if (file.empty())
+        file = (mCfgMgr.getLogPath() / "scriptprofile.csv").string();
+
+    bool json = file.size()>=5 && Misc::StringUtils::lowerCase (file.substr (file.size()-5))==".json";
+
+    std::ostringstream profile;
+
+    if (!MWBase::Environment::get().getScriptManager()->writeProfile (profile,
+        json ? MWBase::ScriptManager::Profile_Json : MWBase::ScriptManager::Profile_Csv))
+        return;
+
+    std::ofstream stream (file.c_str());
+    stream << profile.str();
+
+    if (stream)
+        std::cout << "Script profile written to " << file << std::endl;
+    else
+        std::cerr << "Failed to write script profile " << file << std::endl;
+}
+
+void OMW::Engine::setFrameTrace(const std::string& file)
+{
+    mFrameTraceFile = file;
+}
+
+void OMW::Engine::setBenchmark(const std::string& file)
+{
+    mBenchmarkFile = file;
+}
+
+void OMW::Engine::setRenderSystem(const std::string& name)
+{
+    mRenderSystem = name;
+}
+
+void OMW::Engine::runBenchmark (Benchmark& benchmark)
+{
+    mFrameProfiler.setEnabled (true);
+
+    MWBase::World *world = MWBase::Environment::get().getWorld();
+
+    const std::vector<Benchmark::Step>& steps = benchmark.getSteps();
+
+    for (std::vector<Benchmark::Step>::const_iterator iter (steps.begin());
+        iter!=steps.end() && !mEnvironment.getRequestExit(); ++iter)
+    {
+        ESM::Position pos;
+        pos.pos[0] = iter->mPos[0];
+        pos.pos[1] = iter->mPos[1];
+        pos.pos[2] = iter->mPos[2];
+        pos.rot[0] = pos.rot[1] = pos.rot[2] = 0;
+
+        ESM::Position start;
+
+        switch (iter->mType)
+        {
+            case Benchmark::Step::Type_Exterior:
+
+                world->changeToExteriorCell (pos);
+                break;
+
+            case Benchmark::Step::Type_Interior:
+
+                world->findInteriorPosition (iter->mCell, pos);
+                world->changeToInteriorCell (iter->mCell, pos);
+                break;
+
+            case Benchmark::Step::Type_Move:
+
+                start = world->getPlayer().getPlayer().getRefData().getPosition();
+                break;
+
+            case Benchmark::Step::Type_Wait:
+
+                break;
+        }
+
+        for (int i=0; i<iter->mFrames && !mEnvironment.getRequestExit(); ++i)
+        {
+            if (iter->mType==Benchmark::Step::Type_Move)
+            {
+                float factor = static_cast<float> (i+1) / iter->mFrames;
+
+                world->moveObject (world->getPlayer().getPlayer(),
+                    start.pos[0] + (pos.pos[0]-start.pos[0]) * factor,
+                    start.pos[1] + (pos.pos[1]-start.pos[1]) * factor,
+                    start.pos[2] + (pos.pos[2]-start.pos[2]) * factor);
+            }
+
+            Ogre::Root::getSingleton().renderOneFrame (benchmark.getTimeStep());
+            benchmark.addFrame (mFrameProfiler);
+        }
+    }
+
+    // finish the last frame
+    mFrameProfiler.beginFrame();
+    benchmark.addFrame (mFrameProfiler);
+
+    benchmark.report (std::cout, mFrameProfiler);
+}
+
 void OMW::Engine::setNewGame(bool newGame)
 {
     mNewGame = newGame;
@@ -327,7 +493,8 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
 {
     Nif::NIFFile::CacheLock cachelock;
 
-    std::string renderSystem = settings.getString("render system", "Video");
+    std::string renderSystem = mRenderSystem.empty() ?
+        settings.getString("render system", "Video") : mRenderSystem;
     if (renderSystem == "")
     {
 #if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
@@ -412,7 +579,11 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     mScriptContext->setExtensions (&mExtensions);
 
     mEnvironment.setScriptManager (new MWScript::ScriptManager (MWBase::Environment::get().getWorld()->getStore(),
-        mVerboseScripts, *mScriptContext));
+        mVerboseScripts, mOptimizeScripts, *mScriptContext,
+        (mCfgMgr.getCachePath() / "scripts.cache").string()));
+
+    if (!mScriptProfileFile.empty())
+        mEnvironment.getScriptManager()->setProfiling (true);
 
     // Create game mechanics system
     MWMechanics::MechanicsManager* mechanics = new MWMechanics::MechanicsManager;
@@ -426,6 +597,19 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     mechanics->buildPlayer();
     window->updatePlayer();
 
+    // scripts
+    if (mCompileAll || mPrecompileScripts)
+    {
+        std::pair<int, int> result = MWBase::Environment::get().getScriptManager()->compileAll();
+
+        if (mCompileAll && result.first)
+            std::cout
+                << "compiled " << result.second << " of " << result.first << " scripts ("
+                << 100*static_cast<double> (result.second)/result.first
+                << "%)"
+                << std::endl;
+    }
+
     if (!mNewGame)
     {
         // load cell
@@ -448,19 +632,6 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     event.timeSinceLastFrame = 0;
     frameRenderingQueued(event);
     mOgre->getRoot()->addFrameListener (this);
-
-    // scripts
-    if (mCompileAll)
-    {
-        std::pair<int, int> result = MWBase::Environment::get().getScriptManager()->compileAll();
-
-        if (result.first)
-            std::cout
-                << "compiled " << result.second << " of " << result.first << " scripts ("
-                << 100*static_cast<double> (result.second)/result.first
-                << "%)"
-                << std::endl;
-    }
 }
 
 // Initialise and enter main loop.
@@ -480,6 +651,16 @@ void OMW::Engine::go()
     ToUTF8::Utf8Encoder encoder (mEncoding);
     mEncoder = &encoder;
 
+    // Load the scenario before the (slow) startup, so that errors are reported right away
+    std::auto_ptr<Benchmark> benchmark;
+    if (!mBenchmarkFile.empty())
+    {
+        benchmark.reset (new Benchmark (mBenchmarkFile));
+
+        // same random numbers in every run
+        std::srand (0);
+    }
+
     prepareEngine (settings);
 
     // Play some good 'ol tunes
@@ -488,9 +669,21 @@ void OMW::Engine::go()
     if (!mStartupScript.empty())
         MWBase::Environment::get().getWindowManager()->executeInConsole (mStartupScript);
 
-    // Start the main rendering loop
-    while (!mEnvironment.getRequestExit())
-        Ogre::Root::getSingleton().renderOneFrame();
+    if (!mFrameTraceFile.empty() && mFrameProfiler.startTrace (mFrameTraceFile))
+        std::cout << "Writing frame trace to " << mFrameTraceFile << std::endl;
+
+    if (benchmark.get())
+        runBenchmark (*benchmark);
+    else
+    {
+        // Start the main rendering loop
+        while (!mEnvironment.getRequestExit())
+            Ogre::Root::getSingleton().renderOneFrame();
+    }
+
+    mFrameProfiler.stopTrace();
+
+    writeScriptProfile();
 
     // Save user settings
     settings.saveUser(settingspath);
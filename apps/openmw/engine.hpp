@@ -7,6 +7,7 @@
 #include <components/files/collections.hpp>
 #include <components/translation/translation.hpp>
 #include <components/settings/settings.hpp>
+#include <components/profiling/frameprofiler.hpp>
 
 #include "mwbase/environment.hpp"
 
@@ -57,6 +58,8 @@ namespace Files
 
 namespace OMW
 {
+    class Benchmark;
+
     /// \brief Main engine class, that brings together all the components of OpenMW
     class Engine : private Ogre::FrameListener
     {
@@ -71,6 +74,13 @@ namespace OMW
             std::vector<std::string> mContentFiles;
             int mFpsLevel;
             bool mVerboseScripts;
+            bool mOptimizeScripts;
+            bool mPrecompileScripts;
+            std::string mScriptProfileFile;
+            Profiling::FrameProfiler mFrameProfiler;
+            std::string mFrameTraceFile;
+            std::string mBenchmarkFile;
+            std::string mRenderSystem;
             bool mNewGame;
             bool mUseSound;
             bool mCompileAll;
@@ -114,6 +124,9 @@ namespace OMW
             /// Prepare engine for game play
             void prepareEngine (Settings::Manager & settings);
 
+            /// Run the frames of a benchmark scenario (instead of the main loop)
+            void runBenchmark (Benchmark& benchmark);
+
         public:
             Engine(Files::ConfigurationManager& configurationManager);
             virtual ~Engine();
@@ -145,9 +158,34 @@ namespace OMW
             /// Enable fps counter
             void showFPS(int level);
 
+            /// Write the script profile, if any scripts have been profiled.
+            void writeScriptProfile();
+
             /// Enable or disable verbose script output
             void setScriptsVerbosity(bool scriptsVerbosity);
 
+            /// Enable or disable the bytecode optimizer for compiled scripts
+            void setScriptsOptimization(bool optimize);
+
+            /// Compile all scripts in parallel at startup (using the bytecode cache)?
+            void setScriptsPrecompilation(bool precompile);
+
+            /// Profile scripts from startup on and write the result to \a file on exit (.json for
+            /// JSON, CSV otherwise). Empty: profiling can still be toggled with ProfileScripts, the
+            /// result is then written to scriptprofile.csv in the log directory.
+            void setScriptsProfiling(const std::string& file);
+
+            /// Write the timing of all frames and of their phases to \a file (Chrome trace format).
+            void setFrameTrace(const std::string& file);
+
+            /// Run the benchmark scenario in \a file with a fixed time step, print the timing of
+            /// the frame phases and quit (see OMW::Benchmark).
+            void setBenchmark(const std::string& file);
+
+            /// Use the Ogre render system \a name instead of the one from the settings (empty:
+            /// use settings).
+            void setRenderSystem(const std::string& name);
+
             /// Disable or enable all sounds
             void setSoundUsage(bool soundUsage);
 
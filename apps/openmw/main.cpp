@@ -130,6 +130,24 @@ bool parseOptions (int argc, char** argv, OMW::Engine& engine, Files::Configurat
         ("script-verbose", bpo::value<bool>()->implicit_value(true)
             ->default_value(false), "verbose script output")
 
+        ("script-optimize", bpo::value<bool>()->implicit_value(true)
+            ->default_value(true), "optimize compiled script bytecode")
+
+        ("script-precompile", bpo::value<bool>()->implicit_value(true)
+            ->default_value(true), "compile all scripts in parallel at startup, reusing cached bytecode")
+
+        ("script-profile", bpo::value<std::string>()->default_value(""),
+            "profile scripts and write the result to the given file on exit (.json for JSON, CSV otherwise)")
+
+        ("frame-trace", bpo::value<std::string>()->default_value(""),
+            "write timings of all frames to the given file (Chrome trace format, see chrome://tracing)")
+
+        ("benchmark", bpo::value<std::string>()->default_value(""),
+            "run the given benchmark scenario with a fixed time step, print the frame timings and quit")
+
+        ("render-system", bpo::value<std::string>()->default_value(""),
+            "Ogre render system to use instead of the one from the settings (e.g. \"NULL Rendering Subsystem\" for benchmarks without a GPU)")
+
         ("script-all", bpo::value<bool>()->implicit_value(true)
             ->default_value(false), "compile all scripts (excluding dialogue scripts) at startup")
 
@@ -239,6 +257,12 @@ bool parseOptions (int argc, char** argv, OMW::Engine& engine, Files::Configurat
     // other settings
     engine.setSoundUsage(!variables["nosound"].as<bool>());
     engine.setScriptsVerbosity(variables["script-verbose"].as<bool>());
+    engine.setScriptsOptimization(variables["script-optimize"].as<bool>());
+    engine.setScriptsPrecompilation(variables["script-precompile"].as<bool>());
+    engine.setScriptsProfiling(variables["script-profile"].as<std::string>());
+    engine.setFrameTrace(variables["frame-trace"].as<std::string>());
+    engine.setBenchmark(variables["benchmark"].as<std::string>());
+    engine.setRenderSystem(variables["render-system"].as<std::string>());
     engine.setCompileAll(variables["script-all"].as<bool>());
     engine.setAnimationVerbose(variables["anim-verbose"].as<bool>());
     engine.setFallbackValues(variables["fallback"].as<FallbackMap>().mMap);
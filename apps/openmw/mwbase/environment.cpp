@@ -17,7 +17,8 @@ bool MWBase::Environment::sExit = false;
 
 MWBase::Environment::Environment()
 : mWorld (0), mSoundManager (0), mScriptManager (0), mWindowManager (0),
-  mMechanicsManager (0),  mDialogueManager (0), mJournal (0), mInputManager (0), mFrameDuration (0)
+  mMechanicsManager (0),  mDialogueManager (0), mJournal (0), mInputManager (0), mFrameDuration (0),
+  mFrameProfiler (0)
 {
     assert (!sThis);
     sThis = this;
@@ -74,6 +75,11 @@ void MWBase::Environment::setFrameDuration (float duration)
     mFrameDuration = duration;
 }
 
+void MWBase::Environment::setFrameProfiler (Profiling::FrameProfiler *profiler)
+{
+    mFrameProfiler = profiler;
+}
+
 MWBase::World *MWBase::Environment::getWorld() const
 {
     assert (mWorld);
@@ -127,6 +133,11 @@ float MWBase::Environment::getFrameDuration() const
     return mFrameDuration;
 }
 
+Profiling::FrameProfiler *MWBase::Environment::getFrameProfiler() const
+{
+    return mFrameProfiler;
+}
+
 void MWBase::Environment::cleanup()
 {
     delete mMechanicsManager;
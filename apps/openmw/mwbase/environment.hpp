@@ -1,6 +1,11 @@
 #ifndef GAME_BASE_INVIRONMENT_H
 #define GAME_BASE_INVIRONMENT_H
 
+namespace Profiling
+{
+    class FrameProfiler;
+}
+
 namespace MWBase
 {
     class World;
@@ -31,6 +36,7 @@ namespace MWBase
             Journal *mJournal;
             InputManager *mInputManager;
             float mFrameDuration;
+            Profiling::FrameProfiler *mFrameProfiler;
 
             static bool sExit;
 
@@ -68,6 +74,9 @@ namespace MWBase
             void setFrameDuration (float duration);
             ///< Set length of current frame in seconds.
 
+            void setFrameProfiler (Profiling::FrameProfiler *profiler);
+            ///< \note Unlike the managers, the profiler is not owned by the environment.
+
             World *getWorld() const;
 
             SoundManager *getSoundManager() const;
@@ -86,6 +95,9 @@ namespace MWBase
 
             float getFrameDuration() const;
 
+            Profiling::FrameProfiler *getFrameProfiler() const;
+            ///< May return 0.
+
             void cleanup();
             ///< Delete all mw*-subsystems.
 
@@ -1,6 +1,7 @@
 #ifndef GAME_MWBASE_SCRIPTMANAGER_H
 #define GAME_MWBASE_SCRIPTMANAGER_H
 
+#include <iosfwd>
 #include <string>
 
 namespace Interpreter
@@ -31,6 +32,13 @@ namespace MWBase
 
         public:
 
+            enum ProfileFormat
+            {
+                Profile_Summary, ///< most expensive scripts, human readable
+                Profile_Csv,
+                Profile_Json
+            };
+
             ScriptManager() {}
 
             virtual ~ScriptManager() {}
@@ -40,6 +48,14 @@ namespace MWBase
             virtual void run (const std::string& name, Interpreter::Context& interpreterContext) = 0;
             ///< Run the script with the given name (compile first, if not compiled yet)
 
+            virtual int getScriptHandle (const std::string& name) = 0;
+            ///< Return a handle for running the script with the given name repeatedly without a
+            /// name lookup. The script does not need to be compiled yet. Handles stay valid for the
+            /// lifetime of the script manager.
+
+            virtual void run (int handle, Interpreter::Context& interpreterContext) = 0;
+            ///< Run the script with the given handle (compile first, if not compiled yet)
+
             virtual bool compile (const std::string& name) = 0;
             ///< Compile script with the given namen
             /// \return Success?
@@ -58,6 +74,20 @@ namespace MWBase
             ///< Return index of the variable of the given name and type in the given script. Will
             /// throw an exception, if there is no such script or variable or the type does not match.
 
+            virtual char getLocalType (const std::string& scriptId, const std::string& variable,
+                int& index) = 0;
+            ///< Return type ('s', 'l', 'f') of the variable of the given name (case insensitive) in
+            /// the given script and store its index in \a index. Resolved variables are cached.
+            /// \return ' ', if there is no such script or variable.
+
+            virtual void setProfiling (bool enable) = 0;
+            ///< Collect call counts and execution times of scripts and counts of executed opcodes?
+
+            virtual bool isProfiling() const = 0;
+
+            virtual bool writeProfile (std::ostream& stream, ProfileFormat format) const = 0;
+            ///< Write the data collected while profiling was enabled.
+            /// \return Has any data been collected?
     };
 }
 
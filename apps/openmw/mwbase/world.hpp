@@ -146,6 +146,14 @@ namespace MWBase
             virtual char getGlobalVariableType (const std::string& name) const = 0;
             ///< Return ' ', if there is no global variable with this name.
 
+            virtual int getGlobalVariableSlot (const std::string& name) const = 0;
+            ///< Return -1, if there is no global variable with this name.
+
+            virtual MWWorld::Globals::Data getGlobalVariable (int slot) const = 0;
+
+            virtual void setGlobalVariable (int slot, float value) = 0;
+            ///< Set value independently from real type (time variables also update the game time).
+
             virtual std::vector<std::string> getGlobals () const = 0;
 
             virtual std::string getCurrentCellName() const = 0;
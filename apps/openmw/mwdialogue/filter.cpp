@@ -5,6 +5,7 @@
 #include "../mwbase/world.hpp"
 #include "../mwbase/journal.hpp"
 #include "../mwbase/mechanicsmanager.hpp"
+#include "../mwbase/scriptmanager.hpp"
 
 #include "../mwworld/class.hpp"
 #include "../mwworld/player.hpp"
@@ -179,33 +180,22 @@ bool MWDialogue::Filter::testSelectStructNumeric (const SelectWrapper& select) c
             if (scriptName.empty())
                 return false; // no script
 
-            const ESM::Script *script =
-                MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptName);
+            int index = 0;
+            char type = MWBase::Environment::get().getScriptManager()->getLocalType (
+                scriptName, select.getName(), index);
 
-            std::string name = select.getName();
-
-            int i = 0;
-
-            for (; i<static_cast<int> (script->mVarNames.size()); ++i)
-                if (Misc::StringUtils::lowerCase(script->mVarNames[i]) == name)
-                    break;
-
-            if (i>=static_cast<int> (script->mVarNames.size()))
+            if (type==' ')
                 return false; // script does not have a variable of this name
 
             const MWScript::Locals& locals = mActor.getRefData().getLocals();
 
-            if (i<script->mData.mNumShorts)
-                return select.selectCompare (static_cast<int> (locals.mShorts[i]));
-
-            i -= script->mData.mNumShorts;
-
-            if (i<script->mData.mNumLongs)
-                return select.selectCompare (locals.mLongs[i]);
+            if (type=='s')
+                return select.selectCompare (static_cast<int> (locals.mShorts.at (index)));
 
-            i -= script->mData.mNumLongs;
+            if (type=='l')
+                return select.selectCompare (locals.mLongs.at (index));
 
-            return select.selectCompare (locals.mFloats.at (i));
+            return select.selectCompare (locals.mFloats.at (index));
         }
 
         case SelectWrapper::Function_PcHealthPercent:
@@ -453,20 +443,11 @@ bool MWDialogue::Filter::getSelectStructBoolean (const SelectWrapper& select) co
                 // This actor has no attached script, so there is no local variable
                 return true;
 
-            const ESM::Script *script =
-                MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptName);
+            int index = 0;
 
-            std::string name = select.getName();
-
-            int i = 0;
-            for (; i < static_cast<int> (script->mVarNames.size()); ++i)
-                if (Misc::StringUtils::lowerCase(script->mVarNames[i]) == name)
-                    break;
-
-            if (i >= static_cast<int> (script->mVarNames.size()))
-                return true; // script does not have a variable of this name
-
-            return false;
+            // true, if script does not have a variable of this name
+            return MWBase::Environment::get().getScriptManager()->getLocalType (
+                scriptName, select.getName(), index)==' ';
         }
 
         case SelectWrapper::Function_SameGender:
@@ -1,7 +1,13 @@
 #include "hud.hpp"
 
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
 #include <boost/lexical_cast.hpp>
 
+#include <components/profiling/frameprofiler.hpp>
+
 #include "../mwbase/environment.hpp"
 #include "../mwbase/soundmanager.hpp"
 #include "../mwbase/windowmanager.hpp"
@@ -41,6 +47,7 @@ namespace MWGui
         , mFpsCounter(NULL)
         , mTriangleCounter(NULL)
         , mBatchCounter(NULL)
+        , mFrameTimings(NULL)
         , mHealthManaStaminaBaseLeft(0)
         , mWeapBoxBaseLeft(0)
         , mSpellBoxBaseLeft(0)
@@ -135,14 +142,27 @@ namespace MWGui
     void HUD::setFpsLevel(int level)
     {
         mFpsCounter = 0;
+        mFrameTimings = 0;
 
         MyGUI::Widget* fps;
         getWidget(fps, "FPSBoxAdv");
         fps->setVisible(false);
         getWidget(fps, "FPSBox");
         fps->setVisible(false);
+        getWidget(fps, "FrameTimingBox");
+        fps->setVisible(false);
 
-        if (level == 2)
+        if (level == 3)
+        {
+            getWidget(mFpsBox, "FPSBoxAdv");
+            mFpsBox->setVisible(true);
+            getWidget(mFpsCounter, "FPSCounterAdv");
+
+            getWidget(fps, "FrameTimingBox");
+            fps->setVisible(true);
+            getWidget(mFrameTimings, "FrameTimings");
+        }
+        else if (level == 2)
         {
             getWidget(mFpsBox, "FPSBoxAdv");
             mFpsBox->setVisible(true);
@@ -172,6 +192,62 @@ namespace MWGui
         mBatchCounter->setCaption(boost::lexical_cast<std::string>(count));
     }
 
+    void HUD::setFrameTimings(const Profiling::FrameProfiler& profiler)
+    {
+        unsigned int frames = profiler.getFrameCount();
+
+        // Changing the caption is not free, update a few times per second only
+        if (!mFrameTimings || !frames || profiler.getFrameNumber() % 15 != 0)
+            return;
+
+        int phases = profiler.getPhaseCount();
+
+        std::vector<double> average(phases+1, 0.0);
+        std::vector<double> maximum(phases+1, 0.0);
+
+        for (unsigned int i = 0; i < frames; ++i)
+        {
+            const Profiling::FrameProfiler::Frame& frame = profiler.getFrame(i);
+
+            for (int phase = 0; phase <= phases; ++phase)
+            {
+                double time = (phase < phases ? frame.mPhases[phase] : frame.mDuration) / 1000.0;
+                average[phase] += time / frames;
+                maximum[phase] = std::max(maximum[phase], time);
+            }
+        }
+
+        const Profiling::FrameProfiler::Frame& last = profiler.getFrame(0);
+
+        // time in ms: last frame, average and maximum over the recorded frames
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2);
+
+        for (int phase = 0; phase <= phases; ++phase)
+        {
+            double time = (phase < phases ? last.mPhases[phase] : last.mDuration) / 1000.0;
+
+            text
+                << (phase < phases ? profiler.getPhaseName(phase) : "Frame") << ": "
+                << time << " (" << average[phase] << " avg, " << maximum[phase] << " max)\n";
+        }
+
+        // counters: last frame and maximum over the recorded frames
+        for (int counter = 0; counter < profiler.getCounterCount(); ++counter)
+        {
+            boost::int64_t counterMaximum = 0;
+
+            for (unsigned int i = 0; i < frames; ++i)
+                counterMaximum = std::max(counterMaximum, profiler.getFrame(i).mCounters[counter]);
+
+            text
+                << profiler.getCounterName(counter) << ": " << last.mCounters[counter]
+                << " (" << counterMaximum << " max)\n";
+        }
+
+        mFrameTimings->setCaption(text.str());
+    }
+
     void HUD::setValue(const std::string& id, const MWMechanics::DynamicStat<float>& value)
     {
         int current = std::max(0, static_cast<int>(value.getCurrent()));
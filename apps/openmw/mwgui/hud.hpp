@@ -3,6 +3,11 @@
 #include "../mwmechanics/stat.hpp"
 #include "../mwworld/ptr.hpp"
 
+namespace Profiling
+{
+    class FrameProfiler;
+}
+
 namespace MWGui
 {
     class DragAndDrop;
@@ -18,6 +23,9 @@ namespace MWGui
         void setTriangleCount(unsigned int count);
         void setBatchCount(unsigned int count);
 
+        /// Show time spent in each phase of the recent frames (only at FPS level 3)
+        void setFrameTimings(const Profiling::FrameProfiler& profiler);
+
         /// Set time left for the player to start drowning
         /// @param time value from [0,20]
         void setDrowningTimeLeft(float time);
@@ -75,6 +83,7 @@ namespace MWGui
         MyGUI::TextBox* mFpsCounter;
         MyGUI::TextBox* mTriangleCounter;
         MyGUI::TextBox* mBatchCounter;
+        MyGUI::TextBox* mFrameTimings;
 
         // bottom left elements
         int mHealthManaStaminaBaseLeft, mWeapBoxBaseLeft, mSpellBoxBaseLeft, mSneakBoxBaseLeft;
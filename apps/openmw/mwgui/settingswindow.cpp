@@ -25,8 +25,10 @@ namespace
             return "#{sOff}";
         else if (level == 1)
             return "Basic";
-        else
+        else if (level == 2)
             return "Detailed";
+        else
+            return "Frame Timing";
     }
 
     std::string textureFilteringToStr(const std::string& val)
@@ -461,7 +463,7 @@ namespace MWGui
 
     void SettingsWindow::onFpsToggled(MyGUI::Widget* _sender)
     {
-        int newLevel = (Settings::Manager::getInt("fps", "HUD") + 1) % 3;
+        int newLevel = (Settings::Manager::getInt("fps", "HUD") + 1) % 4;
         Settings::Manager::setInt("fps", "HUD", newLevel);
         mFPSButton->setCaptionWithReplacing(fpsLevelToStr(newLevel));
         apply();
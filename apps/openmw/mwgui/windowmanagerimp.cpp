@@ -13,6 +13,8 @@
 
 #include <extern/sdl4ogre/sdlcursormanager.hpp>
 
+#include <components/profiling/frameprofiler.hpp>
+
 #include "../mwbase/inputmanager.hpp"
 
 #include "../mwworld/class.hpp"
@@ -217,6 +219,7 @@ namespace MWGui
         mContainerWindow = new ContainerWindow(mDragAndDrop);
         trackWindow(mContainerWindow, "container");
         mHud = new HUD(w,h, mShowFPSLevel, mDragAndDrop);
+        enableFrameTimings(mShowFPSLevel);
         mToolTips = new ToolTips();
         mScrollWindow = new ScrollWindow();
         mBookWindow = new BookWindow();
@@ -349,9 +352,19 @@ namespace MWGui
         mHud->setTriangleCount(mTriangleCount);
         mHud->setBatchCount(mBatchCount);
 
+        if (const Profiling::FrameProfiler* profiler = MWBase::Environment::get().getFrameProfiler())
+            mHud->setFrameTimings(*profiler);
+
         mHud->update();
     }
 
+    void WindowManager::enableFrameTimings(int fpsLevel)
+    {
+        // the HUD shows the frame timings at the highest FPS level only
+        if (Profiling::FrameProfiler* profiler = MWBase::Environment::get().getFrameProfiler())
+            profiler->setEnabled(fpsLevel == 3);
+    }
+
     void WindowManager::updateVisible()
     {
         if (!mMap)
@@ -890,6 +903,7 @@ namespace MWGui
     void WindowManager::processChangedSettings(const Settings::CategorySettingVector& changed)
     {
         mHud->setFpsLevel(Settings::Manager::getInt("fps", "HUD"));
+        enableFrameTimings(Settings::Manager::getInt("fps", "HUD"));
         mToolTips->setDelay(Settings::Manager::getFloat("tooltip delay", "GUI"));
 
         for (Settings::CategorySettingVector::const_iterator it = changed.begin();
@@ -369,6 +369,8 @@ namespace MWGui
 
     void updateVisible(); // Update visibility of all windows based on mode, shown and allowed settings
 
+    void enableFrameTimings(int fpsLevel); // Time frame phases, if the HUD shows them
+
     int mShowFPSLevel;
     float mFPS;
     unsigned int mTriangleCount;
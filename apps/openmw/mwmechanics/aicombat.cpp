@@ -74,13 +74,24 @@ namespace MWMechanics
 
         mTimer2 = mTimer2 + duration;
 
+        mPathFinder.pollPath();
+
         if(!mPathFinder.isPathConstructed())
-            mPathFinder.buildPath(start, dest, pathgrid, xCell, yCell, true);
-        else
+            mPathFinder.buildPathAsync(start, dest, pathgrid, xCell, yCell, true);
+        else if(!mPathFinder.isPathPending())
         {
-            mPathFinder2.buildPath(start, dest, pathgrid, xCell, yCell, true);
+            // compare with a fresh path, once it has arrived
+            bool updated;
+            if(mPathFinder2.isPathPending())
+                updated = mPathFinder2.pollPath();
+            else
+            {
+                mPathFinder2.buildPathAsync(start, dest, pathgrid, xCell, yCell, true);
+                updated = !mPathFinder2.isPathPending();
+            }
+
             ESM::Pathgrid::Point lastPt = mPathFinder.getPath().back();
-            if((mTimer2 > 0.25)&&(mPathFinder2.getPathSize() < mPathFinder.getPathSize() ||
+            if(updated && (mTimer2 > 0.25)&&(mPathFinder2.getPathSize() < mPathFinder.getPathSize() ||
                 (dest.mX - lastPt.mX)*(dest.mX - lastPt.mX)+(dest.mY - lastPt.mY)*(dest.mY - lastPt.mY)+(dest.mZ - lastPt.mZ)*(dest.mZ - lastPt.mZ) > 200*200))
             {
                 mTimer2 = 0;
@@ -115,6 +115,8 @@ namespace MWMechanics
         }
 
 
+        mPathFinder.pollPath();
+
         if(!mPathFinder.isPathConstructed() || cellChange)
         {
             cellX = actor.getCell()->mCell->mData.mX;
@@ -137,7 +139,10 @@ namespace MWMechanics
             start.mY = pos.pos[1];
             start.mZ = pos.pos[2];
 
-            mPathFinder.buildPath(start, dest, pathgrid, xCell, yCell, true);
+            if(actor.getCell()->mCell->isExterior())
+                mPathFinder.buildExteriorPath(start, dest, true);
+            else
+                mPathFinder.buildPathAsync(start, dest, pathgrid, xCell, yCell, true);
         }
 
         if(mPathFinder.checkPathCompleted(pos.pos[0],pos.pos[1],pos.pos[2]))
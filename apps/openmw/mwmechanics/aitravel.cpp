@@ -64,6 +64,9 @@ namespace MWMechanics
 
         const ESM::Pathgrid *pathgrid = world->getStore().get<ESM::Pathgrid>().search(*cell);
         bool cellChange = cell->mData.mX != cellX || cell->mData.mY != cellY;
+
+        mPathFinder.pollPath();
+
         if(!mPathFinder.isPathConstructed() || cellChange)
         {
             cellX = cell->mData.mX;
@@ -87,7 +90,10 @@ namespace MWMechanics
             start.mY = pos.pos[1];
             start.mZ = pos.pos[2];
 
-            mPathFinder.buildPath(start, dest, pathgrid, xCell, yCell, true);
+            if(cell->isExterior())
+                mPathFinder.buildExteriorPath(start, dest, true);
+            else
+                mPathFinder.buildPathAsync(start, dest, pathgrid, xCell, yCell, true);
         }
 
         if(mPathFinder.checkPathCompleted(pos.pos[0], pos.pos[1], pos.pos[2]))
@@ -121,28 +121,21 @@ namespace MWMechanics
                 npcPos[0] = npcPos[0] - mXCell;
                 npcPos[1] = npcPos[1] - mYCell;
 
-                for(unsigned int counter = 0; counter < mPathgrid->mPoints.size(); counter++)
-                {
-                    Ogre::Vector3 nodePos(mPathgrid->mPoints[counter].mX, mPathgrid->mPoints[counter].mY,
-                        mPathgrid->mPoints[counter].mZ);
-                    if(npcPos.squaredDistance(nodePos) <= mDistance * mDistance)
-                        mAllowedNodes.push_back(mPathgrid->mPoints[counter]);
-                }
-                if(!mAllowedNodes.empty())
+                const Pathgrid::SpatialIndex& index = PathFinder::getGraph(*mPathgrid)->getIndex();
+
+                std::vector<int> allowedPoints;
+                index.getPointsInRadius(npcPos[0], npcPos[1], npcPos[2], mDistance, allowedPoints);
+
+                if(!allowedPoints.empty())
                 {
-                    Ogre::Vector3 firstNodePos(mAllowedNodes[0].mX, mAllowedNodes[0].mY, mAllowedNodes[0].mZ);
-                    float closestNode = npcPos.squaredDistance(firstNodePos);
-                    unsigned int index = 0;
-                    for(unsigned int counterThree = 1; counterThree < mAllowedNodes.size(); counterThree++)
-                    {
-                        Ogre::Vector3 nodePos(mAllowedNodes[counterThree].mX, mAllowedNodes[counterThree].mY,
-                            mAllowedNodes[counterThree].mZ);
-                        float tempDist = npcPos.squaredDistance(nodePos);
-                        if(tempDist < closestNode)
-                            index = counterThree;
-                    }
-                    mCurrentNode = mAllowedNodes[index];
-                    mAllowedNodes.erase(mAllowedNodes.begin() + index);
+                    // The closest point of the path grid is within the wander distance, if any is.
+                    int closest = index.getClosestPoint(npcPos[0], npcPos[1], npcPos[2]);
+
+                    mCurrentNode = mPathgrid->mPoints[closest];
+
+                    for(std::vector<int>::const_iterator iter(allowedPoints.begin()); iter != allowedPoints.end(); ++iter)
+                        if(*iter != closest)
+                            mAllowedNodes.push_back(mPathgrid->mPoints[*iter]);
                 }
             }
         }
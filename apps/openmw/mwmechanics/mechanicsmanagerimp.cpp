@@ -1,6 +1,10 @@
 
 #include "mechanicsmanagerimp.hpp"
 
+#include <components/pathgrid/queryservice.hpp>
+#include <components/profiling/frameprofiler.hpp>
+#include <components/settings/settings.hpp>
+
 #include "../mwworld/esmstore.hpp"
 #include "../mwworld/inventorystore.hpp"
 
@@ -11,6 +15,9 @@
 
 #include "../mwworld/class.hpp"
 #include "../mwworld/player.hpp"
+#include "../mwworld/cellstore.hpp"
+
+#include "pathfinding.hpp"
 
 namespace MWMechanics
 {
@@ -165,9 +172,29 @@ namespace MWMechanics
 
     MechanicsManager::MechanicsManager()
     : mUpdatePlayer (true), mClassSelected (false),
-      mRaceSelected (false), mAI(true)
+      mRaceSelected (false), mAI(true), mPathQueries (0)
     {
         //buildPlayer no longer here, needs to be done explicitely after all subsystems are up and running
+
+        PathFinder::setState (&mPathFinderState);
+
+        if (Settings::Manager::getBool ("async pathfinding", "Game"))
+        {
+            mPathQueries = new Pathgrid::QueryService (
+                Settings::Manager::getInt ("path results per frame", "Game"));
+            PathFinder::setQueryService (mPathQueries);
+        }
+    }
+
+    MechanicsManager::~MechanicsManager()
+    {
+        if (mPathQueries)
+        {
+            PathFinder::setQueryService (0);
+            delete mPathQueries;
+        }
+
+        PathFinder::setState (0);
     }
 
     void MechanicsManager::add(const MWWorld::Ptr& ptr)
@@ -202,6 +229,9 @@ namespace MWMechanics
     {
         mActors.dropActors(cellStore, mWatched);
         mObjects.dropObjects(cellStore);
+
+        PathFinder::dropGraph(
+            MWBase::Environment::get().getWorld()->getStore().get<ESM::Pathgrid>().search(*cellStore->mCell));
     }
 
 
@@ -326,6 +356,25 @@ namespace MWMechanics
             mActors.addActor(ptr);
         }
 
+        if (mPathQueries)
+        {
+            mPathQueries->update();
+
+            Profiling::FrameProfiler *profiler = MWBase::Environment::get().getFrameProfiler();
+
+            if (profiler && profiler->isEnabled())
+            {
+                int queue = profiler->getCounter ("Path queue");
+                int results = profiler->getCounter ("Path results");
+
+                if (queue!=-1)
+                    profiler->setCounter (queue, mPathQueries->getQueueDepth());
+
+                if (results!=-1)
+                    profiler->setCounter (results, mPathQueries->getWaitingResults());
+            }
+        }
+
         mActors.update(duration, paused);
         mObjects.update(duration, paused);
     }
@@ -9,6 +9,7 @@
 #include "npcstats.hpp"
 #include "objects.hpp"
 #include "actors.hpp"
+#include "pathfinding.hpp"
 
 namespace Ogre
 {
@@ -34,6 +35,13 @@ namespace MWMechanics
             Objects mObjects;
             Actors mActors;
 
+            PathFinderState mPathFinderState;
+            Pathgrid::QueryService *mPathQueries; ///< 0: paths are searched synchronously
+
+            // not implemented
+            MechanicsManager (const MechanicsManager&);
+            MechanicsManager& operator= (const MechanicsManager&);
+
         public:
 
             void buildPlayer();
@@ -42,6 +50,8 @@ namespace MWMechanics
 
             MechanicsManager();
 
+            virtual ~MechanicsManager();
+
             virtual void add (const MWWorld::Ptr& ptr);
             ///< Register an object for management
 
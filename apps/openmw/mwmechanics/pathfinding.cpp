@@ -3,32 +3,16 @@
 #include "../mwbase/world.hpp"
 #include "../mwbase/environment.hpp"
 
+#include "../mwworld/esmstore.hpp"
+
 #include "OgreMath.h"
 
-#include <boost/graph/dijkstra_shortest_paths.hpp>
-#include <boost/graph/adjacency_list.hpp>
+#include <cassert>
+
+#include <components/esm/loadland.hpp>
 
 namespace
 {
-    struct found_path {};
-
-    typedef boost::adjacency_list< boost::vecS, boost::vecS, boost::undirectedS,
-        boost::property<boost::vertex_index_t, int, ESM::Pathgrid::Point>, boost::property<boost::edge_weight_t, float> >
-        PathGridGraph;
-    typedef boost::property_map<PathGridGraph, boost::edge_weight_t>::type WeightMap;
-    typedef PathGridGraph::vertex_descriptor PointID;
-    typedef PathGridGraph::edge_descriptor PointConnectionID;
-
-    class goalVisited : public boost::default_dijkstra_visitor
-    {
-        public:
-            goalVisited(PointID goal) {mGoal = goal;};
-            void examine_vertex(PointID u, const PathGridGraph g) {if(u == mGoal) throw found_path();};
-
-        private:
-            PointID mGoal;
-    };
-
     float distanceZCorrected(ESM::Pathgrid::Point point, float x, float y, float z)
     {
         x -= point.mX;
@@ -37,22 +21,6 @@ namespace
         return sqrt(x * x + y * y + 0.1 * z * z);
     }
 
-    float distance(ESM::Pathgrid::Point point, float x, float y, float z)
-    {
-        x -= point.mX;
-        y -= point.mY;
-        z -= point.mZ;
-        return sqrt(x * x + y * y + z * z);
-    }
-
-    float distance(ESM::Pathgrid::Point a, ESM::Pathgrid::Point b)
-    {
-        float x = a.mX - b.mX;
-        float y = a.mY - b.mY;
-        float z = a.mZ - b.mZ;
-        return sqrt(x * x + y * y + z * z);
-    }
-
     static float sgn(float a)
     {
         if(a > 0)
@@ -60,88 +28,74 @@ namespace
         return -1.0;
     }
 
-    int getClosestPoint(const ESM::Pathgrid* grid, float x, float y, float z)
+    /// Set by the mechanics manager, which owns both (0: not available)
+    MWMechanics::PathFinderState *sState = 0;
+    Pathgrid::QueryService *sQueries = 0; ///< 0: buildPathAsync searches synchronously
+}
+
+namespace MWMechanics
+{
+    const ESM::Pathgrid *PathFinderState::WorldPathgrids::getExterior(int x, int y) const
     {
-        if(!grid || grid->mPoints.empty())
-            return -1;
+        return MWBase::Environment::get().getWorld()->getStore().get<ESM::Pathgrid>().search(x, y);
+    }
 
-        float distanceBetween = distance(grid->mPoints[0], x, y, z);
-        int closestIndex = 0;
+    PathFinderState::PathFinderState()
+    : mPortals(mStorage, mGraphs, ESM::Land::REAL_SIZE)
+    {}
 
-        for(unsigned int counter = 1; counter < grid->mPoints.size(); counter++)
-        {
-            if(distance(grid->mPoints[counter], x, y, z) < distanceBetween)
-            {
-                distanceBetween = distance(grid->mPoints[counter], x, y, z);
-                closestIndex = counter;
-            }
-        }
-
-        return closestIndex;
+    PathFinder::PathFinder()
+    : mRequest(0)
+    {
+        mIsPathConstructed = false;
     }
 
-    PathGridGraph buildGraph(const ESM::Pathgrid* pathgrid, float xCell = 0, float yCell = 0)
+    PathFinder::PathFinder(const PathFinder& finder)
+    : mPath(finder.mPath), mIsPathConstructed(finder.mIsPathConstructed), mRequest(0)
     {
-        PathGridGraph graph;
-
-        for(unsigned int counter = 0; counter < pathgrid->mPoints.size(); counter++)
+        if(finder.mRequest)
         {
-            PointID pID = boost::add_vertex(graph);
-            graph[pID].mX = pathgrid->mPoints[counter].mX + xCell;
-            graph[pID].mY = pathgrid->mPoints[counter].mY + yCell;
-            graph[pID].mZ = pathgrid->mPoints[counter].mZ;
-        }
-
-        for(unsigned int counterTwo = 0; counterTwo < pathgrid->mEdges.size(); counterTwo++)
-        {
-            PointID u = pathgrid->mEdges[counterTwo].mV0;
-            PointID v = pathgrid->mEdges[counterTwo].mV1;
-
-            PointConnectionID edge;
-            bool done;
-            boost::tie(edge, done) = boost::add_edge(u, v, graph);
-            WeightMap weightmap = boost::get(boost::edge_weight, graph);
-            weightmap[edge] = distance(graph[u], graph[v]);
+            mPath.clear();
+            mIsPathConstructed = false;
         }
-
-        return graph;
     }
 
-    std::list<ESM::Pathgrid::Point> findPath(PointID start, PointID end, PathGridGraph graph)
+    PathFinder& PathFinder::operator=(const PathFinder& finder)
     {
-        std::vector<PointID> p(boost::num_vertices(graph));
-        std::vector<float> d(boost::num_vertices(graph));
-        std::list<ESM::Pathgrid::Point> shortest_path;
-
-        try
+        if(this != &finder)
         {
-            boost::dijkstra_shortest_paths(graph, start,
-                boost::predecessor_map(&p[0]).distance_map(&d[0]).visitor(goalVisited(end)));
-        }
+            cancelRequest();
 
-        catch(found_path& fg)
-        {
-            for(PointID v = end; ; v = p[v])
+            if(finder.mRequest)
             {
-                shortest_path.push_front(graph[v]);
-                if(p[v] == v)
-                    break;
+                mPath.clear();
+                mIsPathConstructed = false;
+            }
+            else
+            {
+                mPath = finder.mPath;
+                mIsPathConstructed = finder.mIsPathConstructed;
             }
         }
 
-        return shortest_path;
+        return *this;
     }
-}
 
-namespace MWMechanics
-{
-    PathFinder::PathFinder()
+    PathFinder::~PathFinder()
     {
-        mIsPathConstructed = false;
+        cancelRequest();
+    }
+
+    void PathFinder::cancelRequest()
+    {
+        if(mRequest && sQueries)
+            sQueries->cancel(mRequest);
+        mRequest = 0;
     }
 
     void PathFinder::clearPath()
     {
+        cancelRequest();
         if(!mPath.empty())
             mPath.clear();
         mIsPathConstructed = false;
@@ -150,6 +104,8 @@ namespace MWMechanics
     void PathFinder::buildPath(const ESM::Pathgrid::Point &startPoint, const ESM::Pathgrid::Point &endPoint,
                                const ESM::Pathgrid *pathGrid, float xCell, float yCell, bool allowShortcuts)
     {
+        cancelRequest();
+
         if(allowShortcuts)
         {
             if(MWBase::Environment::get().getWorld()->castRay(startPoint.mX, startPoint.mY, startPoint.mZ,
@@ -159,16 +115,28 @@ namespace MWMechanics
 
         if(!allowShortcuts)
         {
-            int startNode = getClosestPoint(pathGrid, startPoint.mX - xCell, startPoint.mY - yCell,startPoint.mZ);
-            int endNode = getClosestPoint(pathGrid, endPoint.mX - xCell, endPoint.mY - yCell, endPoint.mZ);
-
-            if(startNode != -1 && endNode != -1)
+            if(pathGrid && !pathGrid->mPoints.empty())
             {
-                PathGridGraph graph = buildGraph(pathGrid, xCell, yCell);
-                mPath = findPath(startNode, endNode, graph);
+                Pathgrid::GraphCache::GraphPtr graph = getGraph(*pathGrid);
+
+                const Pathgrid::SpatialIndex& index = graph->getIndex();
+                int startNode = index.getClosestPoint(startPoint.mX - xCell, startPoint.mY - yCell, startPoint.mZ);
+                int endNode = index.getClosestPoint(endPoint.mX - xCell, endPoint.mY - yCell, endPoint.mZ);
+
+                mPath.clear();
 
-                if(!mPath.empty())
+                std::vector<int>& points = sState->mPoints;
+
+                if(sState->mSearch.findPath(*graph, startNode, endNode, points))
                 {
+                    for(std::vector<int>::const_iterator iter(points.begin()); iter != points.end(); ++iter)
+                    {
+                        ESM::Pathgrid::Point point = pathGrid->mPoints[*iter];
+                        point.mX += xCell;
+                        point.mY += yCell;
+                        mPath.push_back(point);
+                    }
+
                     mPath.push_back(endPoint);
                     mIsPathConstructed = true;
                 }
@@ -184,6 +152,136 @@ namespace MWMechanics
             mIsPathConstructed = false;
     }
 
+    void PathFinder::buildPathAsync(const ESM::Pathgrid::Point &startPoint, const ESM::Pathgrid::Point &endPoint,
+                                    const ESM::Pathgrid *pathGrid, float xCell, float yCell, bool allowShortcuts)
+    {
+        if(!sQueries || !pathGrid || pathGrid->mPoints.empty())
+        {
+            buildPath(startPoint, endPoint, pathGrid, xCell, yCell, allowShortcuts);
+            return;
+        }
+
+        cancelRequest();
+
+        mPath.clear();
+        mPath.push_back(endPoint);
+        mIsPathConstructed = true;
+
+        if(allowShortcuts && !MWBase::Environment::get().getWorld()->castRay(startPoint.mX, startPoint.mY,
+            startPoint.mZ, endPoint.mX, endPoint.mY, endPoint.mZ))
+            return;
+
+        float start[3] = { startPoint.mX, startPoint.mY, startPoint.mZ };
+        float end[3] = { endPoint.mX, endPoint.mY, endPoint.mZ };
+
+        // head straight for the end point until the path arrives
+        mRequest = sQueries->submit(getGraph(*pathGrid), xCell, yCell, start, end);
+        mRequestEnd = endPoint;
+    }
+
+    bool PathFinder::pollPath()
+    {
+        if(!mRequest || !sQueries)
+            return false;
+
+        std::vector<ESM::Pathgrid::Point>& pathPoints = sState->mPathPoints;
+        Pathgrid::QueryService::Status status = sQueries->getResult(mRequest, pathPoints);
+
+        if(status == Pathgrid::QueryService::Status_Pending)
+            return false;
+
+        mRequest = 0;
+
+        if(status == Pathgrid::QueryService::Status_Found)
+        {
+            mPath.assign(pathPoints.begin(), pathPoints.end());
+            mPath.push_back(mRequestEnd);
+            mIsPathConstructed = true;
+            return true;
+        }
+
+        if(status == Pathgrid::QueryService::Status_NotFound)
+        {
+            mPath.clear();
+            mIsPathConstructed = false;
+            return true;
+        }
+
+        // result expired: keep heading straight for the end point
+        return false;
+    }
+
+    void PathFinder::buildExteriorPath(const ESM::Pathgrid::Point &startPoint, const ESM::Pathgrid::Point &endPoint,
+                                       bool allowShortcuts)
+    {
+        MWBase::World *world = MWBase::Environment::get().getWorld();
+
+        int startX, startY, endX, endY;
+        world->positionToIndex(startPoint.mX, startPoint.mY, startX, startY);
+        world->positionToIndex(endPoint.mX, endPoint.mY, endX, endY);
+
+        const MWWorld::Store<ESM::Pathgrid>& pathgrids = world->getStore().get<ESM::Pathgrid>();
+        const ESM::Pathgrid *pathGrid = pathgrids.search(startX, startY);
+        float xCell = startX * ESM::Land::REAL_SIZE;
+        float yCell = startY * ESM::Land::REAL_SIZE;
+
+        if(startX == endX && startY == endY)
+        {
+            buildPathAsync(startPoint, endPoint, pathGrid, xCell, yCell, allowShortcuts);
+            return;
+        }
+
+        cancelRequest();
+
+        if(allowShortcuts && !world->castRay(startPoint.mX, startPoint.mY, startPoint.mZ,
+                                             endPoint.mX, endPoint.mY, endPoint.mZ))
+        {
+            mPath.clear();
+            mPath.push_back(endPoint);
+            mIsPathConstructed = true;
+            return;
+        }
+
+        float start[3] = { startPoint.mX, startPoint.mY, startPoint.mZ };
+        float end[3] = { endPoint.mX, endPoint.mY, endPoint.mZ };
+
+        std::vector<ESM::Pathgrid::Point>& pathPoints = sState->mPathPoints;
+
+        if(sState->mPortals.findPath(start, end, pathPoints))
+        {
+            mPath.assign(pathPoints.begin(), pathPoints.end());
+            mPath.push_back(endPoint);
+            mIsPathConstructed = true;
+        }
+        else
+        {
+            // head for the end point using the current cell's path grid only
+            buildPath(startPoint, endPoint, pathGrid, xCell, yCell, false);
+        }
+    }
+
+    Pathgrid::GraphCache::GraphPtr PathFinder::getGraph(const ESM::Pathgrid& pathGrid)
+    {
+        assert(sState);
+        return sState->mGraphs.get(pathGrid);
+    }
+
+    void PathFinder::dropGraph(const ESM::Pathgrid* pathGrid)
+    {
+        if(sState)
+            sState->mGraphs.erase(pathGrid);
+    }
+
+    void PathFinder::setState(PathFinderState *state)
+    {
+        sState = state;
+    }
+
+    void PathFinder::setQueryService(Pathgrid::QueryService *service)
+    {
+        sQueries = service;
+    }
+
     float PathFinder::getZAngleToNext(float x, float y) const
     {
         // This should never happen (programmers should have an if statement checking mIsPathConstructed that prevents this call
@@ -2,20 +2,83 @@
 #define GAME_MWMECHANICS_PATHFINDING_H
 
 #include <components/esm/loadpgrd.hpp>
+#include <components/pathgrid/graph.hpp>
+#include <components/pathgrid/portalgraph.hpp>
+#include <components/pathgrid/queryservice.hpp>
 #include <list>
+#include <vector>
 
 namespace MWMechanics
 {
+    /// \brief Path grid graphs and search state shared by all path finders
+    ///
+    /// Owned by the mechanics manager, see PathFinder::setState.
+    class PathFinderState
+    {
+            class WorldPathgrids : public Pathgrid::Storage
+            {
+                public:
+                    virtual const ESM::Pathgrid *getExterior(int x, int y) const;
+            };
+
+            // not implemented
+            PathFinderState(const PathFinderState&);
+            PathFinderState& operator=(const PathFinderState&);
+
+        public:
+
+            Pathgrid::GraphCache mGraphs; ///< graphs of the path grids of the active cells
+
+            // reused by all path finders, so that searching does not allocate
+            Pathgrid::Search mSearch;
+            std::vector<int> mPoints;
+            std::vector<ESM::Pathgrid::Point> mPathPoints;
+
+            WorldPathgrids mStorage;
+            Pathgrid::PortalGraph mPortals; ///< connects the path grids of neighbouring exterior cells
+
+            PathFinderState();
+    };
+
     class PathFinder
     {
         public:
             PathFinder();
 
+            PathFinder(const PathFinder& finder);
+            ///< A pending background search is not shared with the copy. If \a finder is still
+            /// waiting for a path, the copy has no path, so that it is built again.
+
+            PathFinder& operator=(const PathFinder& finder);
+            ///< Cancels the pending search of *this, see copy constructor.
+
+            ~PathFinder();
+
             void clearPath();
             void buildPath(const ESM::Pathgrid::Point &startPoint, const ESM::Pathgrid::Point &endPoint,
                            const ESM::Pathgrid* pathGrid, float xCell = 0, float yCell = 0,
                            bool allowShortcuts = true);
 
+            void buildPathAsync(const ESM::Pathgrid::Point &startPoint, const ESM::Pathgrid::Point &endPoint,
+                                const ESM::Pathgrid* pathGrid, float xCell = 0, float yCell = 0,
+                                bool allowShortcuts = true);
+            ///< Like buildPath, but the path grid is searched on a background thread (if enabled).
+            /// Until the path has arrived (see pollPath), the path leads straight to \a endPoint.
+
+            bool pollPath();
+            ///< Pick up the path of a pending background search.
+            /// \return Has the path been replaced?
+
+            bool isPathPending() const
+            {
+                return mRequest != 0;
+            }
+
+            void buildExteriorPath(const ESM::Pathgrid::Point &startPoint, const ESM::Pathgrid::Point &endPoint,
+                                   bool allowShortcuts = true);
+            ///< Like buildPath, but \a endPoint may be in a different exterior cell than \a startPoint. The path
+            /// grids of the cells in between are connected at the cell borders.
+
             bool checkPathCompleted(float x, float y, float z);
             ///< \Returns true if the last point of the path has been reached.
             bool checkWaypoint(float x, float y, float z);
@@ -37,9 +100,25 @@ namespace MWMechanics
                 return mPath;
             }
 
+            static Pathgrid::GraphCache::GraphPtr getGraph(const ESM::Pathgrid& pathGrid);
+            ///< Search graph and spatial index of \a pathGrid (built on first use).
+
+            static void dropGraph(const ESM::Pathgrid* pathGrid);
+            ///< Discard the cached search graph of \a pathGrid (call when its cell is unloaded).
+
+            static void setState(PathFinderState *state);
+            ///< Graphs and search state used by all path finders. Must be set while paths are built.
+
+            static void setQueryService(Pathgrid::QueryService *service);
+            ///< Service used by buildPathAsync (0: search synchronously).
+
         private:
             std::list<ESM::Pathgrid::Point> mPath;
             bool mIsPathConstructed;
+            Pathgrid::QueryService::RequestId mRequest;
+            ESM::Pathgrid::Point mRequestEnd;
+
+            void cancelRequest();
     };
 }
 
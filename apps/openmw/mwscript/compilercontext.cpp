@@ -1,6 +1,8 @@
 
 #include "compilercontext.hpp"
 
+#include <boost/thread/locks.hpp>
+
 #include "../mwworld/esmstore.hpp"
 
 #include <components/compiler/locals.hpp>
@@ -28,8 +30,16 @@ namespace MWScript
         return MWBase::Environment::get().getWorld()->getGlobalVariableType (name);
     }
 
+    int CompilerContext::getGlobalSlot (const std::string& name) const
+    {
+        return MWBase::Environment::get().getWorld()->getGlobalVariableSlot (name);
+    }
+
     char CompilerContext::getMemberType (const std::string& name, const std::string& id) const
     {
+        // may load cells and script locals
+        boost::lock_guard<boost::mutex> lock (mMemberMutex);
+
         MWWorld::Ptr ptr = MWBase::Environment::get().getWorld()->getPtr (id, false);
 
         std::string script = MWWorld::Class::get (ptr).getScript (ptr);
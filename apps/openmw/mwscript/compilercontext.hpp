@@ -1,6 +1,8 @@
 #ifndef GAME_SCRIPT_COMPILERCONTEXT_H
 #define GAME_SCRIPT_COMPILERCONTEXT_H
 
+#include <boost/thread/mutex.hpp>
+
 #include <components/compiler/context.hpp>
 
 namespace MWScript
@@ -19,6 +21,7 @@ namespace MWScript
         private:
 
             Type mType;
+            mutable boost::mutex mMemberMutex; // serialises getMemberType for compiler threads
 
         public:
 
@@ -30,6 +33,9 @@ namespace MWScript
             /// 'l: long, 's': short, 'f': float, ' ': does not exist.
             virtual char getGlobalType (const std::string& name) const;
 
+            virtual int getGlobalSlot (const std::string& name) const;
+            ///< -1: does not exist.
+
             virtual char getMemberType (const std::string& name, const std::string& id) const;
             ///< 'l: long, 's': short, 'f': float, ' ': does not exist.
 
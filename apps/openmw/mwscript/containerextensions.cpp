@@ -85,7 +85,8 @@ namespace MWScript
                 {
                     MWWorld::Ptr ptr = R()(runtime);
 
-                    std::string item = runtime.getStringLiteral (runtime[0].mInteger);
+                    std::size_t length = 0;
+                    const char *item = runtime.getStringLiteral (runtime[0].mInteger, length);
                     runtime.pop();
 
                     MWWorld::ContainerStore& store = MWWorld::Class::get (ptr).getContainerStore (ptr);
@@ -93,7 +94,7 @@ namespace MWScript
                     Interpreter::Type_Integer sum = 0;
 
                     for (MWWorld::ContainerStoreIterator iter (store.begin()); iter!=store.end(); ++iter)
-                        if (Misc::StringUtils::ciEqual(iter->getCellRef().mRefID, item))
+                        if (Misc::StringUtils::ciEqual(iter->getCellRef().mRefID, item, length))
                             sum += iter->getRefData().getCount();
 
                     runtime.push (sum);
@@ -177,6 +177,36 @@ namespace MWScript
             MWBase::Environment::get().getWorld()->getGlobalVariable (name).mFloat = value;
     }
 
+    int InterpreterContext::getGlobalShort (int slot) const
+    {
+        return MWBase::Environment::get().getWorld()->getGlobalVariable (slot).mShort;
+    }
+
+    int InterpreterContext::getGlobalLong (int slot) const
+    {
+        return MWBase::Environment::get().getWorld()->getGlobalVariable (slot).mLong;
+    }
+
+    float InterpreterContext::getGlobalFloat (int slot) const
+    {
+        return MWBase::Environment::get().getWorld()->getGlobalVariable (slot).mFloat;
+    }
+
+    void InterpreterContext::setGlobalShort (int slot, int value)
+    {
+        MWBase::Environment::get().getWorld()->setGlobalVariable (slot, value);
+    }
+
+    void InterpreterContext::setGlobalLong (int slot, int value)
+    {
+        MWBase::Environment::get().getWorld()->setGlobalVariable (slot, value);
+    }
+
+    void InterpreterContext::setGlobalFloat (int slot, float value)
+    {
+        MWBase::Environment::get().getWorld()->setGlobalVariable (slot, value);
+    }
+
     std::vector<std::string> InterpreterContext::getGlobals () const
     {
         MWBase::World *world = MWBase::Environment::get().getWorld();
@@ -421,82 +451,56 @@ namespace MWScript
         MWBase::Environment::get().getWorld()->disable (ref);
     }
 
-    int InterpreterContext::getMemberShort (const std::string& id, const std::string& name) const
+    Locals& InterpreterContext::getMemberLocals (const std::string& id, const std::string& name,
+        char type, int& index) const
     {
         const MWWorld::Ptr ptr = getReference (id, false);
 
         std::string scriptId = MWWorld::Class::get (ptr).getScript (ptr);
 
-        int index = MWBase::Environment::get().getScriptManager()->getLocalIndex (scriptId, name, 's');
+        index = MWBase::Environment::get().getScriptManager()->getLocalIndex (scriptId, name, type);
 
-        ptr.getRefData().setLocals (
-            *MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptId));
-        return ptr.getRefData().getLocals().mShorts[index];
+        if (!ptr.getRefData().hasLocals())
+            ptr.getRefData().setLocals (
+                *MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptId));
+
+        return ptr.getRefData().getLocals();
     }
 
-    int InterpreterContext::getMemberLong (const std::string& id, const std::string& name) const
+    int InterpreterContext::getMemberShort (const std::string& id, const std::string& name) const
     {
-        const MWWorld::Ptr ptr = getReference (id, false);
-
-        std::string scriptId = MWWorld::Class::get (ptr).getScript (ptr);
-
-        int index = MWBase::Environment::get().getScriptManager()->getLocalIndex (scriptId, name, 'l');
+        int index = 0;
+        return getMemberLocals (id, name, 's', index).mShorts[index];
+    }
 
-        ptr.getRefData().setLocals (
-            *MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptId));
-        return ptr.getRefData().getLocals().mLongs[index];
+    int InterpreterContext::getMemberLong (const std::string& id, const std::string& name) const
+    {
+        int index = 0;
+        return getMemberLocals (id, name, 'l', index).mLongs[index];
     }
 
     float InterpreterContext::getMemberFloat (const std::string& id, const std::string& name) const
     {
-        const MWWorld::Ptr ptr = getReference (id, false);
-
-        std::string scriptId = MWWorld::Class::get (ptr).getScript (ptr);
-
-        int index = MWBase::Environment::get().getScriptManager()->getLocalIndex (scriptId, name, 'f');
-
-        ptr.getRefData().setLocals (
-            *MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptId));
-        return ptr.getRefData().getLocals().mFloats[index];
+        int index = 0;
+        return getMemberLocals (id, name, 'f', index).mFloats[index];
     }
 
     void InterpreterContext::setMemberShort (const std::string& id, const std::string& name, int value)
     {
-        const MWWorld::Ptr ptr = getReference (id, false);
-
-        std::string scriptId = MWWorld::Class::get (ptr).getScript (ptr);
-
-        int index = MWBase::Environment::get().getScriptManager()->getLocalIndex (scriptId, name, 's');
-
-        ptr.getRefData().setLocals (
-            *MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptId));
-        ptr.getRefData().getLocals().mShorts[index] = value;
+        int index = 0;
+        getMemberLocals (id, name, 's', index).mShorts[index] = value;
     }
 
     void InterpreterContext::setMemberLong (const std::string& id, const std::string& name, int value)
     {
-        const MWWorld::Ptr ptr = getReference (id, false);
-
-        std::string scriptId = MWWorld::Class::get (ptr).getScript (ptr);
-
-        int index = MWBase::Environment::get().getScriptManager()->getLocalIndex (scriptId, name, 'l');
-
-        ptr.getRefData().setLocals (
-            *MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptId));
-        ptr.getRefData().getLocals().mLongs[index] = value;
+        int index = 0;
+        getMemberLocals (id, name, 'l', index).mLongs[index] = value;
     }
 
     void InterpreterContext::setMemberFloat (const std::string& id, const std::string& name, float value)
     {
-        const MWWorld::Ptr ptr = getReference (id, false);
-
-        std::string scriptId = MWWorld::Class::get (ptr).getScript (ptr);
-
-        int index = MWBase::Environment::get().getScriptManager()->getLocalIndex (scriptId, name, 'f');
-
-        ptr.getRefData().setLocals (
-            *MWBase::Environment::get().getWorld()->getStore().get<ESM::Script>().find (scriptId));
-        ptr.getRefData().getLocals().mFloats[index] = value;
+        int index = 0;
+        getMemberLocals (id, name, 'f', index).mFloats[index] = value;
     }
 
     MWWorld::Ptr InterpreterContext::getReference()
@@ -37,6 +37,11 @@ namespace MWScript
 
             const MWWorld::Ptr getReference (const std::string& id, bool activeOnly) const;
 
+            Locals& getMemberLocals (const std::string& id, const std::string& name, char type,
+                int& index) const;
+            ///< Return locals of the reference \a id and store the index of its local variable
+            /// \a name of type \a type in \a index.
+
         public:
 
             InterpreterContext (MWScript::Locals *locals, MWWorld::Ptr reference);
@@ -75,6 +80,18 @@ namespace MWScript
             virtual void setGlobalLong (const std::string& name, int value);
 
             virtual void setGlobalFloat (const std::string& name, float value);
+
+            virtual int getGlobalShort (int slot) const;
+
+            virtual int getGlobalLong (int slot) const;
+
+            virtual float getGlobalFloat (int slot) const;
+
+            virtual void setGlobalShort (int slot, int value);
+
+            virtual void setGlobalLong (int slot, int value);
+
+            virtual void setGlobalFloat (int slot, float value);
             
             virtual std::vector<std::string> getGlobals () const;
 
@@ -2,8 +2,6 @@
 
 #include <components/esm/loadscpt.hpp>
 
-#include <components/compiler/locals.hpp>
-
 #include "../mwbase/environment.hpp"
 #include "../mwbase/scriptmanager.hpp"
 
@@ -21,10 +19,9 @@ namespace MWScript
 
     int Locals::getIntVar(const std::string &script, const std::string &var)
     {
-        Compiler::Locals locals = MWBase::Environment::get().getScriptManager()->getLocals(script);
-        int index = locals.getIndex(var);
-        char type = locals.getType(var);
-        if(index != -1)
+        int index = 0;
+        char type = MWBase::Environment::get().getScriptManager()->getLocalType(script, var, index);
+        if(type != ' ')
         {
             switch(type)
             {
@@ -45,10 +42,9 @@ namespace MWScript
 
     bool Locals::setVarByInt(const std::string& script, const std::string& var, int val)
     {
-        Compiler::Locals locals = MWBase::Environment::get().getScriptManager()->getLocals(script);
-        int index = locals.getIndex(var);
-        char type = locals.getType(var);
-        if(index != -1)
+        int index = 0;
+        char type = MWBase::Environment::get().getScriptManager()->getLocalType(script, var, index);
+        if(type != ' ')
         {
             switch(type)
             {
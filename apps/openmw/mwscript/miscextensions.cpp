@@ -2,6 +2,7 @@
 #include "miscextensions.hpp"
 
 #include <cstdlib>
+#include <sstream>
 
 #include <libs/openengine/ogre/fader.hpp>
 
@@ -700,6 +701,29 @@ namespace MWScript
                 }
         };
 
+        class OpProfileScripts : public Interpreter::Opcode0
+        {
+            public:
+                virtual void execute (Interpreter::Runtime& runtime)
+                {
+                    InterpreterContext& context = static_cast<InterpreterContext&> (runtime.getContext());
+
+                    MWBase::ScriptManager *scriptManager =
+                        MWBase::Environment::get().getScriptManager();
+
+                    bool enabled = !scriptManager->isProfiling();
+
+                    scriptManager->setProfiling (enabled);
+
+                    context.report (enabled ? "Script Profiling -> On" : "Script Profiling -> Off");
+
+                    std::ostringstream summary;
+
+                    if (!enabled && scriptManager->writeProfile (summary, MWBase::ScriptManager::Profile_Summary))
+                        context.report (summary.str());
+                }
+        };
+
 
         void installOpcodes (Interpreter::Interpreter& interpreter)
         {
@@ -759,6 +783,7 @@ namespace MWScript
             interpreter.installSegment5 (Compiler::Misc::opcodeShowVars, new OpShowVars<ImplicitRef>);
             interpreter.installSegment5 (Compiler::Misc::opcodeShowVarsExplicit, new OpShowVars<ExplicitRef>);
             interpreter.installSegment5 (Compiler::Misc::opcodeToggleGodMode, new OpToggleGodMode);
+            interpreter.installSegment5 (Compiler::Misc::opcodeProfileScripts, new OpProfileScripts);
             interpreter.installSegment5 (Compiler::Misc::opcodeDisableLevitation, new OpEnableLevitation<false>);
             interpreter.installSegment5 (Compiler::Misc::opcodeEnableLevitation, new OpEnableLevitation<true>);
         }
@@ -1,79 +1,345 @@
 
 #include "scriptmanagerimp.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <exception>
 
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/thread.hpp>
+#include <boost/filesystem/operations.hpp>
+
 #include <components/esm/loadscpt.hpp>
+#include <components/misc/stringops.hpp>
 #include "../mwworld/esmstore.hpp"
 
 #include <components/compiler/scanner.hpp>
 #include <components/compiler/context.hpp>
 #include <components/compiler/exception.hpp>
+#include <components/compiler/optimizer.hpp>
 
 #include "extensions.hpp"
 
-namespace MWScript
+namespace
 {
-    ScriptManager::ScriptManager (const MWWorld::ESMStore& store, bool verbose,
-        Compiler::Context& compilerContext)
-    : mErrorHandler (std::cerr), mStore (store), mVerbose (verbose),
-      mCompilerContext (compilerContext), mParser (mErrorHandler, mCompilerContext),
-      mOpcodesInstalled (false), mGlobalScripts (store)
-    {}
+    /// Increase whenever the cache layout, code generation or opcodes change
+    const int sScriptCacheVersion = 3;
 
-    bool ScriptManager::compile (const std::string& name)
+    typedef boost::uint64_t Hash;
+
+    /// FNV-1a, continued from \a hash
+    Hash hashBytes (const char *data, std::size_t size, Hash hash = 14695981039346656037ULL)
+    {
+        for (std::size_t i=0; i<size; ++i)
+        {
+            hash ^= static_cast<unsigned char> (data[i]);
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    Hash hashString (const std::string& string, Hash hash)
+    {
+        hash = hashBytes (string.c_str(), string.size()+1, hash); // include terminator as separator
+        return hash;
+    }
+
+    template<typename T>
+    Hash hashValue (const T& value, Hash hash)
+    {
+        return hashBytes (reinterpret_cast<const char *> (&value), sizeof (T), hash);
+    }
+
+    /// Hash the IDs of all records in \a store (they are valid IDs for Compiler::Context::isId)
+    template<typename T>
+    Hash hashIds (const MWWorld::Store<T>& store, Hash hash)
+    {
+        for (typename MWWorld::Store<T>::iterator it = store.begin(); it!=store.end(); ++it)
+            hash = hashString (it->mId, hash);
+
+        return hash;
+    }
+
+    /// Hash the IDs of all records in \a store together with their scripts (member variables are
+    /// looked up via the script of an object)
+    template<typename T>
+    Hash hashScriptedIds (const MWWorld::Store<T>& store, Hash hash)
     {
-        mParser.reset();
-        mErrorHandler.reset();
+        for (typename MWWorld::Store<T>::iterator it = store.begin(); it!=store.end(); ++it)
+        {
+            hash = hashString (it->mId, hash);
+            hash = hashString (it->mScript, hash);
+        }
+
+        return hash;
+    }
+
+    /// Compile \a script with \a parser.
+    ///
+    /// Informational messages go to \a output, errors to \a errors (which should be the stream of
+    /// \a errorHandler).
+    /// \return Success?
+    bool compileScript (const ESM::Script& script, Compiler::FileParser& parser,
+        Compiler::ErrorHandler& errorHandler, const Compiler::Context& context, bool verbose,
+        bool optimize, std::ostream& output, std::ostream& errors,
+        std::vector<Interpreter::Type_Code>& code, Compiler::Locals& locals)
+    {
+        parser.reset();
+        errorHandler.reset();
 
         bool Success = true;
 
-        if (const ESM::Script *script = mStore.get<ESM::Script>().find (name))
+        const std::string& name = script.mId;
+
+        if (verbose)
+            output << "compiling script: " << name << std::endl;
+
+        try
         {
-            if (mVerbose)
-                std::cout << "compiling script: " << name << std::endl;
+            std::istringstream input (script.mScriptText);
 
-            try
-            {
-                std::istringstream input (script->mScriptText);
+            Compiler::Scanner scanner (errorHandler, input, context.getExtensions());
 
-                Compiler::Scanner scanner (mErrorHandler, input, mCompilerContext.getExtensions());
+            scanner.scan (parser);
 
-                scanner.scan (mParser);
+            if (!errorHandler.isGood())
+                Success = false;
+        }
+        catch (const Compiler::SourceException&)
+        {
+            // error has already been reported via error handler
+            Success = false;
+        }
+        catch (const std::exception& error)
+        {
+            errors << "An exception has been thrown: " << error.what() << std::endl;
+            Success = false;
+        }
 
-                if (!mErrorHandler.isGood())
-                    Success = false;
-            }
-            catch (const Compiler::SourceException&)
+        if (!Success)
+        {
+            if (verbose)
+                errors
+                    << "compiling failed: " << name << std::endl
+                    << script.mScriptText
+                    << std::endl << std::endl;
+
+            return false;
+        }
+
+        parser.getCode (code);
+
+        if (optimize)
+        {
+            std::vector<Interpreter::Type_Code> optimized (code);
+            Compiler::optimize (optimized);
+
+            std::string error = Compiler::verifyOptimized (code, optimized);
+
+            if (error.empty())
             {
-                // error has already been reported via error handler
-                Success = false;
+                if (verbose)
+                    output
+                        << "optimized script: " << name << " (" << code[0] << " -> "
+                        << optimized[0] << " instructions)" << std::endl;
+
+                code.swap (optimized);
             }
-            catch (const std::exception& error)
+            else
+                errors
+                    << "optimizing script " << name << " failed, using unoptimized code: "
+                    << error << std::endl;
+        }
+
+        locals = parser.getLocals();
+
+        // TODO sanity check on generated locals
+
+        return true;
+    }
+
+    struct CompileJob
+    {
+        const ESM::Script *mScript;
+        Hash mHash;
+        bool mSuccess;
+        std::vector<Interpreter::Type_Code> mByteCode;
+        Compiler::Locals mLocals;
+        std::string mOutput;
+        std::string mErrors;
+    };
+
+    /// Hands out scripts to worker threads. Each worker compiles with its own scanner, parser
+    /// and error handler; messages are collected per script and reported by the main thread.
+    class CompileQueue
+    {
+            std::vector<CompileJob>& mJobs;
+            Compiler::Context& mContext;
+            bool mVerbose;
+            bool mOptimize;
+
+            boost::mutex mMutex;
+            std::size_t mNext;
+
+        public:
+
+            CompileQueue (std::vector<CompileJob>& jobs, Compiler::Context& context,
+                bool verbose, bool optimize)
+            : mJobs (jobs), mContext (context), mVerbose (verbose), mOptimize (optimize), mNext (0)
+            {}
+
+            // boost::thread entry point
+            void work()
             {
-                std::cerr << "An exception has been thrown: " << error.what() << std::endl;
-                Success = false;
+                std::ostringstream errors;
+                Compiler::StreamErrorHandler errorHandler (errors);
+                Compiler::FileParser parser (errorHandler, mContext);
+
+                while (true)
+                {
+                    std::size_t index;
+                    {
+                        boost::lock_guard<boost::mutex> lock (mMutex);
+                        if (mNext==mJobs.size())
+                            return;
+                        index = mNext++;
+                    }
+
+                    CompileJob& job = mJobs[index];
+
+                    std::ostringstream output;
+                    errors.str ("");
+
+                    job.mSuccess = compileScript (*job.mScript, parser, errorHandler, mContext,
+                        mVerbose, mOptimize, output, errors, job.mByteCode, job.mLocals);
+
+                    job.mOutput = output.str();
+                    job.mErrors = errors.str();
+                }
             }
+    };
+
+    template<typename T>
+    void writeValue (std::ostream& stream, const T& value)
+    {
+        stream.write (reinterpret_cast<const char *> (&value), sizeof (T));
+    }
+
+    template<typename T>
+    void readValue (std::istream& stream, T& value)
+    {
+        stream.read (reinterpret_cast<char *> (&value), sizeof (T));
+
+        if (!stream)
+            throw std::runtime_error ("unexpected end of file");
+    }
+
+    void writeString (std::ostream& stream, const std::string& string)
+    {
+        writeValue (stream, static_cast<boost::uint32_t> (string.size()));
+        stream.write (string.c_str(), string.size());
+    }
+
+    void readString (std::istream& stream, std::string& string)
+    {
+        boost::uint32_t size;
+        readValue (stream, size);
+
+        std::vector<char> buffer (size);
+
+        if (size)
+        {
+            stream.read (&buffer[0], size);
 
-            if (!Success && mVerbose)
+            if (!stream)
+                throw std::runtime_error ("unexpected end of file");
+        }
+
+        string.assign (buffer.begin(), buffer.end());
+    }
+
+    struct ProfileEntry
+    {
+        std::string mName;
+        int mCalls;
+        double mTotal;
+        double mMax;
+    };
+
+    bool compareProfileEntries (const ProfileEntry& left, const ProfileEntry& right)
+    {
+        return left.mTotal>right.mTotal;
+    }
+
+    std::string quoteCsv (const std::string& value)
+    {
+        if (value.find_first_of (",\"\n")==std::string::npos)
+            return value;
+
+        std::string quoted = "\"";
+
+        for (std::size_t i=0; i<value.size(); ++i)
+        {
+            if (value[i]=='"')
+                quoted += '"';
+
+            quoted += value[i];
+        }
+
+        return quoted + "\"";
+    }
+
+    std::string quoteJson (const std::string& value)
+    {
+        std::ostringstream quoted;
+        quoted << '"';
+
+        for (std::size_t i=0; i<value.size(); ++i)
+        {
+            unsigned char c = static_cast<unsigned char> (value[i]);
+
+            if (c=='"' || c=='\\')
+                quoted << '\\' << c;
+            else if (c<0x20)
             {
-                std::cerr
-                    << "compiling failed: " << name << std::endl
-                    << script->mScriptText
-                    << std::endl << std::endl;
+                const char *digits = "0123456789abcdef";
+                quoted << "\\u00" << digits[c>>4] << digits[c & 0xf];
             }
+            else
+                quoted << c;
+        }
 
-            if (Success)
-            {
-                std::vector<Interpreter::Type_Code> code;
-                mParser.getCode (code);
-                mScripts.insert (std::make_pair (name, std::make_pair (code, mParser.getLocals())));
+        quoted << '"';
+        return quoted.str();
+    }
+}
+
+namespace MWScript
+{
+    ScriptManager::ScriptManager (const MWWorld::ESMStore& store, bool verbose, bool optimize,
+        Compiler::Context& compilerContext, const std::string& cacheFile)
+    : mErrorHandler (std::cerr), mStore (store), mVerbose (verbose), mOptimize (optimize),
+      mCompilerContext (compilerContext), mParser (mErrorHandler, mCompilerContext),
+      mOpcodesInstalled (false), mCacheFile (cacheFile), mGlobalScripts (store),
+      mProfiling (false)
+    {}
 
-                // TODO sanity check on generated locals
+    bool ScriptManager::compile (const std::string& name)
+    {
+        if (const ESM::Script *script = mStore.get<ESM::Script>().find (name))
+        {
+            std::vector<Interpreter::Type_Code> code;
+            Compiler::Locals locals;
 
+            if (compileScript (*script, mParser, mErrorHandler, mCompilerContext, mVerbose,
+                mOptimize, std::cout, std::cerr, code, locals))
+            {
+                mScripts.insert (std::make_pair (name, CompiledScript (code, locals)));
                 return true;
             }
         }
@@ -81,7 +347,7 @@ namespace MWScript
         return false;
     }
 
-    void ScriptManager::run (const std::string& name, Interpreter::Context& interpreterContext)
+    ScriptManager::CompiledScript& ScriptManager::getScript (const std::string& name)
     {
         // compile script
         ScriptCollection::iterator iter = mScripts.find (name);
@@ -92,16 +358,55 @@ namespace MWScript
             {
                 // failed -> ignore script from now on.
                 std::vector<Interpreter::Type_Code> empty;
-                mScripts.insert (std::make_pair (name, std::make_pair (empty, Compiler::Locals())));
-                return;
+                return mScripts.insert (
+                    std::make_pair (name, CompiledScript (empty, Compiler::Locals()))).first->second;
             }
 
             iter = mScripts.find (name);
             assert (iter!=mScripts.end());
         }
 
+        return iter->second;
+    }
+
+    void ScriptManager::run (const std::string& name, Interpreter::Context& interpreterContext)
+    {
+        execute (name, getScript (name), interpreterContext);
+    }
+
+    int ScriptManager::getScriptHandle (const std::string& name)
+    {
+        std::map<std::string, int>::iterator iter = mHandleIndices.find (name);
+
+        if (iter!=mHandleIndices.end())
+            return iter->second;
+
+        ScriptHandle handle;
+        handle.mName = name;
+        handle.mScript = 0;
+        mHandles.push_back (handle);
+
+        int index = static_cast<int> (mHandles.size())-1;
+        mHandleIndices.insert (std::make_pair (name, index));
+        return index;
+    }
+
+    void ScriptManager::run (int handle, Interpreter::Context& interpreterContext)
+    {
+        ScriptHandle& entry = mHandles.at (handle);
+
+        // map entries do not move, so the compiled script can be remembered
+        if (!entry.mScript)
+            entry.mScript = &getScript (entry.mName);
+
+        execute (entry.mName, *entry.mScript, interpreterContext);
+    }
+
+    void ScriptManager::execute (const std::string& name, CompiledScript& script,
+        Interpreter::Context& interpreterContext)
+    {
         // execute script
-        if (!iter->second.first.empty())
+        if (!script.mByteCode.empty())
             try
             {
                 if (!mOpcodesInstalled)
@@ -110,7 +415,15 @@ namespace MWScript
                     mOpcodesInstalled = true;
                 }
 
-                mInterpreter.run (&iter->second.first[0], iter->second.first.size(), interpreterContext);
+                std::vector<Interpreter::Type_Code>& code = script.mByteCode;
+
+                if (script.mProgram.empty())
+                    mInterpreter.decode (&code[0], code.size(), script.mProgram);
+
+                if (mProfiling)
+                    runProfiled (name, script, interpreterContext);
+                else
+                    mInterpreter.run (&code[0], code.size(), script.mProgram, interpreterContext);
             }
             catch (const std::exception& e)
             {
@@ -119,32 +432,366 @@ namespace MWScript
                 if (mVerbose)
                     std::cerr << "(" << e.what() << ")" << std::endl;
 
-                iter->second.first.clear(); // don't execute again.
+                script.mByteCode.clear(); // don't execute again.
+                script.mProgram.clear();
             }
     }
 
+    void ScriptManager::runProfiled (const std::string& name, CompiledScript& script,
+        Interpreter::Context& interpreterContext)
+    {
+        std::vector<Interpreter::Type_Code>& code = script.mByteCode;
+
+        ScriptProfile& profile = mProfile[name];
+
+        if (profile.mInstructionCounts.size()!=code[0])
+        {
+            profile.mByteCode = code;
+            profile.mInstructionCounts.assign (code[0], 0);
+        }
+
+        boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+        mInterpreter.run (&code[0], code.size(), script.mProgram, interpreterContext,
+            profile.mInstructionCounts.empty() ? 0 : &profile.mInstructionCounts[0]);
+
+        double time =
+            (boost::posix_time::microsec_clock::universal_time()-start).total_microseconds() / 1e6;
+
+        ++profile.mCalls;
+        profile.mTotal += time;
+        profile.mMax = std::max (profile.mMax, time);
+    }
+
     std::pair<int, int> ScriptManager::compileAll()
     {
         int count = 0;
         int success = 0;
 
+        const Hash context = getContextHash();
+
+        CachedScripts cache;
+        CachedFailures failures;
+        loadCache (context, cache, failures);
+
+        CachedScripts used; // cache content for the next start
+        CachedFailures usedFailures;
+        bool changed = false;
+        std::vector<CompileJob> jobs;
+
         const MWWorld::Store<ESM::Script>& scripts = mStore.get<ESM::Script>();
         MWWorld::Store<ESM::Script>::iterator it = scripts.begin();
 
         for (; it != scripts.end(); ++it, ++count)
-            if (compile (it->mId))
+        {
+            const Hash hash = hashString (it->mScriptText, 0);
+
+            ScriptCollection::const_iterator iter = mScripts.find (it->mId);
+
+            if (iter!=mScripts.end())
+            {
+                // already compiled on demand
+                if (!iter->second.mByteCode.empty())
+                {
+                    ++success;
+                    used.insert (std::make_pair (hash, iter->second));
+
+                    if (cache.find (hash)==cache.end())
+                        changed = true;
+                }
+
+                continue;
+            }
+
+            CachedScripts::const_iterator cached = cache.find (hash);
+
+            if (cached!=cache.end())
+            {
+                if (mVerbose)
+                    std::cout << "loaded cached script: " << it->mId << std::endl;
+
+                mScripts.insert (std::make_pair (it->mId, cached->second));
+                used.insert (*cached);
                 ++success;
+                continue;
+            }
+
+            CachedFailures::const_iterator failed = failures.find (hash);
+
+            if (failed!=failures.end())
+            {
+                // failed last time and the script has not changed -> report again, but don't
+                // recompile
+                std::cerr << failed->second;
+
+                std::vector<Interpreter::Type_Code> empty;
+                mScripts.insert (std::make_pair (it->mId, CompiledScript (empty, Compiler::Locals())));
+                usedFailures.insert (*failed);
+                continue;
+            }
+
+            CompileJob job;
+            job.mScript = &*it;
+            job.mHash = hash;
+            job.mSuccess = false;
+            jobs.push_back (job);
+        }
+
+        if (!jobs.empty())
+        {
+            CompileQueue queue (jobs, mCompilerContext, mVerbose, mOptimize);
+
+            std::size_t threads = std::max (1u, boost::thread::hardware_concurrency());
+            threads = std::min (threads, jobs.size());
+
+            boost::thread_group workers;
+            for (std::size_t i=0; i<threads; ++i)
+                workers.create_thread (boost::bind (&CompileQueue::work, &queue));
+
+            workers.join_all();
+
+            // report and store in script order
+            for (std::vector<CompileJob>::const_iterator job = jobs.begin(); job!=jobs.end(); ++job)
+            {
+                std::cout << job->mOutput;
+                std::cerr << job->mErrors;
+
+                if (job->mSuccess)
+                {
+                    CompiledScript script (job->mByteCode, job->mLocals);
+                    mScripts.insert (std::make_pair (job->mScript->mId, script));
+                    used.insert (std::make_pair (job->mHash, script));
+                    ++success;
+                }
+                else
+                {
+                    // failed -> ignore script from now on (the error has been reported already)
+                    std::vector<Interpreter::Type_Code> empty;
+                    mScripts.insert (std::make_pair (job->mScript->mId,
+                        CompiledScript (empty, Compiler::Locals())));
+                    usedFailures.insert (std::make_pair (job->mHash, job->mErrors));
+                }
+            }
+        }
+
+        if (changed || !jobs.empty() || used.size()!=cache.size() ||
+            usedFailures.size()!=failures.size())
+            writeCache (context, used, usedFailures);
 
         return std::make_pair (count, success);
     }
 
+    boost::uint64_t ScriptManager::getContextHash() const
+    {
+        // Compiled code depends on the layout of the global variables, on the local variables of
+        // other scripts and on which script is assigned to an object (member access) and on the
+        // set of IDs that can be referenced.
+        Hash hash = hashValue (sScriptCacheVersion, 14695981039346656037ULL);
+        hash = hashValue (mOptimize, hash);
+
+        const MWWorld::Store<ESM::Global>& globals = mStore.get<ESM::Global>();
+
+        for (MWWorld::Store<ESM::Global>::iterator it = globals.begin(); it!=globals.end(); ++it)
+        {
+            hash = hashString (it->mId, hash);
+            hash = hashValue (static_cast<int> (it->mValue.getType()), hash);
+        }
+
+        const MWWorld::Store<ESM::Script>& scripts = mStore.get<ESM::Script>();
+
+        for (MWWorld::Store<ESM::Script>::iterator it = scripts.begin(); it!=scripts.end(); ++it)
+        {
+            hash = hashString (it->mId, hash);
+            hash = hashValue (it->mData.mNumShorts, hash);
+            hash = hashValue (it->mData.mNumLongs, hash);
+            hash = hashValue (it->mData.mNumFloats, hash);
+
+            for (std::vector<std::string>::const_iterator iter = it->mVarNames.begin();
+                iter!=it->mVarNames.end(); ++iter)
+                hash = hashString (*iter, hash);
+        }
+
+        const MWWorld::ESMStore& store = mStore;
+
+        hash = hashScriptedIds (store.get<ESM::Activator>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Potion>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Apparatus>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Armor>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Book>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Clothing>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Container>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Creature>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Door>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Ingredient>(), hash);
+        hash = hashIds (store.get<ESM::CreatureLevList>(), hash);
+        hash = hashIds (store.get<ESM::ItemLevList>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Light>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Lockpick>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Miscellaneous>(), hash);
+        hash = hashScriptedIds (store.get<ESM::NPC>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Probe>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Repair>(), hash);
+        hash = hashIds (store.get<ESM::Static>(), hash);
+        hash = hashScriptedIds (store.get<ESM::Weapon>(), hash);
+
+        return hash;
+    }
+
+    void ScriptManager::loadCache (boost::uint64_t context, CachedScripts& cache,
+        CachedFailures& failures) const
+    {
+        if (mCacheFile.empty() || !boost::filesystem::exists (mCacheFile))
+            return;
+
+        try
+        {
+            std::ifstream stream (mCacheFile.c_str(), std::ios::in | std::ios::binary);
+
+            int version;
+            readValue (stream, version);
+
+            Hash hash;
+            readValue (stream, hash);
+
+            if (version!=sScriptCacheVersion || hash!=context)
+            {
+                std::cout << "Scripts have changed, ignoring script cache " << mCacheFile << std::endl;
+                return;
+            }
+
+            boost::uint32_t count;
+            readValue (stream, count);
+
+            for (boost::uint32_t i=0; i<count; ++i)
+            {
+                Hash textHash;
+                readValue (stream, textHash);
+
+                boost::uint32_t size;
+                readValue (stream, size);
+
+                std::vector<Interpreter::Type_Code> code (size);
+
+                for (boost::uint32_t j=0; j<size; ++j)
+                    readValue (stream, code[j]);
+
+                Compiler::Locals locals;
+
+                const char types[3] = { 's', 'l', 'f' };
+
+                for (int j=0; j<3; ++j)
+                {
+                    boost::uint32_t variables;
+                    readValue (stream, variables);
+
+                    for (boost::uint32_t k=0; k<variables; ++k)
+                    {
+                        std::string name;
+                        readString (stream, name);
+                        locals.declare (types[j], name);
+                    }
+                }
+
+                cache.insert (std::make_pair (textHash, CompiledScript (code, locals)));
+            }
+
+            readValue (stream, count);
+
+            for (boost::uint32_t i=0; i<count; ++i)
+            {
+                Hash textHash;
+                readValue (stream, textHash);
+
+                std::string errors;
+                readString (stream, errors);
+
+                failures.insert (std::make_pair (textHash, errors));
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to read script cache " << mCacheFile << ": " << e.what() << std::endl;
+            cache.clear();
+            failures.clear();
+        }
+    }
+
+    void ScriptManager::writeCache (boost::uint64_t context, const CachedScripts& cache,
+        const CachedFailures& failures) const
+    {
+        if (mCacheFile.empty())
+            return;
+
+        // Write to a temporary file first, so that an interrupted write can not leave a cache
+        // with a valid key behind.
+        boost::filesystem::path file (mCacheFile);
+        boost::filesystem::path tmp = file;
+        tmp += ".tmp";
+
+        try
+        {
+            boost::filesystem::create_directories (file.parent_path());
+
+            std::ofstream stream (tmp.string().c_str(),
+                std::ios::out | std::ios::binary | std::ios::trunc);
+
+            writeValue (stream, sScriptCacheVersion);
+            writeValue (stream, context);
+            writeValue (stream, static_cast<boost::uint32_t> (cache.size()));
+
+            for (CachedScripts::const_iterator iter = cache.begin(); iter!=cache.end(); ++iter)
+            {
+                writeValue (stream, iter->first);
+
+                const std::vector<Interpreter::Type_Code>& code = iter->second.mByteCode;
+                writeValue (stream, static_cast<boost::uint32_t> (code.size()));
+
+                for (std::vector<Interpreter::Type_Code>::const_iterator word = code.begin();
+                    word!=code.end(); ++word)
+                    writeValue (stream, *word);
+
+                const char types[3] = { 's', 'l', 'f' };
+
+                for (int j=0; j<3; ++j)
+                {
+                    const std::vector<std::string>& names = iter->second.mLocals.get (types[j]);
+                    writeValue (stream, static_cast<boost::uint32_t> (names.size()));
+
+                    for (std::vector<std::string>::const_iterator name = names.begin();
+                        name!=names.end(); ++name)
+                        writeString (stream, *name);
+                }
+            }
+
+            writeValue (stream, static_cast<boost::uint32_t> (failures.size()));
+
+            for (CachedFailures::const_iterator iter = failures.begin(); iter!=failures.end(); ++iter)
+            {
+                writeValue (stream, iter->first);
+                writeString (stream, iter->second);
+            }
+
+            stream.close();
+            if (!stream)
+                throw std::runtime_error ("write error");
+
+            boost::filesystem::rename (tmp, file);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to write script cache " << mCacheFile << ": " << e.what() << std::endl;
+            boost::system::error_code ec;
+            boost::filesystem::remove (tmp, ec);
+        }
+    }
+
     Compiler::Locals& ScriptManager::getLocals (const std::string& name)
     {
         {
             ScriptCollection::iterator iter = mScripts.find (name);
 
             if (iter!=mScripts.end())
-                return iter->second.second;
+                return iter->second.mLocals;
         }
 
         {
@@ -183,48 +830,195 @@ namespace MWScript
         return mGlobalScripts;
     }
 
-    int ScriptManager::getLocalIndex (const std::string& scriptId, const std::string& variable,
-        char type)
+    const ScriptManager::ScriptVariables& ScriptManager::getVariables (const std::string& scriptId)
     {
-        const ESM::Script *script = mStore.get<ESM::Script>().find (scriptId);
+        std::map<std::string, ScriptVariables>::iterator iter = mVariables.find (scriptId);
+
+        if (iter!=mVariables.end())
+            return iter->second;
 
-        int offset = 0;
-        int size = 0;
+        iter = mVariables.insert (std::make_pair (scriptId, ScriptVariables())).first;
 
-        switch (type)
+        if (const ESM::Script *script = mStore.get<ESM::Script>().search (scriptId))
         {
-            case 's':
+            ScriptVariables& variables = iter->second;
 
-                offset = 0;
-                size = script->mData.mNumShorts;
-                break;
+            const int counts[3] =
+            {
+                script->mData.mNumShorts, script->mData.mNumLongs, script->mData.mNumFloats
+            };
 
-            case 'l':
+            const char types[3] = { 's', 'l', 'f' };
 
-                offset = script->mData.mNumShorts;
-                size = script->mData.mNumLongs;
-                break;
+            int offset = 0;
+
+            for (int i=0; i<3; ++i)
+            {
+                for (int index=0; index<counts[i]; ++index)
+                {
+                    if (offset+index>=static_cast<int> (script->mVarNames.size()))
+                        break;
 
-            case 'f':
+                    LocalVariable variable;
+                    variable.mType = types[i];
+                    variable.mIndex = index;
 
-                offset = script->mData.mNumShorts+script->mData.mNumLongs;
-                size = script->mData.mNumFloats;
-                break;
+                    std::map<std::string, LocalVariable>::iterator entry =
+                        variables.mVariables.insert (std::make_pair (
+                        Misc::StringUtils::lowerCase (script->mVarNames[offset+index]), variable)).first;
 
-            default:
+                    variables.mIndex.insert (entry->first, &entry->second);
+                }
 
-                throw std::runtime_error ("invalid variable type");
+                offset += counts[i];
+            }
         }
 
-        for (int i=0; i<size; ++i)
-            if (script->mVarNames.at (i+offset)==variable)
-                return i;
+        return iter->second;
+    }
+
+    int ScriptManager::getLocalIndex (const std::string& scriptId, const std::string& variable,
+        char type)
+    {
+        int index = 0;
+
+        if (getLocalType (scriptId, variable, index)!=type)
+            throw std::runtime_error (
+                "unable to access local variable " + variable + " of " + scriptId);
 
-        throw std::runtime_error ("unable to access local variable " + variable + " of " + scriptId);
+        return index;
+    }
+
+    char ScriptManager::getLocalType (const std::string& scriptId, const std::string& variable,
+        int& index)
+    {
+        if (const LocalVariable *entry = getVariables (scriptId).mIndex.find (variable))
+        {
+            index = entry->mIndex;
+            return entry->mType;
+        }
+
+        return ' ';
     }
 
     void ScriptManager::resetGlobalScripts()
     {
         mGlobalScripts.reset();
     }
+
+    void ScriptManager::setProfiling (bool enable)
+    {
+        mProfiling = enable;
+    }
+
+    bool ScriptManager::isProfiling() const
+    {
+        return mProfiling;
+    }
+
+    bool ScriptManager::writeProfile (std::ostream& stream, ProfileFormat format) const
+    {
+        if (mProfile.empty())
+            return false;
+
+        std::vector<ProfileEntry> scripts;
+        int calls = 0;
+
+        // key: segment, opcode
+        std::map<std::pair<int, int>, unsigned long> opcodes;
+
+        for (std::map<std::string, ScriptProfile>::const_iterator iter (mProfile.begin());
+            iter!=mProfile.end(); ++iter)
+        {
+            const ScriptProfile& profile = iter->second;
+
+            ProfileEntry entry;
+            entry.mName = iter->first;
+            entry.mCalls = profile.mCalls;
+            entry.mTotal = profile.mTotal;
+            entry.mMax = profile.mMax;
+            scripts.push_back (entry);
+
+            calls += profile.mCalls;
+
+            for (std::size_t i=0; i<profile.mInstructionCounts.size(); ++i)
+            {
+                int segment = 0;
+                int opcode = 0;
+
+                if (profile.mInstructionCounts[i] &&
+                    Interpreter::Interpreter::getOpcode (profile.mByteCode[4+i], segment, opcode))
+                    opcodes[std::make_pair (segment, opcode)] += profile.mInstructionCounts[i];
+            }
+        }
+
+        std::stable_sort (scripts.begin(), scripts.end(), compareProfileEntries);
+
+        switch (format)
+        {
+            case Profile_Summary:
+            {
+                stream
+                    << "Script profile: " << scripts.size() << " scripts, " << calls << " calls"
+                    << std::endl;
+
+                for (std::size_t i=0; i<scripts.size() && i<10; ++i)
+                    stream
+                        << scripts[i].mName << ": " << scripts[i].mCalls << " calls, "
+                        << scripts[i].mTotal*1000 << " ms total, "
+                        << scripts[i].mMax*1000 << " ms max" << std::endl;
+
+                break;
+            }
+
+            case Profile_Csv:
+            {
+                stream << "type,name,count,total_ms,max_ms" << std::endl;
+
+                for (std::vector<ProfileEntry>::const_iterator iter (scripts.begin());
+                    iter!=scripts.end(); ++iter)
+                    stream
+                        << "script," << quoteCsv (iter->mName) << "," << iter->mCalls << ","
+                        << iter->mTotal*1000 << "," << iter->mMax*1000 << std::endl;
+
+                for (std::map<std::pair<int, int>, unsigned long>::const_iterator iter (opcodes.begin());
+                    iter!=opcodes.end(); ++iter)
+                    stream
+                        << "opcode," << iter->first.first << ":0x" << std::hex << iter->first.second
+                        << std::dec << "," << iter->second << ",," << std::endl;
+
+                break;
+            }
+
+            case Profile_Json:
+            {
+                stream << "{" << std::endl << "  \"scripts\": [";
+
+                for (std::vector<ProfileEntry>::const_iterator iter (scripts.begin());
+                    iter!=scripts.end(); ++iter)
+                    stream
+                        << (iter==scripts.begin() ? "" : ",") << std::endl
+                        << "    { \"name\": " << quoteJson (iter->mName)
+                        << ", \"calls\": " << iter->mCalls
+                        << ", \"total_ms\": " << iter->mTotal*1000
+                        << ", \"max_ms\": " << iter->mMax*1000 << " }";
+
+                stream << std::endl << "  ]," << std::endl << "  \"opcodes\": [";
+
+                for (std::map<std::pair<int, int>, unsigned long>::const_iterator iter (opcodes.begin());
+                    iter!=opcodes.end(); ++iter)
+                    stream
+                        << (iter==opcodes.begin() ? "" : ",") << std::endl
+                        << "    { \"segment\": " << iter->first.first
+                        << ", \"opcode\": " << iter->first.second
+                        << ", \"count\": " << iter->second << " }";
+
+                stream << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+                break;
+            }
+        }
+
+        return true;
+    }
 }
@@ -3,6 +3,9 @@
 
 #include <map>
 #include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
 
 #include <components/compiler/streamerrorhandler.hpp>
 #include <components/compiler/fileparser.hpp>
@@ -10,6 +13,8 @@
 #include <components/interpreter/interpreter.hpp>
 #include <components/interpreter/types.hpp>
 
+#include <components/misc/stringindex.hpp>
+
 #include "../mwbase/scriptmanager.hpp"
 
 #include "globalscripts.hpp"
@@ -37,26 +42,112 @@ namespace MWScript
             Compiler::StreamErrorHandler mErrorHandler;
             const MWWorld::ESMStore& mStore;
             bool mVerbose;
+            bool mOptimize;
             Compiler::Context& mCompilerContext;
             Compiler::FileParser mParser;
             Interpreter::Interpreter mInterpreter;
             bool mOpcodesInstalled;
+            std::string mCacheFile;
+
+            struct CompiledScript
+            {
+                std::vector<Interpreter::Type_Code> mByteCode;
+                Compiler::Locals mLocals;
+                Interpreter::Program mProgram; ///< mByteCode decoded for mInterpreter on first run
+
+                CompiledScript (const std::vector<Interpreter::Type_Code>& byteCode,
+                    const Compiler::Locals& locals)
+                : mByteCode (byteCode), mLocals (locals)
+                {}
+            };
 
-            typedef std::pair<std::vector<Interpreter::Type_Code>, Compiler::Locals> CompiledScript;
             typedef std::map<std::string, CompiledScript> ScriptCollection;
 
+            struct ScriptHandle
+            {
+                std::string mName;
+                CompiledScript *mScript; ///< 0 until the script is looked up for the first time
+            };
+
+            struct LocalVariable
+            {
+                char mType;
+                int mIndex;
+            };
+
+            /// Local variables of a script, resolved on first access
+            struct ScriptVariables
+            {
+                std::map<std::string, LocalVariable> mVariables; // key: lower case name
+                Misc::StringIndex<LocalVariable> mIndex;
+            };
+
+            typedef std::map<boost::uint64_t, CompiledScript> CachedScripts; // key: script text hash
+
+            /// Scripts that failed to compile (key: script text hash, value: error messages)
+            typedef std::map<boost::uint64_t, std::string> CachedFailures;
+
+            struct ScriptProfile
+            {
+                int mCalls;
+                double mTotal; ///< seconds
+                double mMax; ///< seconds
+                std::vector<Interpreter::Type_Code> mByteCode; ///< for decoding mInstructionCounts
+                std::vector<unsigned int> mInstructionCounts;
+
+                ScriptProfile() : mCalls (0), mTotal (0), mMax (0) {}
+            };
+
             ScriptCollection mScripts;
+            std::vector<ScriptHandle> mHandles;
+            std::map<std::string, int> mHandleIndices;
             GlobalScripts mGlobalScripts;
             std::map<std::string, Compiler::Locals> mOtherLocals;
+            std::map<std::string, ScriptVariables> mVariables;
+            bool mProfiling;
+            std::map<std::string, ScriptProfile> mProfile;
+
+            const ScriptVariables& getVariables (const std::string& scriptId);
+
+            CompiledScript& getScript (const std::string& name);
+            ///< Compile script, if not compiled yet (scripts that fail to compile are replaced by
+            /// empty code).
+
+            void execute (const std::string& name, CompiledScript& script,
+                Interpreter::Context& interpreterContext);
+
+            void runProfiled (const std::string& name, CompiledScript& script,
+                Interpreter::Context& interpreterContext);
+
+            boost::uint64_t getContextHash() const;
+            ///< Hash of everything besides the script text that affects compiled code.
+
+            void loadCache (boost::uint64_t context, CachedScripts& cache,
+                CachedFailures& failures) const;
+            ///< Read cached scripts and compile failures, if the cache has been written for
+            /// \a context.
+
+            void writeCache (boost::uint64_t context, const CachedScripts& cache,
+                const CachedFailures& failures) const;
 
         public:
 
-            ScriptManager (const MWWorld::ESMStore& store, bool verbose,
-                Compiler::Context& compilerContext);
+            ScriptManager (const MWWorld::ESMStore& store, bool verbose, bool optimize,
+                Compiler::Context& compilerContext, const std::string& cacheFile = "");
+            ///< \param optimize Run the bytecode optimizer on compiled scripts?
+            /// \param cacheFile Bytecode cache used by compileAll (empty: no cache)
 
             virtual void run (const std::string& name, Interpreter::Context& interpreterContext);
             ///< Run the script with the given name (compile first, if not compiled yet)
 
+            virtual int getScriptHandle (const std::string& name);
+            ///< Return a handle for running the script with the given name repeatedly without a
+            /// name lookup. The script does not need to be compiled yet. Handles stay valid for the
+            /// lifetime of the script manager.
+
+            virtual void run (int handle, Interpreter::Context& interpreterContext);
+            ///< Run the script with the given handle (compile first, if not compiled yet)
+
             virtual bool compile (const std::string& name);
             ///< Compile script with the given namen
             /// \return Success?
@@ -64,7 +155,10 @@ namespace MWScript
             virtual void resetGlobalScripts();
 
             virtual std::pair<int, int> compileAll();
-            ///< Compile all scripts
+            ///< Compile all scripts that have not been compiled yet, in parallel. Scripts whose
+            /// text has not changed since the last call are loaded from the bytecode cache (scripts
+            /// that failed to compile are not compiled again, their errors are reported again).
+            /// \note Compiler context calls may come from several threads at once.
             /// \return count, success
 
             virtual Compiler::Locals& getLocals (const std::string& name);
@@ -76,6 +170,21 @@ namespace MWScript
                 char type);
             ///< Return index of the variable of the given name and type in the given script. Will
             /// throw an exception, if there is no such script or variable or the type does not match.
+
+            virtual char getLocalType (const std::string& scriptId, const std::string& variable,
+                int& index);
+            ///< Return type ('s', 'l', 'f') of the variable of the given name (case insensitive) in
+            /// the given script and store its index in \a index. Resolved variables are cached.
+            /// \return ' ', if there is no such script or variable.
+
+            virtual void setProfiling (bool enable);
+            ///< Collect call counts and execution times of scripts and counts of executed opcodes?
+
+            virtual bool isProfiling() const;
+
+            virtual bool writeProfile (std::ostream& stream, ProfileFormat format) const;
+            ///< Write the data collected while profiling was enabled.
+            /// \return Has any data been collected?
     };
 }
 
@@ -0,0 +1,370 @@
+#include "cellpreloader.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+
+#include <boost/bind.hpp>
+
+#include <components/esm/loadcell.hpp>
+#include <components/misc/stringops.hpp>
+
+#include "../mwbase/environment.hpp"
+#include "../mwbase/world.hpp"
+
+#include "cells.hpp"
+#include "cellstore.hpp"
+#include "class.hpp"
+
+namespace
+{
+    // Meshes can only be parsed in the background, if Ogre's resource system is thread safe.
+#if OGRE_THREAD_SUPPORT
+    const bool sParseMeshes = true;
+#else
+    const bool sParseMeshes = false;
+#endif
+
+    template<typename T>
+    void listMeshes (MWWorld::CellRefList<T>& cellRefList, MWWorld::CellStore& cell,
+        std::set<std::string>& meshes)
+    {
+        for (typename MWWorld::CellRefList<T>::List::iterator iter (cellRefList.mList.begin());
+            iter!=cellRefList.mList.end(); ++iter)
+        {
+            if (iter->mData.getCount() && iter->mData.isEnabled())
+            {
+                MWWorld::Ptr ptr (&*iter, &cell);
+
+                std::string model = MWWorld::Class::get (ptr).getModel (ptr);
+
+                // same name as used by the NIF loaders
+                if (!model.empty())
+                    meshes.insert (Misc::StringUtils::lowerCase (model));
+            }
+        }
+    }
+
+    std::vector<std::string> listMeshes (MWWorld::CellStore& cell)
+    {
+        std::set<std::string> meshes;
+
+        listMeshes (cell.mActivators, cell, meshes);
+        listMeshes (cell.mPotions, cell, meshes);
+        listMeshes (cell.mAppas, cell, meshes);
+        listMeshes (cell.mArmors, cell, meshes);
+        listMeshes (cell.mBooks, cell, meshes);
+        listMeshes (cell.mClothes, cell, meshes);
+        listMeshes (cell.mContainers, cell, meshes);
+        listMeshes (cell.mDoors, cell, meshes);
+        listMeshes (cell.mIngreds, cell, meshes);
+        listMeshes (cell.mLights, cell, meshes);
+        listMeshes (cell.mLockpicks, cell, meshes);
+        listMeshes (cell.mMiscItems, cell, meshes);
+        listMeshes (cell.mProbes, cell, meshes);
+        listMeshes (cell.mRepairs, cell, meshes);
+        listMeshes (cell.mStatics, cell, meshes);
+        listMeshes (cell.mWeapons, cell, meshes);
+        listMeshes (cell.mCreatures, cell, meshes);
+        listMeshes (cell.mNpcs, cell, meshes);
+
+        return std::vector<std::string> (meshes.begin(), meshes.end());
+    }
+
+    /// Larger movements within one frame are teleports and are not extrapolated.
+    const float sMaxFrameDistance = 8192;
+}
+
+namespace MWWorld
+{
+    CellPreloader::CellPreloader (Cells& cells, const ESMStore& store,
+        const std::vector<ESM::ESMReader>& readers, const ToUTF8::Utf8Encoder& encoder,
+        int budget, float lookAhead)
+    : mCells (cells), mStore (store), mBudget (std::max (budget, 0)), mLookAhead (lookAhead),
+      mHaveLastPosition (false), mGeneration (0), mReaders (readers), mEncoder (encoder),
+      mQuit (false)
+    {
+        // The copies share the open files with the main thread's readers. Drop them, so that
+        // the worker opens its own when restoring a cell's context.
+        for (std::vector<ESM::ESMReader>::iterator iter (mReaders.begin());
+            iter!=mReaders.end(); ++iter)
+        {
+            iter->close();
+            iter->setEncoder (&mEncoder);
+        }
+
+        mThread = boost::thread (boost::bind (&CellPreloader::work, this));
+    }
+
+    CellPreloader::~CellPreloader()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock (mMutex);
+            mQuit = true;
+        }
+
+        mJobAdded.notify_all();
+        mThread.join();
+    }
+
+    void CellPreloader::work()
+    {
+        while (true)
+        {
+            Job job;
+
+            {
+                boost::unique_lock<boost::mutex> lock (mMutex);
+
+                while (mJobs.empty() && !mQuit)
+                    mJobAdded.wait (lock);
+
+                if (mQuit)
+                    return;
+
+                job = mJobs.front();
+                mJobs.pop_front();
+            }
+
+            Result result;
+            result.mGeneration = job.mGeneration;
+            result.mX = job.mX;
+            result.mY = job.mY;
+            result.mRefsRead = false;
+
+            try
+            {
+                processJob (job, result);
+            }
+            catch (const std::exception& e)
+            {
+                // the cell will be loaded synchronously instead
+                std::cerr
+                    << "failed to preload cell " << job.mX << ", " << job.mY << ": " << e.what()
+                    << std::endl;
+
+                result.mRefsRead = false;
+                result.mRefs.clear();
+            }
+
+            boost::lock_guard<boost::mutex> lock (mMutex);
+            mResults.push_back (result);
+        }
+    }
+
+    void CellPreloader::processJob (Job& job, Result& result)
+    {
+        if (job.mCell)
+        {
+            CellStore::readRefs (*job.mCell, mReaders, result.mRefs);
+            result.mRefsRead = true;
+            return;
+        }
+
+        for (std::vector<std::string>::const_iterator iter (job.mMeshes.begin());
+            iter!=job.mMeshes.end(); ++iter)
+        {
+            try
+            {
+                result.mMeshes.push_back (Nif::NIFFile::create (*iter));
+            }
+            catch (const std::exception&)
+            {
+                // reported when the main thread loads the mesh
+            }
+        }
+    }
+
+    void CellPreloader::addJob (const Job& job)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock (mMutex);
+            mJobs.push_back (job);
+        }
+
+        mJobAdded.notify_one();
+    }
+
+    void CellPreloader::request (int x, int y)
+    {
+        std::pair<int, int> key (x, y);
+
+        if (mEntries.find (key)!=mEntries.end())
+            return;
+
+        CellStore *cell = mCells.searchExterior (x, y);
+
+        // cells created on the fly have no references
+        if (!cell || cell->mCell->mContextList.empty())
+            return;
+
+        Job job;
+        job.mGeneration = mGeneration;
+        job.mX = x;
+        job.mY = y;
+        job.mCell = 0;
+
+        Entry& entry = mEntries[key];
+
+        if (cell->mState!=CellStore::State_Loaded)
+        {
+            entry.mState = State_ReadingRefs;
+            job.mCell = cell->mCell;
+        }
+        else if (sParseMeshes)
+        {
+            entry.mState = State_ParsingMeshes;
+            job.mMeshes = listMeshes (*cell);
+        }
+        else
+        {
+            entry.mState = State_Ready;
+            return;
+        }
+
+        addJob (job);
+    }
+
+    void CellPreloader::handleResult (Result& result)
+    {
+        if (result.mGeneration!=mGeneration)
+            return;
+
+        EntryMap::iterator iter = mEntries.find (std::make_pair (result.mX, result.mY));
+
+        if (iter==mEntries.end())
+            return; // dropped in the meantime
+
+        if (!result.mRefsRead)
+        {
+            iter->second.mMeshes.swap (result.mMeshes);
+            iter->second.mState = State_Ready;
+            return;
+        }
+
+        CellStore *cell = mCells.searchExterior (result.mX, result.mY);
+
+        if (cell->mState!=CellStore::State_Loaded)
+        {
+            cell->load (mStore, result.mRefs);
+            mCells.indexCell (*cell);
+        }
+
+        if (!sParseMeshes)
+        {
+            iter->second.mState = State_Ready;
+            return;
+        }
+
+        Job job;
+        job.mGeneration = mGeneration;
+        job.mX = result.mX;
+        job.mY = result.mY;
+        job.mCell = 0;
+        job.mMeshes = listMeshes (*cell);
+
+        iter->second.mState = State_ParsingMeshes;
+        addJob (job);
+    }
+
+    void CellPreloader::enforceBudget (int x, int y)
+    {
+        while (mEntries.size()>mBudget)
+        {
+            EntryMap::iterator farthest = mEntries.begin();
+            int farthestDistance = -1;
+
+            for (EntryMap::iterator iter (mEntries.begin()); iter!=mEntries.end(); ++iter)
+            {
+                int distance = std::max (std::abs (iter->first.first-x),
+                    std::abs (iter->first.second-y));
+
+                if (distance>farthestDistance)
+                {
+                    farthest = iter;
+                    farthestDistance = distance;
+                }
+            }
+
+            // pending work for this cell is discarded, when it is finished
+            mEntries.erase (farthest);
+        }
+    }
+
+    void CellPreloader::update (float duration, const Ogre::Vector3& playerPosition, bool exterior)
+    {
+        std::deque<Result> results;
+
+        {
+            boost::lock_guard<boost::mutex> lock (mMutex);
+            results.swap (mResults);
+        }
+
+        for (std::deque<Result>::iterator iter (results.begin()); iter!=results.end(); ++iter)
+            handleResult (*iter);
+
+        if (!exterior || mBudget==0)
+        {
+            mHaveLastPosition = false;
+            return;
+        }
+
+        Ogre::Vector3 velocity = Ogre::Vector3::ZERO;
+
+        if (mHaveLastPosition && duration>0 &&
+            playerPosition.distance (mLastPosition)<sMaxFrameDistance)
+            velocity = (playerPosition-mLastPosition) / duration;
+
+        mLastPosition = playerPosition;
+        mHaveLastPosition = true;
+
+        MWBase::World *world = MWBase::Environment::get().getWorld();
+
+        int x = 0;
+        int y = 0;
+        world->positionToIndex (playerPosition.x, playerPosition.y, x, y);
+
+        // The 3x3 grid around the player is active, its objects have been attached already.
+        for (EntryMap::iterator iter (mEntries.begin()); iter!=mEntries.end();)
+        {
+            if (std::abs (iter->first.first-x)<=1 && std::abs (iter->first.second-y)<=1)
+                mEntries.erase (iter++);
+            else
+                ++iter;
+        }
+
+        Ogre::Vector3 predicted = playerPosition + velocity * mLookAhead;
+
+        int predictedX = 0;
+        int predictedY = 0;
+        world->positionToIndex (predicted.x, predicted.y, predictedX, predictedY);
+
+        if (predictedX==x && predictedY==y)
+            return;
+
+        // Cells that become active, when the player reaches the predicted cell. Start with the
+        // one the player is heading to.
+        if (std::abs (predictedX-x)>1 || std::abs (predictedY-y)>1)
+            request (predictedX, predictedY);
+
+        for (int cellX=predictedX-1; cellX<=predictedX+1; ++cellX)
+            for (int cellY=predictedY-1; cellY<=predictedY+1; ++cellY)
+                if (std::abs (cellX-x)>1 || std::abs (cellY-y)>1)
+                    request (cellX, cellY);
+
+        enforceBudget (predictedX, predictedY);
+    }
+
+    void CellPreloader::clear()
+    {
+        ++mGeneration;
+
+        mEntries.clear();
+        mHaveLastPosition = false;
+
+        boost::lock_guard<boost::mutex> lock (mMutex);
+        mJobs.clear();
+        mResults.clear();
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef GAME_MWWORLD_CELLPRELOADER_H
+#define GAME_MWWORLD_CELLPRELOADER_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <OgreVector3.h>
+
+#include <components/esm/cellref.hpp>
+#include <components/esm/esmreader.hpp>
+#include <components/nif/niffile.hpp>
+#include <components/to_utf8/to_utf8.hpp>
+
+namespace ESM
+{
+    struct Cell;
+}
+
+namespace MWWorld
+{
+    class Cells;
+    class CellStore;
+    class ESMStore;
+
+    /// \brief Prepares the exterior cells the player is heading to on a background thread
+    ///
+    /// The player's position is extrapolated from the current velocity. For the cells around
+    /// the predicted position the worker thread reads the references from the content files
+    /// (with its own set of readers) and parses the meshes used by them into the NIF cache.
+    /// The main thread only turns the references into live references and later attaches the
+    /// prepared objects, when the cells become active.
+    ///
+    /// At most the given number of cells is held in a prepared state. Creating Ogre entities
+    /// and Bullet shapes is left to the main thread, because the resource managers are not safe
+    /// to use from other threads. Meshes are only parsed in the background, if Ogre has been
+    /// built with thread support.
+    class CellPreloader
+    {
+            struct Job
+            {
+                int mGeneration;
+                int mX;
+                int mY;
+                const ESM::Cell *mCell; ///< 0: parse meshes only
+                std::vector<std::string> mMeshes;
+            };
+
+            struct Result
+            {
+                int mGeneration;
+                int mX;
+                int mY;
+                bool mRefsRead;
+                std::vector<ESM::CellRef> mRefs;
+                std::vector<Nif::NIFFile::ptr> mMeshes;
+            };
+
+            enum State
+            {
+                State_ReadingRefs,
+                State_ParsingMeshes,
+                State_Ready
+            };
+
+            struct Entry
+            {
+                State mState;
+                std::vector<Nif::NIFFile::ptr> mMeshes; ///< keeps the parsed meshes in the cache
+            };
+
+            typedef std::map<std::pair<int, int>, Entry> EntryMap;
+
+            Cells& mCells;
+            const ESMStore& mStore;
+            std::size_t mBudget;
+            float mLookAhead;
+
+            EntryMap mEntries;
+            Ogre::Vector3 mLastPosition;
+            bool mHaveLastPosition;
+            int mGeneration; ///< results of older generations are discarded
+
+            // only used by the worker thread
+            std::vector<ESM::ESMReader> mReaders;
+            ToUTF8::Utf8Encoder mEncoder;
+
+            boost::mutex mMutex;
+            boost::condition_variable mJobAdded;
+            std::deque<Job> mJobs;
+            std::deque<Result> mResults;
+            bool mQuit;
+            boost::thread mThread;
+
+            // not implemented
+            CellPreloader (const CellPreloader&);
+            CellPreloader& operator= (const CellPreloader&);
+
+            // boost::thread entry point
+            void work();
+
+            void processJob (Job& job, Result& result);
+
+            void addJob (const Job& job);
+
+            void request (int x, int y);
+
+            void handleResult (Result& result);
+
+            /// Drop entries that are farthest away from \a x, \a y, until the budget is met.
+            void enforceBudget (int x, int y);
+
+        public:
+
+            CellPreloader (Cells& cells, const ESMStore& store,
+                const std::vector<ESM::ESMReader>& readers, const ToUTF8::Utf8Encoder& encoder,
+                int budget, float lookAhead);
+            ///< \param readers Readers of the loaded content files (copied for the worker thread)
+            /// \param budget Maximum number of prepared cells
+            /// \param lookAhead Prediction time (in seconds)
+
+            ~CellPreloader();
+
+            void update (float duration, const Ogre::Vector3& playerPosition, bool exterior);
+            ///< Request cells around the predicted position and take over finished work.
+            /// \param exterior Is the player in an exterior cell?
+
+            void clear();
+            ///< Drop all prepared data and discard pending work (e.g. when starting a new game).
+    };
+}
+
+#endif
@@ -7,6 +7,20 @@
 #include "esmstore.hpp"
 #include "containerstore.hpp"
 
+namespace
+{
+    struct ListIds
+    {
+        std::vector<std::string> mIds;
+
+        bool operator() (ESM::CellRef& ref, MWWorld::RefData& data)
+        {
+            mIds.push_back (ref.mRefID);
+            return true;
+        }
+    };
+}
+
 MWWorld::Ptr::CellStore *MWWorld::Cells::getCellStore (const ESM::Cell *cell)
 {
     if (cell->mData.mFlags & ESM::Cell::Interior)
@@ -40,29 +54,96 @@ void MWWorld::Cells::clear()
 {
     mInteriors.clear();
     mExteriors.clear();
-    std::fill(mIdCache.begin(), mIdCache.end(), std::make_pair("", (MWWorld::Ptr::CellStore*)0));
-    mIdCacheIndex = 0;
+    mRefIndex.clear();
+    mRefs.clear();
+    mIndexedCells.clear();
+    mRefIndexComplete = false;
+}
+
+MWWorld::Cells::RefEntry& MWWorld::Cells::getRefEntry (const std::string& lowerCaseId)
+{
+    if (RefEntry *entry = mRefIndex.findLowerCase (lowerCaseId))
+        return *entry;
+
+    std::map<std::string, RefEntry>::iterator iter =
+        mRefs.insert (std::make_pair (lowerCaseId, RefEntry())).first;
+    mRefIndex.insert (iter->first, &iter->second);
+    return iter->second;
 }
 
-MWWorld::Ptr MWWorld::Cells::getPtrAndCache (const std::string& name, Ptr::CellStore& cellStore)
+void MWWorld::Cells::indexRef (const std::string& lowerCaseId, Ptr::CellStore *cellStore)
 {
-    Ptr ptr = getPtr (name, cellStore);
+    std::vector<Ptr::CellStore *>& cells = getRefEntry (lowerCaseId).mCells;
 
-    if (!ptr.isEmpty() && ptr.isInCell())
+    if (std::find (cells.begin(), cells.end(), cellStore)==cells.end())
+        cells.push_back (cellStore);
+}
+
+void MWWorld::Cells::indexCell (Ptr::CellStore& cellStore)
+{
+    if (cellStore.mState==Ptr::CellStore::State_Loaded)
+    {
+        ListIds functor;
+        cellStore.forEach (functor);
+
+        for (std::vector<std::string>::const_iterator id (functor.mIds.begin());
+            id!=functor.mIds.end(); ++id)
+            indexRef (Misc::StringUtils::lowerCase (*id), &cellStore);
+    }
+    else if (cellStore.mState==Ptr::CellStore::State_Preloaded)
     {
-        mIdCache[mIdCacheIndex].first = name;
-        mIdCache[mIdCacheIndex].second = &cellStore;
-        if (++mIdCacheIndex>=mIdCache.size())
-            mIdCacheIndex = 0;
+        for (std::vector<std::string>::const_iterator id (cellStore.mIds.begin());
+            id!=cellStore.mIds.end(); ++id)
+            indexRef (*id, &cellStore);
+
+        // References moved into this cell are not listed by preload
+        for (ESM::CellRefTracker::const_iterator ref = cellStore.mCell->mLeasedRefs.begin();
+            ref!=cellStore.mCell->mLeasedRefs.end(); ++ref)
+            indexRef (Misc::StringUtils::lowerCase (ref->mRefID), &cellStore);
     }
+    else
+        return;
 
-    return ptr;
+    mIndexedCells.insert (&cellStore);
+}
+
+MWWorld::Ptr MWWorld::Cells::searchUnindexed (const std::string& name)
+{
+    // Same order as the old linear search: exteriors first
+    const MWWorld::Store<ESM::Cell> &cells = mStore.get<ESM::Cell>();
+    MWWorld::Store<ESM::Cell>::iterator iter;
+
+    for (iter = cells.extBegin(); iter != cells.extEnd(); ++iter)
+    {
+        Ptr::CellStore *cellStore = getCellStore (&(*iter));
+
+        if (!mIndexedCells.count (cellStore))
+        {
+            Ptr ptr = getPtr (name, *cellStore);
+            if (!ptr.isEmpty())
+                return ptr;
+        }
+    }
+
+    for (iter = cells.intBegin(); iter != cells.intEnd(); ++iter)
+    {
+        Ptr::CellStore *cellStore = getCellStore (&(*iter));
+
+        if (!mIndexedCells.count (cellStore))
+        {
+            Ptr ptr = getPtr (name, *cellStore);
+            if (!ptr.isEmpty())
+                return ptr;
+        }
+    }
+
+    // Dynamically created cells are loaded (and therefore indexed) on creation.
+    mRefIndexComplete = true;
+    return Ptr();
 }
 
 MWWorld::Cells::Cells (const MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& reader)
-: mStore (store), mReader (reader),
-  mIdCache (40, std::pair<std::string, Ptr::CellStore *> ("", (Ptr::CellStore*)0)), /// \todo make cache size configurable
-  mIdCacheIndex (0)
+: mStore (store), mReader (reader), mRefIndexComplete (false)
 {}
 
 MWWorld::Ptr::CellStore *MWWorld::Cells::getExterior (int x, int y)
@@ -96,6 +177,26 @@ MWWorld::Ptr::CellStore *MWWorld::Cells::getExterior (int x, int y)
     {
         // Multiple plugin support for landscape data is much easier than for references. The last plugin wins.
         result->second.load (mStore, mReader);
+        indexCell (result->second);
+    }
+
+    return &result->second;
+}
+
+MWWorld::Ptr::CellStore *MWWorld::Cells::searchExterior (int x, int y)
+{
+    std::map<std::pair<int, int>, Ptr::CellStore>::iterator result =
+        mExteriors.find (std::make_pair (x, y));
+
+    if (result==mExteriors.end())
+    {
+        const ESM::Cell *cell = mStore.get<ESM::Cell>().search(x, y);
+
+        if (!cell)
+            return 0;
+
+        result = mExteriors.insert (std::make_pair (
+            std::make_pair (x, y), CellStore (cell))).first;
     }
 
     return &result->second;
@@ -116,6 +217,7 @@ MWWorld::Ptr::CellStore *MWWorld::Cells::getInterior (const std::string& name)
     if (result->second.mState!=Ptr::CellStore::State_Loaded)
     {
         result->second.load (mStore, mReader);
+        indexCell (result->second);
     }
 
     return &result->second;
@@ -125,7 +227,10 @@ MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name, Ptr::CellStore& ce
     bool searchInContainers)
 {
     if (cell.mState==Ptr::CellStore::State_Unloaded)
+    {
         cell.preload (mStore, mReader);
+        indexCell (cell);
+    }
 
     if (cell.mState==Ptr::CellStore::State_Preloaded)
     {
@@ -134,6 +239,7 @@ MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name, Ptr::CellStore& ce
         if (std::binary_search (cell.mIds.begin(), cell.mIds.end(), lowerCase))
         {
             cell.load (mStore, mReader);
+            indexCell (cell);
         }
         else
             return Ptr();
@@ -207,57 +313,43 @@ MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name, Ptr::CellStore& ce
 
 MWWorld::Ptr MWWorld::Cells::getPtr (const std::string& name)
 {
-    // First check the cache
-    for (std::vector<std::pair<std::string, Ptr::CellStore *> >::iterator iter (mIdCache.begin());
-        iter!=mIdCache.end(); ++iter)
-        if (iter->first==name && iter->second)
+    if (RefEntry *entry = mRefIndex.find (name))
+    {
+        // Most lookups are repeated ones for the same reference
+        if (!entry->mPtr.isEmpty() && entry->mPtr.getRefData().getCount()>0 &&
+            Misc::StringUtils::ciEqual (entry->mPtr.getCellRef().mRefID, name))
+            return entry->mPtr;
+
+        for (std::vector<Ptr::CellStore *>::const_iterator iter (entry->mCells.begin());
+            iter!=entry->mCells.end(); ++iter)
         {
-            Ptr ptr = getPtr (name, *iter->second);
+            Ptr ptr = getPtr (name, **iter);
+
             if (!ptr.isEmpty())
+            {
+                entry->mPtr = ptr;
                 return ptr;
+            }
         }
-
-    // Then check cells that are already listed
-    for (std::map<std::pair<int, int>, Ptr::CellStore>::iterator iter = mExteriors.begin();
-        iter!=mExteriors.end(); ++iter)
-    {
-        Ptr ptr = getPtrAndCache (name, iter->second);
-        if (!ptr.isEmpty())
-            return ptr;
     }
 
-    for (std::map<std::string, Ptr::CellStore>::iterator iter = mInteriors.begin();
-        iter!=mInteriors.end(); ++iter)
-    {
-        Ptr ptr = getPtrAndCache (name, iter->second);
-        if (!ptr.isEmpty())
-            return ptr;
-    }
-
-    // Now try the other cells
-    const MWWorld::Store<ESM::Cell> &cells = mStore.get<ESM::Cell>();
-    MWWorld::Store<ESM::Cell>::iterator iter;
-
-    for (iter = cells.extBegin(); iter != cells.extEnd(); ++iter)
-    {
-        Ptr::CellStore *cellStore = getCellStore (&(*iter));
+    if (mRefIndexComplete)
+        return Ptr();
 
-        Ptr ptr = getPtrAndCache (name, *cellStore);
+    Ptr ptr = searchUnindexed (name);
 
-        if (!ptr.isEmpty())
-            return ptr;
-    }
+    if (!ptr.isEmpty())
+        getRefEntry (Misc::StringUtils::lowerCase (name)).mPtr = ptr;
 
-    for (iter = cells.intBegin(); iter != cells.intEnd(); ++iter)
-    {
-        Ptr::CellStore *cellStore = getCellStore (&(*iter));
+    return ptr;
+}
 
-        Ptr ptr = getPtrAndCache (name, *cellStore);
+void MWWorld::Cells::addRef (const Ptr& ptr)
+{
+    RefEntry& entry = getRefEntry (Misc::StringUtils::lowerCase (ptr.getCellRef().mRefID));
 
-        if (!ptr.isEmpty())
-            return ptr;
-    }
+    if (std::find (entry.mCells.begin(), entry.mCells.end(), ptr.getCell())==entry.mCells.end())
+        entry.mCells.push_back (ptr.getCell());
 
-    // giving up
-    return Ptr();
+    entry.mPtr = ptr;
 }
@@ -3,8 +3,11 @@
 
 #include <map>
 #include <list>
+#include <set>
 #include <string>
 
+#include <components/misc/stringindex.hpp>
+
 #include "ptr.hpp"
 
 namespace ESM
@@ -23,15 +26,30 @@ namespace MWWorld
             std::vector<ESM::ESMReader>& mReader;
             std::map<std::string, CellStore> mInteriors;
             std::map<std::pair<int, int>, CellStore> mExteriors;
-            std::vector<std::pair<std::string, CellStore *> > mIdCache;
-            std::size_t mIdCacheIndex;
+
+            struct RefEntry
+            {
+                std::vector<CellStore *> mCells; ///< Cells that have held a reference with this ID
+                Ptr mPtr; ///< Last reference found with this ID. May have been deleted or moved since.
+            };
+
+            // Reference ID (lower case) -> where to find it, for loaded and preloaded cells
+            std::map<std::string, RefEntry> mRefs;
+            Misc::StringIndex<RefEntry> mRefIndex;
+            std::set<const CellStore *> mIndexedCells;
+            bool mRefIndexComplete; // all cells indexed
 
             Cells (const Cells&);
             Cells& operator= (const Cells&);
 
             CellStore *getCellStore (const ESM::Cell *cell);
 
-            Ptr getPtrAndCache (const std::string& name, CellStore& cellStore);
+            RefEntry& getRefEntry (const std::string& lowerCaseId);
+
+            void indexRef (const std::string& lowerCaseId, CellStore *cellStore);
+
+            /// Search the cells that have not been indexed yet (indexes them on the way).
+            Ptr searchUnindexed (const std::string& name);
 
         public:
 
@@ -43,12 +61,27 @@ namespace MWWorld
 
             CellStore *getExterior (int x, int y);
 
+            CellStore *searchExterior (int x, int y);
+            ///< Return exterior cell without loading its references.
+            /// \return 0, if the cell is neither defined by the content files nor has been created
+            /// on the fly.
+
             CellStore *getInterior (const std::string& name);
 
             Ptr getPtr (const std::string& name, CellStore& cellStore, bool searchInContainers = false);
             ///< \param searchInContainers Only affect loaded cells.
 
             Ptr getPtr (const std::string& name);
+            ///< Search all cells. Loaded and preloaded cells are looked up in an index, the others
+            /// are searched one by one.
+
+            void indexCell (CellStore& cellStore);
+            ///< Add the references of \a cellStore to the index (call after loading or preloading
+            /// the cell).
+
+            void addRef (const Ptr& ptr);
+            ///< Notify about a reference that has been added to a cell after the cell was loaded
+            /// (e.g. a moved or dropped object).
     };
 }
 
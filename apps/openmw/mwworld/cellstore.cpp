@@ -18,6 +18,9 @@ namespace
         for (typename MWWorld::CellRefList<T>::List::iterator iter (containerList.mList.begin());
              iter!=containerList.mList.end(); ++iter)
         {
+            if (!iter->mData.getCount())
+                continue;
+
             MWWorld::Ptr container (&*iter, 0);
 
             MWWorld::Ptr ptr =
@@ -38,19 +41,20 @@ namespace MWWorld
     void CellRefList<X>::load(ESM::CellRef &ref, const MWWorld::ESMStore &esmStore)
     {
         // Get existing reference, in case we need to overwrite it.
-        typename std::list<LiveRef>::iterator iter = std::find(mList.begin(), mList.end(), ref.mRefnum);
+        typename List::iterator iter = std::find(mList.begin(), mList.end(), ref.mRefnum);
 
         // Skip this when reference was deleted.
         // TODO: Support respawning references, in this case, we need to track it somehow.
         if (ref.mDeleted) {
             if (iter != mList.end())
-                mList.erase(iter);
+                iter->mData.setCount(0);
             return;
         }
 
         // for throwing exception on unhandled record type
         const MWWorld::Store<X> &store = esmStore.get<X>();
-        const X *ptr = store.search(ref.mRefID);
+        // CellStore::loadRefs has already converted the id to lower case
+        const X *ptr = store.searchLowerCase(ref.mRefID);
 
         /// \note no longer redundant - changed to Store<X>::search(), don't throw
         ///  an exception on miss, try to continue (that's how MW does it, anyway)
@@ -84,7 +88,12 @@ namespace MWWorld
 
             std::cout << "loading cell " << mCell->getDescription() << std::endl;
 
-            loadRefs (store, esm);
+            std::vector<ESM::CellRef> refs;
+
+            if (!mCell->mContextList.empty())
+                readRefs (*mCell, esm, refs);
+
+            loadRefs (store, refs);
 
             mState = State_Loaded;
         }
@@ -133,69 +142,56 @@ namespace MWWorld
         std::sort (mIds.begin(), mIds.end());
     }
 
-    void CellStore::loadRefs(const MWWorld::ESMStore &store, std::vector<ESM::ESMReader> &esm)
+    void CellStore::load (const MWWorld::ESMStore &store, std::vector<ESM::CellRef> &refs)
     {
-      assert (mCell);
+        if (mState!=State_Loaded)
+        {
+            if (mState==State_Preloaded)
+                mIds.clear();
 
-        if (mCell->mContextList.empty())
-            return; // this is a dynamically generated cell -> skipping.
+            std::cout << "loading cell " << mCell->getDescription() << " (preloaded)" << std::endl;
+
+            loadRefs (store, refs);
+
+            mState = State_Loaded;
+        }
+    }
 
+    void CellStore::readRefs (const ESM::Cell& cell, std::vector<ESM::ESMReader> &esm,
+        std::vector<ESM::CellRef> &refs)
+    {
         // Load references from all plugins that do something with this cell.
-        for (size_t i = 0; i < mCell->mContextList.size(); i++)
+        for (size_t i = 0; i < cell.mContextList.size(); i++)
         {
             // Reopen the ESM reader and seek to the right position.
-            int index = mCell->mContextList.at(i).index;
-            mCell->restore (esm[index], i);
+            int index = cell.mContextList.at(i).index;
+            cell.restore (esm[index], i);
 
             ESM::CellRef ref;
 
             // Get each reference in turn
-            while(mCell->getNextRef(esm[index], ref))
+            while(cell.getNextRef(esm[index], ref))
             {
                 // Don't load reference if it was moved to a different cell.
-                std::string lowerCase = Misc::StringUtils::lowerCase(ref.mRefID);
-                ESM::MovedCellRefTracker::const_iterator iter = std::find(mCell->mMovedRefs.begin(), mCell->mMovedRefs.end(), ref.mRefnum);
-                if (iter != mCell->mMovedRefs.end()) {
+                ESM::MovedCellRefTracker::const_iterator iter = std::find(cell.mMovedRefs.begin(), cell.mMovedRefs.end(), ref.mRefnum);
+                if (iter != cell.mMovedRefs.end()) {
                     continue;
                 }
-                int rec = store.find(ref.mRefID);
 
-                ref.mRefID = lowerCase;
-
-            /* We can optimize this further by storing the pointer to the
-                record itself in store.all, so that we don't need to look it
-                up again here. However, never optimize. There are infinite
-                opportunities to do that later.
-            */
-            switch(rec)
-                {
-            case ESM::REC_ACTI: mActivators.load(ref, store); break;
-            case ESM::REC_ALCH: mPotions.load(ref, store); break;
-            case ESM::REC_APPA: mAppas.load(ref, store); break;
-            case ESM::REC_ARMO: mArmors.load(ref, store); break;
-            case ESM::REC_BOOK: mBooks.load(ref, store); break;
-            case ESM::REC_CLOT: mClothes.load(ref, store); break;
-            case ESM::REC_CONT: mContainers.load(ref, store); break;
-            case ESM::REC_CREA: mCreatures.load(ref, store); break;
-            case ESM::REC_DOOR: mDoors.load(ref, store); break;
-            case ESM::REC_INGR: mIngreds.load(ref, store); break;
-            case ESM::REC_LEVC: mCreatureLists.load(ref, store); break;
-            case ESM::REC_LEVI: mItemLists.load(ref, store); break;
-            case ESM::REC_LIGH: mLights.load(ref, store); break;
-            case ESM::REC_LOCK: mLockpicks.load(ref, store); break;
-            case ESM::REC_MISC: mMiscItems.load(ref, store); break;
-            case ESM::REC_NPC_: mNpcs.load(ref, store); break;
-            case ESM::REC_PROB: mProbes.load(ref, store); break;
-            case ESM::REC_REPA: mRepairs.load(ref, store); break;
-            case ESM::REC_STAT: mStatics.load(ref, store); break;
-            case ESM::REC_WEAP: mWeapons.load(ref, store); break;
-
-                case 0: std::cout << "Cell reference " + ref.mRefID + " not found!\n"; break;
-                default:
-                std::cout << "WARNING: Ignoring reference '" << ref.mRefID << "' of unhandled type\n";
-                }
+                refs.push_back (ref);
             }
         }
+    }
+
+    void CellStore::loadRefs(const MWWorld::ESMStore &store, std::vector<ESM::CellRef> &refs)
+    {
+      assert (mCell);
+
+        if (mCell->mContextList.empty())
+            return; // this is a dynamically generated cell -> skipping.
+
+        for (std::vector<ESM::CellRef>::iterator iter (refs.begin()); iter!=refs.end(); ++iter)
+            loadRef (*iter, store);
 
         // Load moved references, from separately tracked list.
         for (ESM::CellRefTracker::const_iterator it = mCell->mLeasedRefs.begin(); it != mCell->mLeasedRefs.end(); ++it)
@@ -204,22 +200,25 @@ namespace MWWorld
             ESM::CellRef &ref = const_cast<ESM::CellRef&>(*it);
             //ESM::CellRef &ref = const_cast<ESM::CellRef&>(it->second);
 
-            std::string lowerCase;
+            loadRef (ref, store);
+        }
+    }
 
-            std::transform (ref.mRefID.begin(), ref.mRefID.end(), std::back_inserter (lowerCase),
-                (int(*)(int)) std::tolower);
+    void CellStore::loadRef (ESM::CellRef &ref, const MWWorld::ESMStore &store)
+    {
+        std::string lowerCase = Misc::StringUtils::lowerCase (ref.mRefID);
 
-            int rec = store.find(ref.mRefID);
+        int rec = store.find(ref.mRefID);
 
-            ref.mRefID = lowerCase;
+        ref.mRefID = lowerCase;
 
-            /* We can optimize this further by storing the pointer to the
-                record itself in store.all, so that we don't need to look it
-                up again here. However, never optimize. There are infinite
-                opportunities to do that later.
-            */
-            switch(rec)
-                {
+        /* We can optimize this further by storing the pointer to the
+            record itself in store.all, so that we don't need to look it
+            up again here. However, never optimize. There are infinite
+            opportunities to do that later.
+        */
+        switch(rec)
+        {
             case ESM::REC_ACTI: mActivators.load(ref, store); break;
             case ESM::REC_ALCH: mPotions.load(ref, store); break;
             case ESM::REC_APPA: mAppas.load(ref, store); break;
@@ -241,11 +240,9 @@ namespace MWWorld
             case ESM::REC_STAT: mStatics.load(ref, store); break;
             case ESM::REC_WEAP: mWeapons.load(ref, store); break;
 
-                case 0: std::cout << "Cell reference " + ref.mRefID + " not found!\n"; break;
-                default:
+            case 0: std::cout << "Cell reference " + ref.mRefID + " not found!\n"; break;
+            default:
                 std::cout << "WARNING: Ignoring reference '" << ref.mRefID << "' of unhandled type\n";
-                }
-
         }
     }
 
@@ -4,6 +4,8 @@
 #include <deque>
 #include <algorithm>
 
+#include <components/misc/chunkedvector.hpp>
+
 #include "livecellref.hpp"
 #include "esmstore.hpp"
 
@@ -15,7 +17,8 @@ namespace MWWorld
   struct CellRefList
   {
     typedef LiveCellRef<X> LiveRef;
-    typedef std::list<LiveRef> List;
+    // References are never removed (deleted ones get a count of 0), so Ptrs stay valid.
+    typedef Misc::ChunkedVector<LiveRef> List;
     List mList;
 
     // Search for the given reference in the given reclist from
@@ -29,7 +32,7 @@ namespace MWWorld
 
     LiveRef *find (const std::string& name)
     {
-        for (typename std::list<LiveRef>::iterator iter (mList.begin()); iter!=mList.end(); ++iter)
+        for (typename List::iterator iter (mList.begin()); iter!=mList.end(); ++iter)
         {
             if (iter->mData.getCount() > 0 && iter->mRef.mRefID == name)
                 return &*iter;
@@ -88,6 +91,17 @@ namespace MWWorld
 
     void preload (const MWWorld::ESMStore &store, std::vector<ESM::ESMReader> &esm);
 
+    /// Load references that have already been read by readRefs.
+    void load (const MWWorld::ESMStore &store, std::vector<ESM::CellRef> &refs);
+
+    /// Read the references of \a cell from all plugins, except for references that have been
+    /// moved to a different cell.
+    ///
+    /// \note Does not access the ESMStore. Can be used from other threads, as long as they
+    /// have their own set of readers.
+    static void readRefs (const ESM::Cell& cell, std::vector<ESM::ESMReader> &esm,
+        std::vector<ESM::CellRef> &refs);
+
     /// Call functor (ref) for each reference. functor must return a bool. Returning
     /// false will abort the iteration.
     /// \return Iteration completed?
@@ -152,7 +166,9 @@ namespace MWWorld
     /// Run through references and store IDs
     void listRefs(const MWWorld::ESMStore &store, std::vector<ESM::ESMReader> &esm);
 
-    void loadRefs(const MWWorld::ESMStore &store, std::vector<ESM::ESMReader> &esm);
+    void loadRefs(const MWWorld::ESMStore &store, std::vector<ESM::CellRef> &refs);
+
+    void loadRef (ESM::CellRef &ref, const MWWorld::ESMStore &store);
 
   };
 }
@@ -27,6 +27,12 @@ struct ContentLoader
       mListener.setLabel(filepath.string());
     }
 
+    /// Called once all content files have been passed to load(). Loaders that defer work
+    /// (e.g. to process several files at once) have to complete it here.
+    virtual void finish()
+    {
+    }
+
     protected:
         Loading::Listener& mListener;
 };
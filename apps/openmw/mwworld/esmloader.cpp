@@ -1,17 +1,134 @@
 #include "esmloader.hpp"
 #include "esmstore.hpp"
 
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <components/esm/esmwriter.hpp>
+
 #include "components/to_utf8/to_utf8.hpp"
 
+namespace
+{
+    /// Increase whenever the snapshot layout or any record's load/save format changes
+    const int sSnapshotVersion = 2;
+
+    /// \return -1, if strings are not converted
+    int getEncoding(const ToUTF8::Utf8Encoder* encoder)
+    {
+        return encoder ? static_cast<int>(encoder->getEncoding()) : -1;
+    }
+
+    /// Hands out content files to worker threads and lets the main thread wait for the parsed
+    /// result of each file in load order.
+    class ParseQueue
+    {
+            const MWWorld::ESMStore& mStore;
+            std::vector<ESM::ESMReader>& mReaders;
+            const std::vector<int>& mFiles;
+            ToUTF8::Utf8Encoder* mEncoder;
+            bool mSkipSnapshot;
+
+            boost::mutex mMutex;
+            boost::condition_variable mFileDone;
+
+            size_t mNext;
+            bool mAbort;
+            std::vector<bool> mDone;
+            std::vector<std::string> mErrors;
+
+        public:
+            std::vector<MWWorld::ESMStore::StagedFile *> mStaged;
+
+            ParseQueue(const MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& readers,
+                const std::vector<int>& files, ToUTF8::Utf8Encoder* encoder, bool skipSnapshot)
+              : mStore(store), mReaders(readers), mFiles(files), mEncoder(encoder), mSkipSnapshot(skipSnapshot),
+                mNext(0), mAbort(false),
+                mDone(files.size(), false), mErrors(files.size())
+            {
+                for (size_t i = 0; i < files.size(); ++i)
+                    mStaged.push_back(new MWWorld::ESMStore::StagedFile);
+            }
+
+            ~ParseQueue()
+            {
+                for (size_t i = 0; i < mStaged.size(); ++i)
+                    delete mStaged[i];
+            }
+
+            // boost::thread entry point
+            void work()
+            {
+                // The encoder keeps an internal conversion buffer, so each thread needs its own copy.
+                ToUTF8::Utf8Encoder encoder(*mEncoder);
+
+                while (true)
+                {
+                    size_t file;
+                    {
+                        boost::lock_guard<boost::mutex> lock(mMutex);
+                        if (mAbort || mNext == mFiles.size())
+                            return;
+                        file = mNext++;
+                    }
+
+                    ESM::ESMReader& esm = mReaders[mFiles[file]];
+                    std::string error;
+                    try
+                    {
+                        esm.setEncoder(&encoder);
+                        mStore.parse(esm, *mStaged[file], mSkipSnapshot);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        error = e.what();
+                    }
+                    esm.setEncoder(mEncoder);
+
+                    {
+                        boost::lock_guard<boost::mutex> lock(mMutex);
+                        mDone[file] = true;
+                        mErrors[file] = error;
+                    }
+                    mFileDone.notify_all();
+                }
+            }
+
+            /// Block until \a file has been parsed. Rethrows errors from the worker thread.
+            void waitFor(size_t file)
+            {
+                boost::unique_lock<boost::mutex> lock(mMutex);
+                while (!mDone[file])
+                    mFileDone.wait(lock);
+
+                if (!mErrors[file].empty())
+                    throw std::runtime_error(mErrors[file]);
+            }
+
+            /// Stop handing out further files
+            void abort()
+            {
+                boost::lock_guard<boost::mutex> lock(mMutex);
+                mAbort = true;
+            }
+    };
+}
+
 namespace MWWorld
 {
 
 EsmLoader::EsmLoader(MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& readers,
-  ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener)
+  ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener, const boost::filesystem::path& snapshot)
   : ContentLoader(listener)
   , mStore(store)
   , mEsm(readers)
   , mEncoder(encoder)
+  , mSnapshot(snapshot)
 {
 }
 
@@ -25,7 +142,182 @@ void EsmLoader::load(const boost::filesystem::path& filepath, int& index)
   lEsm.setGlobalReaderList(&mEsm);
   lEsm.open(filepath.string());
   mEsm[index] = lEsm;
-  mStore.load(mEsm[index], &mListener);
+  mStore.resolveMasters(mEsm[index]);
+
+  mPending.push_back(index);
+  mPendingNames.push_back(filepath.filename().string());
+}
+
+void EsmLoader::finish()
+{
+  if (mPending.empty())
+    return;
+
+  bool fromSnapshot = !mSnapshot.empty() && loadSnapshot();
+
+  ParseQueue queue(mStore, mEsm, mPending, mEncoder, fromSnapshot);
+
+  size_t threads = std::max(1u, boost::thread::hardware_concurrency());
+  threads = std::min(threads, mPending.size());
+
+  boost::thread_group workers;
+  for (size_t i = 0; i < threads; ++i)
+    workers.create_thread(boost::bind(&ParseQueue::work, &queue));
+
+  try
+  {
+    // Merge in load order, so that overrides and deletions behave as if the files were
+    // loaded one after another.
+    for (size_t i = 0; i < mPending.size(); ++i)
+    {
+      queue.waitFor(i);
+
+      mListener.setLabel(mPendingNames[i]);
+      mStore.merge(mEsm[mPending[i]], *queue.mStaged[i], &mListener);
+
+      delete queue.mStaged[i];
+      queue.mStaged[i] = 0;
+    }
+  }
+  catch (...)
+  {
+    queue.abort();
+    workers.join_all();
+    mPending.clear();
+    mPendingNames.clear();
+    throw;
+  }
+
+  workers.join_all();
+
+  if (!mSnapshot.empty() && !fromSnapshot)
+    writeSnapshot();
+
+  mPending.clear();
+  mPendingNames.clear();
+}
+
+void EsmLoader::writeSnapshotKey(ESM::ESMWriter& writer) const
+{
+  writer.startRecord("SNAP");
+  writer.writeHNT("VERS", sSnapshotVersion);
+  writer.writeHNT("ENCD", getEncoding(mEncoder));
+  for (std::vector<int>::const_iterator it = mPending.begin(); it != mPending.end(); ++it)
+  {
+    const std::string& file = mEsm[*it].getContext().filename;
+    writer.writeHNCString("NAME", file);
+    writer.writeHNT("SIZE", static_cast<int64_t>(boost::filesystem::file_size(file)));
+    writer.writeHNT("TIME", static_cast<int64_t>(boost::filesystem::last_write_time(file)));
+  }
+  writer.endRecord("SNAP");
+}
+
+bool EsmLoader::checkSnapshotKey(ESM::ESMReader& reader) const
+{
+  if (!reader.hasMoreRecs() || reader.getRecName() != "SNAP")
+    return false;
+  reader.getRecHeader();
+
+  int version;
+  reader.getHNT(version, "VERS");
+  if (version != sSnapshotVersion)
+    return false;
+
+  // strings in the snapshot have been converted with this encoding
+  int encoding;
+  reader.getHNT(encoding, "ENCD");
+  if (encoding != getEncoding(mEncoder))
+    return false;
+
+  for (std::vector<int>::const_iterator it = mPending.begin(); it != mPending.end(); ++it)
+  {
+    const std::string& file = mEsm[*it].getContext().filename;
+    if (!reader.hasMoreSubs() || reader.getHNString("NAME") != file)
+      return false;
+    if (reader.getHNLong("SIZE") != static_cast<int64_t>(boost::filesystem::file_size(file)))
+      return false;
+    if (reader.getHNLong("TIME") != static_cast<int64_t>(boost::filesystem::last_write_time(file)))
+      return false;
+  }
+  return !reader.hasMoreSubs();
+}
+
+bool EsmLoader::loadSnapshot()
+{
+  if (!boost::filesystem::exists(mSnapshot))
+    return false;
+
+  ESM::ESMReader reader;
+  reader.setEncoder(mEncoder);
+
+  try
+  {
+    reader.open(mSnapshot.string());
+    if (!checkSnapshotKey(reader))
+    {
+      std::cout << "Content files have changed, ignoring snapshot " << mSnapshot.string() << std::endl;
+      return false;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Failed to read snapshot " << mSnapshot.string() << ": " << e.what() << std::endl;
+    return false;
+  }
+
+  std::cout << "Loading snapshot " << mSnapshot.string() << std::endl;
+  mListener.setLabel(mSnapshot.filename().string());
+
+  try
+  {
+    mStore.loadSnapshot(reader, &mListener);
+  }
+  catch (...)
+  {
+    // The store has been partially filled at this point, so there is no way to fall back.
+    // Make sure the next start does not run into the same problem.
+    reader.close();
+    boost::filesystem::remove(mSnapshot);
+    throw;
+  }
+  return true;
+}
+
+void EsmLoader::writeSnapshot()
+{
+  // Write to a temporary file first, so that an interrupted write can not leave a snapshot
+  // with a valid key behind.
+  boost::filesystem::path tmp = mSnapshot;
+  tmp += ".tmp";
+
+  try
+  {
+    boost::filesystem::create_directories(mSnapshot.parent_path());
+
+    std::ofstream stream(tmp.string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+    ESM::ESMWriter writer;
+    writer.setEncoder(mEncoder);
+    writer.setVersion();
+    writer.setFormat(0);
+    writer.save(stream);
+
+    writeSnapshotKey(writer);
+    mStore.writeSnapshot(writer);
+    writer.close();
+
+    stream.close();
+    if (!stream)
+      throw std::runtime_error("write error");
+
+    boost::filesystem::rename(tmp, mSnapshot);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Failed to write snapshot " << mSnapshot.string() << ": " << e.what() << std::endl;
+    boost::system::error_code ec;
+    boost::filesystem::remove(tmp, ec);
+  }
 }
 
 } /* namespace MWWorld */
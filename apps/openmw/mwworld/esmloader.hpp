@@ -16,17 +16,40 @@ namespace MWWorld
 
 class ESMStore;
 
+/// Opens esm/esp files as they are passed to load(). The records of all files are then parsed
+/// on worker threads in finish() and added to the store in load order.
+///
+/// If a snapshot path is given, the merged records are written to it after a successful load.
+/// Later loads of the same content files (same paths, sizes and modification times) restore
+/// most record types from the snapshot, and only read cells and land from the content files.
 struct EsmLoader : public ContentLoader
 {
     EsmLoader(MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& readers,
-      ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener);
+      ToUTF8::Utf8Encoder* encoder, Loading::Listener& listener,
+      const boost::filesystem::path& snapshot = boost::filesystem::path());
 
     void load(const boost::filesystem::path& filepath, int& index);
 
+    void finish();
+
     private:
+      /// Write the key identifying the currently loaded content files
+      void writeSnapshotKey(ESM::ESMWriter& writer) const;
+
+      /// \return Does the snapshot belong to the currently loaded content files?
+      bool checkSnapshotKey(ESM::ESMReader& reader) const;
+
+      bool loadSnapshot();
+      void writeSnapshot();
+
       std::vector<ESM::ESMReader>& mEsm;
       MWWorld::ESMStore& mStore;
       ToUTF8::Utf8Encoder* mEncoder;
+      boost::filesystem::path mSnapshot;
+
+      /// Indices of opened files that still need to be parsed and merged
+      std::vector<int> mPending;
+      std::vector<std::string> mPendingNames;
 };
 
 } /* namespace MWWorld */
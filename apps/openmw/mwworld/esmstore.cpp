@@ -1,6 +1,7 @@
 #include "esmstore.hpp"
 
 #include <set>
+#include <memory>
 #include <iostream>
 
 #include <boost/filesystem/operations.hpp>
@@ -23,14 +24,31 @@ static bool isCacheableRecord(int id)
     return false;
 }
 
-void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
+namespace
 {
-    listener->setProgressRange(1000);
+    struct StagedInfo : public StagedRecord
+    {
+        ESM::DialInfo mRecord;
+    };
+}
 
-    std::set<std::string> missing;
+ESMStore::StagedFile::~StagedFile()
+{
+    for (std::vector<Entry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+        delete it->mRecord;
+}
 
-    ESM::Dialogue *dialogue = 0;
+void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
+{
+    resolveMasters(esm);
 
+    StagedFile file;
+    parse(esm, file);
+    merge(esm, file, listener);
+}
+
+void ESMStore::resolveMasters(ESM::ESMReader &esm)
+{
     /// \todo Move this to somewhere else. ESMReader?
     // Cache parent esX files by tracking their indices in the global list of
     //  all files/readers used by the engine. This will greaty accelerate
@@ -58,60 +76,123 @@ void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
         }
         mast.index = index;
     }
+}
 
+void ESMStore::parse(ESM::ESMReader &esm, StagedFile &file, bool skipSnapshot) const
+{
     // Loop through all records
     while(esm.hasMoreRecs())
     {
         ESM::NAME n = esm.getRecName();
         esm.getRecHeader();
 
+        if (skipSnapshot && isSnapshotRecord(n.val)) {
+            esm.skipRecord();
+            continue;
+        }
+
+        file.mEntries.push_back(StagedFile::Entry());
+        StagedFile::Entry &entry = file.mEntries.back();
+        entry.mType = n.val;
+        entry.mDeleted = false;
+        entry.mRecord = 0;
+
         // Look up the record type.
-        std::map<int, StoreBase *>::iterator it = mStores.find(n.val);
+        std::map<int, StoreBase *>::const_iterator it = mStores.find(n.val);
 
         if (it == mStores.end()) {
             if (n.val == ESM::REC_INFO) {
-                std::string id = esm.getHNOString("INAM");
+                std::auto_ptr<StagedInfo> info(new StagedInfo);
+                info->mRecord.mId = esm.getHNOString("INAM");
+                info->mRecord.load(esm);
+                entry.mRecord = info.release();
+            } else if (n.val == ESM::REC_MGEF || n.val == ESM::REC_SKIL) {
+                entry.mContext = esm.getContext();
+                esm.skipRecord();
+            } else {
+                // Not found (this would be an error later)
+                esm.skipRecord();
+            }
+        } else {
+            entry.mId = esm.getHNOString("NAME");
+            // ... unless it got deleted! This means that the following record
+            //  has been deleted, and trying to load it using standard assumptions
+            //  on the structure will (probably) fail.
+            if (esm.isNextSub("DELE")) {
+                esm.skipRecord();
+                entry.mDeleted = true;
+                continue;
+            }
+
+            entry.mRecord = it->second->loadStaged(esm, entry.mId);
+            if (!entry.mRecord) {
+                // Has to be loaded in order; remember where it is.
+                entry.mContext = esm.getContext();
+                esm.skipRecord();
+            }
+        }
+    }
+}
+
+void ESMStore::merge(ESM::ESMReader &esm, StagedFile &file, Loading::Listener* listener)
+{
+    listener->setProgressRange(1000);
+
+    std::set<std::string> missing;
+
+    ESM::Dialogue *dialogue = 0;
+
+    size_t count = file.mEntries.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        StagedFile::Entry &entry = file.mEntries[i];
+
+        // Look up the record type.
+        std::map<int, StoreBase *>::iterator it = mStores.find(entry.mType);
+
+        if (it == mStores.end()) {
+            if (entry.mType == ESM::REC_INFO) {
                 if (dialogue) {
-                    dialogue->mInfo.push_back(ESM::DialInfo());
-                    dialogue->mInfo.back().mId = id;
-                    dialogue->mInfo.back().load(esm);
+                    dialogue->mInfo.push_back(static_cast<StagedInfo *>(entry.mRecord)->mRecord);
                 } else {
                     std::cerr << "error: info record without dialog" << std::endl;
-                    esm.skipRecord();
                 }
-            } else if (n.val == ESM::REC_MGEF) {
+            } else if (entry.mType == ESM::REC_MGEF) {
+                esm.restoreContext(entry.mContext);
                 mMagicEffects.load (esm);
-            } else if (n.val == ESM::REC_SKIL) {
+            } else if (entry.mType == ESM::REC_SKIL) {
+                esm.restoreContext(entry.mContext);
                 mSkills.load (esm);
             } else {
                 // Not found (this would be an error later)
-                esm.skipRecord();
+                ESM::NAME n;
+                n.val = entry.mType;
                 missing.insert(n.toString());
             }
         } else {
-            // Load it
-            std::string id = esm.getHNOString("NAME");
-            // ... unless it got deleted! This means that the following record
-            //  has been deleted, and trying to load it using standard assumptions
-            //  on the structure will (probably) fail.
-            if (esm.isNextSub("DELE")) {
-              esm.skipRecord();
-              it->second->eraseStatic(id);
-              continue;
+            if (entry.mDeleted) {
+                it->second->eraseStatic(entry.mId);
+                continue;
             }
-            it->second->load(esm, id);
 
-            if (n.val==ESM::REC_DIAL) {
-                dialogue = const_cast<ESM::Dialogue*>(mDialogs.find(id));
+            if (entry.mRecord) {
+                it->second->applyStaged(*entry.mRecord);
+            } else {
+                esm.restoreContext(entry.mContext);
+                it->second->load(esm, entry.mId);
+            }
+
+            if (entry.mType==ESM::REC_DIAL) {
+                dialogue = const_cast<ESM::Dialogue*>(mDialogs.find(entry.mId));
             } else {
                 dialogue = 0;
             }
             // Insert the reference into the global lookup
-            if (!id.empty() && isCacheableRecord(n.val)) {
-                mIds[id] = n.val;
+            if (!entry.mId.empty() && isCacheableRecord(entry.mType)) {
+                mIds[entry.mId] = entry.mType;
             }
         }
-        listener->setProgress(esm.getFileOffset() / (float)esm.getFileSize() * 1000);
+        listener->setProgress((i + 1) / (float)count * 1000);
     }
 
   /* This information isn't needed on screen. But keep the code around
@@ -128,6 +209,79 @@ void ESMStore::load(ESM::ESMReader &esm, Loading::Listener* listener)
   */
 }
 
+bool ESMStore::isSnapshotRecord(int type) const
+{
+    if (type == ESM::REC_INFO || type == ESM::REC_MGEF || type == ESM::REC_SKIL)
+        return true;
+
+    std::map<int, StoreBase *>::const_iterator it = mStores.find(type);
+    return it != mStores.end() && it->second->isSnapshotted();
+}
+
+void ESMStore::writeSnapshot(ESM::ESMWriter &writer) const
+{
+    for (std::map<int, StoreBase *>::const_iterator it = mStores.begin(); it != mStores.end(); ++it) {
+        if (it->second->isSnapshotted())
+            it->second->writeSnapshot(writer, it->first);
+    }
+    mMagicEffects.writeSnapshot(writer);
+    mSkills.writeSnapshot(writer);
+
+    // Record ids are stored lower case, but the id lookup keeps the case used in the content files.
+    writer.startRecord("IDLS");
+    for (std::map<std::string, int>::const_iterator it = mIds.begin(); it != mIds.end(); ++it) {
+        writer.writeHNCString("NAME", it->first);
+        writer.writeHNT("INTV", it->second);
+    }
+    writer.endRecord("IDLS");
+}
+
+void ESMStore::loadSnapshot(ESM::ESMReader &esm, Loading::Listener* listener)
+{
+    listener->setProgressRange(1000);
+
+    ESM::Dialogue *dialogue = 0;
+
+    while(esm.hasMoreRecs())
+    {
+        ESM::NAME n = esm.getRecName();
+        esm.getRecHeader();
+
+        std::map<int, StoreBase *>::iterator it = mStores.find(n.val);
+
+        if (it != mStores.end()) {
+            std::string id = esm.getHNOString("NAME");
+            it->second->load(esm, id);
+
+            if (n.val==ESM::REC_DIAL) {
+                dialogue = const_cast<ESM::Dialogue*>(mDialogs.find(id));
+            } else {
+                dialogue = 0;
+            }
+        } else if (n.val == ESM::REC_INFO) {
+            if (!dialogue)
+                esm.fail("info record without dialog");
+            dialogue->mInfo.push_back(ESM::DialInfo());
+            dialogue->mInfo.back().mId = esm.getHNOString("INAM");
+            dialogue->mInfo.back().load(esm);
+        } else if (n.val == ESM::REC_MGEF) {
+            mMagicEffects.load (esm);
+        } else if (n.val == ESM::REC_SKIL) {
+            mSkills.load (esm);
+        } else if (n == "IDLS") {
+            while (esm.hasMoreSubs()) {
+                std::string id = esm.getHNString("NAME");
+                int type;
+                esm.getHNT(type, "INTV");
+                mIds[id] = type;
+            }
+        } else {
+            esm.fail("unexpected record in snapshot");
+        }
+        listener->setProgress(esm.getFileOffset() / (float)esm.getFileSize() * 1000);
+    }
+}
+
 void ESMStore::setUp()
 {
     std::map<int, StoreBase *>::iterator it = mStores.begin();
@@ -77,6 +77,30 @@ namespace MWWorld
         unsigned int mDynamicCount;
 
     public:
+        /// Records of one content file that have been parsed, but not yet added to the store.
+        class StagedFile
+        {
+                StagedFile(const StagedFile&);
+                StagedFile& operator=(const StagedFile&);
+
+            public:
+                struct Entry
+                {
+                    int mType;
+                    std::string mId;
+                    bool mDeleted;
+
+                    /// Parsed record, or 0 if the record has to be read from mContext during merging
+                    StagedRecord *mRecord;
+                    ESM::ESM_Context mContext;
+                };
+
+                std::vector<Entry> mEntries;
+
+                StagedFile() {}
+                ~StagedFile();
+        };
+
         /// \todo replace with SharedIterator<StoreBase>
         typedef std::map<int, StoreBase *>::const_iterator iterator;
 
@@ -163,8 +187,32 @@ namespace MWWorld
             mNpcs.insert(mPlayerTemplate);
         }
 
+        /// Load all records of a content file. Equivalent to resolveMasters(), parse() and merge().
         void load(ESM::ESMReader &esm, Loading::Listener* listener);
 
+        /// Look up the indices of the master files of \a esm. All files preceding it in the
+        /// load order need to be opened already.
+        void resolveMasters(ESM::ESMReader &esm);
+
+        /// Parse all records of \a esm into \a file without modifying the store. Different files
+        /// can be parsed concurrently, as long as each thread uses its own reader and encoder.
+        /// \param skipSnapshot Skip records that have already been restored from a snapshot.
+        void parse(ESM::ESMReader &esm, StagedFile &file, bool skipSnapshot = false) const;
+
+        /// Add the records of a parsed file to the store. Files must be merged in load order.
+        void merge(ESM::ESMReader &esm, StagedFile &file, Loading::Listener* listener);
+
+        /// Is the record type included in startup snapshots?
+        bool isSnapshotRecord(int type) const;
+
+        /// Write the merged records of all snapshot record types. Must be called after all
+        /// content files have been loaded, but before setUp().
+        void writeSnapshot(ESM::ESMWriter &writer) const;
+
+        /// Restore records written by writeSnapshot(). Content files still have to be loaded
+        /// afterwards, with \a skipSnapshot set, for records that are not part of the snapshot.
+        void loadSnapshot(ESM::ESMReader &esm, Loading::Listener* listener);
+
         template <class T>
         const Store<T> &get() const {
             throw std::runtime_error("Storage for this type not exist");
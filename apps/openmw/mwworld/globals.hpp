@@ -22,23 +22,34 @@ namespace MWWorld
                 Interpreter::Type_Float mShort;
             };
         
-            typedef std::map<std::string, std::pair<char, Data> > Collection;
+            typedef std::map<std::string, int> Collection; // name, slot
         
         private:
         
-            Collection mVariables; // type, value
+            Collection mSlots;
+            std::vector<std::pair<char, Data> > mVariables; // type, value (indexed by slot)
         
-            Collection::const_iterator find (const std::string& name) const;
+            int find (const std::string& name) const;
 
-            Collection::iterator find (const std::string& name);
+            int checkSlot (int slot) const;
         
         public:
         
             Globals (const MWWorld::ESMStore& store);
+            ///< Slots are assigned in ID order of the global records in \a store, so the layout
+            /// is the same for every Globals object created from the same store (e.g. when
+            /// starting a new game). Scripts can keep slots across such a reset.
         
             const Data& operator[] (const std::string& name) const;
 
             Data& operator[] (const std::string& name);
+
+            const Data& operator[] (int slot) const;
+
+            Data& operator[] (int slot);
+
+            int getSlot (const std::string& name) const;
+            ///< If there is no global variable with this name, -1 is returned.
             
             void setInt (const std::string& name, int value);
             ///< Set value independently from real type.
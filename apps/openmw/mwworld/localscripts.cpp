@@ -6,6 +6,9 @@
 #include "class.hpp"
 #include "containerstore.hpp"
 
+#include "../mwbase/environment.hpp"
+#include "../mwbase/scriptmanager.hpp"
+
 
 namespace
 {
@@ -33,8 +36,10 @@ namespace
             cellRefList.mList.begin());
             iter!=cellRefList.mList.end(); ++iter)
         {
-           
-            MWWorld::Ptr containerPtr (&*iter, cell); 
+            if (!iter->mData.getCount())
+                continue;
+
+            MWWorld::Ptr containerPtr (&*iter, cell);
             
             MWWorld::ContainerStore& container = MWWorld::Class::get(containerPtr).getContainerStore(containerPtr);
             for(MWWorld::ContainerStoreIterator it3 = container.begin(); it3 != container.end(); ++it3)
@@ -51,7 +56,16 @@ namespace
     }
 }
 
-MWWorld::LocalScripts::LocalScripts (const MWWorld::ESMStore& store) : mStore (store) {}
+MWWorld::LocalScripts::LocalScripts (const MWWorld::ESMStore& store) : mNext (0), mStore (store) {}
+
+void MWWorld::LocalScripts::erase (std::size_t index)
+{
+    mScripts.erase (mScripts.begin()+index);
+
+    // keep pointing at the same script (or the one following an erased next script)
+    if (index<mNext)
+        --mNext;
+}
 
 void MWWorld::LocalScripts::setIgnore (const Ptr& ptr)
 {
@@ -60,31 +74,28 @@ void MWWorld::LocalScripts::setIgnore (const Ptr& ptr)
 
 void MWWorld::LocalScripts::startIteration()
 {
-    mIter = mScripts.begin();
+    mNext = 0;
 }
 
 bool MWWorld::LocalScripts::isFinished() const
 {
-    if (mIter==mScripts.end())
+    if (mNext>=mScripts.size())
         return true;
 
-    if (!mIgnore.isEmpty() && mIter->second==mIgnore)
-    {
-        std::list<std::pair<std::string, Ptr> >::iterator iter = mIter;
-        return ++iter==mScripts.end();
-    }
+    if (!mIgnore.isEmpty() && mScripts[mNext].mPtr==mIgnore)
+        return mNext+1>=mScripts.size();
 
     return false;
 }
 
-std::pair<std::string, MWWorld::Ptr> MWWorld::LocalScripts::getNext()
+MWWorld::LocalScripts::Script MWWorld::LocalScripts::getNext()
 {
     assert (!isFinished());
 
-    std::list<std::pair<std::string, Ptr> >::iterator iter = mIter++;
+    const Script& script = mScripts[mNext++];
 
-    if (mIgnore.isEmpty() || iter->second!=mIgnore)
-        return *iter;
+    if (mIgnore.isEmpty() || script.mPtr!=mIgnore)
+        return script;
 
     return getNext();
 }
@@ -95,7 +106,10 @@ void MWWorld::LocalScripts::add (const std::string& scriptName, const Ptr& ptr)
     {
         ptr.getRefData().setLocals (*script);
 
-        mScripts.push_back (std::make_pair (scriptName, ptr));
+        Script entry;
+        entry.mHandle = MWBase::Environment::get().getScriptManager()->getScriptHandle (scriptName);
+        entry.mPtr = ptr;
+        mScripts.push_back (entry);
     }
 }
 
@@ -126,50 +140,45 @@ void MWWorld::LocalScripts::addCell (Ptr::CellStore *cell)
 void MWWorld::LocalScripts::clear()
 {
     mScripts.clear();
+    mNext = 0;
 }
 
 void MWWorld::LocalScripts::clearCell (Ptr::CellStore *cell)
 {
-    std::list<std::pair<std::string, Ptr> >::iterator iter = mScripts.begin();
+    std::size_t kept = 0;
+    std::size_t next = mNext;
 
-    while (iter!=mScripts.end())
+    for (std::size_t i=0; i<mScripts.size(); ++i)
     {
-        if (iter->second.mCell==cell)
+        if (mScripts[i].mPtr.mCell==cell)
         {
-            if (iter==mIter)
-               ++mIter;
-
-            mScripts.erase (iter++);
+            if (i<mNext)
+                --next;
         }
         else
-            ++iter;
+            mScripts[kept++] = mScripts[i];
     }
+
+    mScripts.erase (mScripts.begin()+kept, mScripts.end());
+    mNext = next;
 }
 
 void MWWorld::LocalScripts::remove (RefData *ref)
 {
-    for (std::list<std::pair<std::string, Ptr> >::iterator iter = mScripts.begin();
-        iter!=mScripts.end(); ++iter)
-        if (&(iter->second.getRefData()) == ref)
+    for (std::size_t i=0; i<mScripts.size(); ++i)
+        if (&(mScripts[i].mPtr.getRefData()) == ref)
         {
-            if (iter==mIter)
-                ++mIter;
-
-            mScripts.erase (iter);
+            erase (i);
             break;
         }
 }
 
 void MWWorld::LocalScripts::remove (const Ptr& ptr)
 {
-    for (std::list<std::pair<std::string, Ptr> >::iterator iter = mScripts.begin();
-        iter!=mScripts.end(); ++iter)
-        if (iter->second==ptr)
+    for (std::size_t i=0; i<mScripts.size(); ++i)
+        if (mScripts[i].mPtr==ptr)
         {
-            if (iter==mIter)
-                ++mIter;
-
-            mScripts.erase (iter);
+            erase (i);
             break;
         }
 }
@@ -1,8 +1,8 @@
 #ifndef GAME_MWWORLD_LOCALSCRIPTS_H
 #define GAME_MWWORLD_LOCALSCRIPTS_H
 
-#include <list>
 #include <string>
+#include <vector>
 
 #include "ptr.hpp"
 
@@ -15,11 +15,23 @@ namespace MWWorld
     /// \brief List of active local scripts
     class LocalScripts
     {
-            std::list<std::pair<std::string, Ptr> > mScripts;
-            std::list<std::pair<std::string, Ptr> >::iterator mIter;
+        public:
+
+            struct Script
+            {
+                int mHandle; ///< see MWBase::ScriptManager::getScriptHandle
+                Ptr mPtr;
+            };
+
+        private:
+
+            std::vector<Script> mScripts;
+            std::size_t mNext; // index of the next script during iteration
             MWWorld::Ptr mIgnore;
             const MWWorld::ESMStore& mStore;
 
+            void erase (std::size_t index);
+
         public:
 
             LocalScripts (const MWWorld::ESMStore& store);
@@ -34,11 +46,11 @@ namespace MWWorld
             bool isFinished() const;
             ///< Is iteration finished?
 
-            std::pair<std::string, Ptr> getNext();
+            Script getNext();
             ///< Get next local script (must not be called if isFinished())
 
             void add (const std::string& scriptName, const Ptr& ptr);
-            ///< Add script to collection of active local scripts.
+            ///< Add script to collection of active local scripts (resolves the script handle).
 
             void addCell (CellStore *cell);
             ///< Add all local scripts in a cell.
@@ -2,6 +2,11 @@
 
 #include <stdexcept>
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #include <OgreRoot.h>
 #include <OgreRenderWindow.h>
 #include <OgreSceneManager.h>
@@ -14,6 +19,7 @@
 #include <openengine/ogre/renderer.hpp>
 
 #include <components/nifbullet/bulletnifloader.hpp>
+#include <components/settings/settings.hpp>
 
 #include "../mwbase/world.hpp" // FIXME
 #include "../mwbase/environment.hpp"
@@ -33,6 +39,15 @@ namespace MWWorld
     // Arbitrary number. To prevent infinite loops. They shouldn't happen but it's good to be prepared.
     static const int sMaxIterations = 8;
 
+    // Bullet's broadphase shares one traversal stack between all queries (and its profiler is not
+    // thread safe either), unless Bullet has been built thread safe. CMake defines BT_THREADSAFE
+    // if it detects such a build.
+#if BT_THREADSAFE
+    static const bool sParallelTraces = true;
+#else
+    static const bool sParallelTraces = false;
+#endif
+
     class MovementSolver
     {
     private:
@@ -43,7 +58,7 @@ namespace MWWorld
 
         static bool stepMove(btCollisionObject *colobj, Ogre::Vector3 &position,
                              const Ogre::Vector3 &velocity, float &remainingTime,
-                             OEngine::Physic::PhysicEngine *engine)
+                             const OEngine::Physic::PhysicEngine *engine)
         {
             OEngine::Physic::ActorTracer tracer, stepper;
 
@@ -105,21 +120,25 @@ namespace MWWorld
             return tracer.mEndPos;
         }
 
-        static Ogre::Vector3 move(const MWWorld::Ptr &ptr, const Ogre::Vector3 &movement, float time,
-                                  bool isFlying, float waterlevel, OEngine::Physic::PhysicEngine *engine)
+        /// Only reads the collision world and the job's actor, so several jobs can be solved at once.
+        static void move(MovementJob &job, float time, const OEngine::Physic::PhysicEngine *engine)
         {
-            const ESM::Position &refpos = ptr.getRefData().getPosition();
+            const ESM::Position &refpos = job.mRefPos;
+            const Ogre::Vector3 &movement = job.mMovement;
+            const bool isFlying = job.mIsFlying;
+            float waterlevel = job.mWaterLevel;
             Ogre::Vector3 position(refpos.pos);
 
             /* Anything to collide with? */
-            OEngine::Physic::PhysicActor *physicActor = engine->getCharacter(ptr.getRefData().getHandle());
-            if(!physicActor || !physicActor->getCollisionMode())
+            const OEngine::Physic::PhysicActor *physicActor = job.mActor;
+            if(!physicActor)
             {
                 // FIXME: This works, but it's inconcsistent with how the rotations are applied elsewhere. Why?
-                return position + (Ogre::Quaternion(Ogre::Radian(-refpos.rot[2]), Ogre::Vector3::UNIT_Z)*
-                                   Ogre::Quaternion(Ogre::Radian(-refpos.rot[1]), Ogre::Vector3::UNIT_Y)*
-                                   Ogre::Quaternion(Ogre::Radian( refpos.rot[0]), Ogre::Vector3::UNIT_X)) *
-                                  movement * time;
+                job.mPosition = position + (Ogre::Quaternion(Ogre::Radian(-refpos.rot[2]), Ogre::Vector3::UNIT_Z)*
+                                            Ogre::Quaternion(Ogre::Radian(-refpos.rot[1]), Ogre::Vector3::UNIT_Y)*
+                                            Ogre::Quaternion(Ogre::Radian( refpos.rot[0]), Ogre::Vector3::UNIT_X)) *
+                                           movement * time;
+                return;
             }
 
             btCollisionObject *colobj = physicActor->getCollisionBody();
@@ -224,30 +243,163 @@ namespace MWWorld
             }
 
             if(isOnGround || newPosition.z < waterlevel || isFlying)
-                physicActor->setInertialForce(Ogre::Vector3(0.0f));
+                job.mInertialForce = Ogre::Vector3(0.0f);
             else
             {
                 inertia.z += time*-627.2f;
-                physicActor->setInertialForce(inertia);
+                job.mInertialForce = inertia;
             }
-            physicActor->setOnGround(isOnGround);
+            job.mOnGround = isOnGround;
 
             newPosition.z -= halfExtents.z;
-            return newPosition;
+            job.mPosition = newPosition;
         }
     };
 
 
+    /// \brief Solves the movement of all queued actors on several threads
+    ///
+    /// The main thread takes part in solving and waits until all jobs are done. The collision
+    /// world can not change in the meantime, so the workers trace through it without copying it.
+    class MovementSolverPool
+    {
+            const OEngine::Physic::PhysicEngine *mEngine;
+            float mTime;
+            std::vector<MovementJob> *mJobs; ///< only set while run is solving them
+            std::size_t mCount; // the job list may be refilled while workers are still checking for jobs
+            std::size_t mNext;
+            std::size_t mDone;
+            unsigned int mGeneration;
+            bool mQuit;
+
+            boost::mutex mMutex;
+            boost::condition_variable mStarted;
+            boost::condition_variable mFinished;
+            boost::thread_group mThreads;
+
+            // not implemented
+            MovementSolverPool (const MovementSolverPool&);
+            MovementSolverPool& operator= (const MovementSolverPool&);
+
+            void solve()
+            {
+                while (true)
+                {
+                    std::size_t index;
+                    {
+                        boost::lock_guard<boost::mutex> lock (mMutex);
+                        if (mNext>=mCount)
+                            return;
+                        index = mNext++;
+                    }
+
+                    MovementSolver::move ((*mJobs)[index], mTime, mEngine);
+
+                    boost::lock_guard<boost::mutex> lock (mMutex);
+                    if (++mDone==mCount)
+                        mFinished.notify_all();
+                }
+            }
+
+            // boost::thread entry point
+            void work()
+            {
+                unsigned int generation = 0;
+
+                while (true)
+                {
+                    {
+                        boost::unique_lock<boost::mutex> lock (mMutex);
+
+                        while (generation==mGeneration && !mQuit)
+                            mStarted.wait (lock);
+
+                        if (mQuit)
+                            return;
+
+                        generation = mGeneration;
+                    }
+
+                    solve();
+                }
+            }
+
+        public:
+
+            /// \param threads including the main thread
+            MovementSolverPool (int threads, const OEngine::Physic::PhysicEngine *engine)
+            : mEngine (engine), mTime (0), mJobs (0), mCount (0), mNext (0), mDone (0), mGeneration (0), mQuit (false)
+            {
+                for (int i=1; i<threads; ++i)
+                    mThreads.create_thread (boost::bind (&MovementSolverPool::work, this));
+            }
+
+            ~MovementSolverPool()
+            {
+                {
+                    boost::lock_guard<boost::mutex> lock (mMutex);
+                    mQuit = true;
+                }
+
+                mStarted.notify_all();
+                mThreads.join_all();
+            }
+
+            /// Solve \a jobs and wait until all are done. The collision world must be locked
+            /// (see PhysicEngine::setLocked).
+            void run (std::vector<MovementJob>& jobs, float time)
+            {
+                if (mThreads.size()==0 || jobs.size()<2)
+                {
+                    for (std::vector<MovementJob>::iterator iter (jobs.begin()); iter!=jobs.end(); ++iter)
+                        MovementSolver::move (*iter, time, mEngine);
+
+                    return;
+                }
+
+                {
+                    boost::lock_guard<boost::mutex> lock (mMutex);
+                    mJobs = &jobs;
+                    mTime = time;
+                    mCount = jobs.size();
+                    mNext = 0;
+                    mDone = 0;
+                    ++mGeneration;
+                }
+
+                mStarted.notify_all();
+
+                solve();
+
+                boost::unique_lock<boost::mutex> lock (mMutex);
+                while (mDone<mCount)
+                    mFinished.wait (lock);
+
+                mJobs = 0;
+            }
+    };
+
+
     PhysicsSystem::PhysicsSystem(OEngine::Render::OgreRenderer &_rend) :
-        mRender(_rend), mEngine(0), mTimeAccum(0.0f)
+        mRender(_rend), mEngine(0), mSolver(0), mTimeAccum(0.0f)
     {
         // Create physics. shapeLoader is deleted by the physic engine
         NifBullet::ManualBulletShapeLoader* shapeLoader = new NifBullet::ManualBulletShapeLoader();
         mEngine = new OEngine::Physic::PhysicEngine(shapeLoader);
+
+        int threads = 1;
+        if(sParallelTraces)
+        {
+            threads = Settings::Manager::getInt("movement threads", "Physics");
+            if(threads <= 0)
+                threads = std::max(1u, boost::thread::hardware_concurrency());
+        }
+        mSolver = new MovementSolverPool(threads, mEngine);
     }
 
     PhysicsSystem::~PhysicsSystem()
     {
+        delete mSolver;
         delete mEngine;
     }
 
@@ -544,14 +696,13 @@ namespace MWWorld
 
     void PhysicsSystem::queueObjectMovement(const Ptr &ptr, const Ogre::Vector3 &movement)
     {
-        PtrVelocityList::iterator iter = mMovementQueue.begin();
-        for(;iter != mMovementQueue.end();iter++)
+        std::pair<std::map<Ptr, std::size_t>::iterator, bool> result =
+            mMovementIndex.insert(std::make_pair(ptr, mMovementQueue.size()));
+
+        if(!result.second)
         {
-            if(iter->first == ptr)
-            {
-                iter->second = movement;
-                return;
-            }
+            mMovementQueue[result.first->second].second = movement;
+            return;
         }
 
         mMovementQueue.push_back(std::make_pair(ptr, movement));
@@ -565,23 +716,49 @@ namespace MWWorld
         if(mTimeAccum >= 1.0f/60.0f)
         {
             const MWBase::World *world = MWBase::Environment::get().getWorld();
-            PtrVelocityList::iterator iter = mMovementQueue.begin();
-            for(;iter != mMovementQueue.end();iter++)
+
+            std::vector<MovementJob> &jobs = mMovementJobs;
+            jobs.resize(mMovementQueue.size());
+
+            for(std::size_t i = 0;i < mMovementQueue.size();++i)
             {
-                float waterlevel = -std::numeric_limits<float>::max();
-                const ESM::Cell *cell = iter->first.getCell()->mCell;
+                const Ptr &ptr = mMovementQueue[i].first;
+                MovementJob &job = jobs[i];
+
+                job.mPtr = ptr;
+                job.mRefPos = ptr.getRefData().getPosition();
+                job.mMovement = mMovementQueue[i].second;
+                job.mIsFlying = world->isFlying(ptr);
+
+                job.mWaterLevel = -std::numeric_limits<float>::max();
+                const ESM::Cell *cell = ptr.getCell()->mCell;
                 if(cell->hasWater())
-                    waterlevel = cell->mWater;
+                    job.mWaterLevel = cell->mWater;
+
+                job.mActor = mEngine->getCharacter(ptr.getRefData().getHandle());
+                if(job.mActor && !job.mActor->getCollisionMode())
+                    job.mActor = 0;
+            }
+
+            mEngine->setLocked(true);
+            mSolver->run(jobs, mTimeAccum);
+            mEngine->setLocked(false);
+
+            for(std::vector<MovementJob>::const_iterator iter = jobs.begin();iter != jobs.end();++iter)
+            {
+                if(iter->mActor)
+                {
+                    iter->mActor->setInertialForce(iter->mInertialForce);
+                    iter->mActor->setOnGround(iter->mOnGround);
+                }
 
-                Ogre::Vector3 newpos = MovementSolver::move(iter->first, iter->second, mTimeAccum,
-                                                            world->isFlying(iter->first),
-                                                            waterlevel, mEngine);
-                mMovementResults.push_back(std::make_pair(iter->first, newpos));
+                mMovementResults.push_back(std::make_pair(iter->mPtr, iter->mPosition));
             }
 
             mTimeAccum = 0.0f;
         }
         mMovementQueue.clear();
+        mMovementIndex.clear();
 
         return mMovementResults;
     }
@@ -5,6 +5,8 @@
 
 #include <btBulletCollisionCommon.h>
 
+#include <components/esm/defs.hpp>
+
 #include "ptr.hpp"
 
 
@@ -17,15 +19,34 @@ namespace OEngine
     namespace Physic
     {
         class PhysicEngine;
+        class PhysicActor;
     }
 }
 
 namespace MWWorld
 {
     class World;
+    class MovementSolverPool;
 
     typedef std::vector<std::pair<Ptr,Ogre::Vector3> > PtrVelocityList;
 
+    /// Movement of one actor. The input is copied from the game world by the main thread, so that
+    /// solving does not touch the world, and the results are applied by the main thread as well.
+    struct MovementJob
+    {
+        Ptr mPtr;
+        OEngine::Physic::PhysicActor *mActor; ///< 0: no collisions (only read while solving)
+        ESM::Position mRefPos;
+        Ogre::Vector3 mMovement;
+        bool mIsFlying;
+        float mWaterLevel;
+
+        // results
+        Ogre::Vector3 mPosition;
+        Ogre::Vector3 mInertialForce;
+        bool mOnGround;
+    };
+
     class PhysicsSystem
     {
         public:
@@ -87,10 +108,13 @@ namespace MWWorld
 
             OEngine::Render::OgreRenderer &mRender;
             OEngine::Physic::PhysicEngine* mEngine;
+            MovementSolverPool* mSolver;
             std::map<std::string, std::string> handleToMesh;
 
             PtrVelocityList mMovementQueue;
+            std::map<Ptr, std::size_t> mMovementIndex; ///< position of each Ptr in mMovementQueue
             PtrVelocityList mMovementResults;
+            std::vector<MovementJob> mMovementJobs; ///< reused by applyQueuedMovement
 
             float mTimeAccum;
 
@@ -1,8 +1,13 @@
 #include "scene.hpp"
 
+#include <algorithm>
+
 #include <OgreSceneNode.h>
 
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
 #include <components/nif/niffile.hpp>
+#include <components/settings/settings.hpp>
 
 #include <libs/openengine/ogre/fader.hpp>
 
@@ -23,54 +28,106 @@
 namespace
 {
 
+    void insertRef(MWRender::RenderingManager& rendering, const MWWorld::Ptr& ptr,
+        MWWorld::PhysicsSystem& physics, MWWorld::Scene::HandleMap& handles)
+    {
+        const MWWorld::Class& class_ = MWWorld::Class::get (ptr);
+
+        try
+        {
+            rendering.addObject(ptr);
+            if (ptr.getRefData().getBaseNode())
+                handles[ptr.getRefData().getHandle()] = ptr;
+            class_.insertObject(ptr, physics);
+
+            float ax = Ogre::Radian(ptr.getRefData().getLocalRotation().rot[0]).valueDegrees();
+            float ay = Ogre::Radian(ptr.getRefData().getLocalRotation().rot[1]).valueDegrees();
+            float az = Ogre::Radian(ptr.getRefData().getLocalRotation().rot[2]).valueDegrees();
+            MWBase::Environment::get().getWorld()->localRotateObject(ptr, ax, ay, az);
+
+            MWBase::Environment::get().getWorld()->scaleObject(ptr, ptr.getCellRef().mScale);
+            class_.adjustPosition(ptr);
+        }
+        catch (const std::exception& e)
+        {
+            std::string error ("error during rendering: ");
+            std::cerr << error + e.what() << std::endl;
+        }
+    }
+
+    template<typename T>
+    void rescaleRef(T& ref)
+    {
+        if (ref.mRef.mScale<0.5)
+            ref.mRef.mScale = 0.5;
+        else if (ref.mRef.mScale>2)
+            ref.mRef.mScale = 2;
+    }
+
     template<typename T>
     void insertCellRefList(MWRender::RenderingManager& rendering,
-        T& cellRefList, MWWorld::CellStore &cell, MWWorld::PhysicsSystem& physics, bool rescale, Loading::Listener* loadingListener)
+        T& cellRefList, MWWorld::CellStore &cell, MWWorld::PhysicsSystem& physics, bool rescale, Loading::Listener* loadingListener,
+        MWWorld::Scene::HandleMap& handles)
     {
-        if (!cellRefList.mList.empty())
+        for (typename T::List::iterator it = cellRefList.mList.begin();
+            it != cellRefList.mList.end(); it++)
         {
-            const MWWorld::Class& class_ =
-                MWWorld::Class::get (MWWorld::Ptr (&*cellRefList.mList.begin(), &cell));
-            for (typename T::List::iterator it = cellRefList.mList.begin();
-                it != cellRefList.mList.end(); it++)
-            {
-                if (rescale)
-                {
-                    if (it->mRef.mScale<0.5)
-                        it->mRef.mScale = 0.5;
-                    else if (it->mRef.mScale>2)
-                        it->mRef.mScale = 2;
-                }
+            if (rescale)
+                rescaleRef(*it);
 
-                if (it->mData.getCount() && it->mData.isEnabled())
-                {
-                    MWWorld::Ptr ptr (&*it, &cell);
-
-                    try
-                    {
-                        rendering.addObject(ptr);
-                        class_.insertObject(ptr, physics);
-
-                        float ax = Ogre::Radian(ptr.getRefData().getLocalRotation().rot[0]).valueDegrees();
-                        float ay = Ogre::Radian(ptr.getRefData().getLocalRotation().rot[1]).valueDegrees();
-                        float az = Ogre::Radian(ptr.getRefData().getLocalRotation().rot[2]).valueDegrees();
-                        MWBase::Environment::get().getWorld()->localRotateObject(ptr, ax, ay, az);
-
-                        MWBase::Environment::get().getWorld()->scaleObject(ptr, ptr.getCellRef().mScale);
-                        class_.adjustPosition(ptr);
-                    }
-                    catch (const std::exception& e)
-                    {
-                        std::string error ("error during rendering: ");
-                        std::cerr << error + e.what() << std::endl;
-                    }
-                }
+            if (it->mData.getCount() && it->mData.isEnabled())
+                insertRef(rendering, MWWorld::Ptr (&*it, &cell), physics, handles);
 
-                loadingListener->increaseProgress(1);
-            }
+            loadingListener->increaseProgress(1);
+        }
+    }
+
+    /// List the references of \a cellRefList that have to be inserted into the scene
+    template<typename T>
+    void queueCellRefList(T& cellRefList, MWWorld::CellStore &cell, bool rescale,
+        std::vector<MWWorld::Ptr>& queue)
+    {
+        for (typename T::List::iterator it = cellRefList.mList.begin();
+            it != cellRefList.mList.end(); it++)
+        {
+            if (rescale)
+                rescaleRef(*it);
+
+            if (it->mData.getCount() && it->mData.isEnabled())
+                queue.push_back(MWWorld::Ptr (&*it, &cell));
         }
     }
 
+    /// Insertion priority of \a ptr (lower first): nearest to the player first, but actors last,
+    /// because adjustPosition needs the objects below them.
+    float getInsertionPriority (const MWWorld::Ptr& ptr, const Ogre::Vector3& playerPos)
+    {
+        const float *pos = ptr.getRefData().getPosition().pos;
+        float distance = playerPos.squaredDistance (Ogre::Vector3 (pos[0], pos[1], pos[2]));
+
+        return MWWorld::Class::get (ptr).isActor() ? distance + 1e12f : distance;
+    }
+
+    /// Sorts objects by descending insertion priority, so that the next object to insert is at
+    /// the back.
+    bool compareInsertionOrder (const MWWorld::Scene::PendingObject& left,
+        const MWWorld::Scene::PendingObject& right)
+    {
+        return left.mPriority>right.mPriority;
+    }
+
+    struct IsInCell
+    {
+        const MWWorld::CellStore *mCell;
+
+        IsInCell (const MWWorld::CellStore *cell) : mCell (cell) {}
+
+        bool operator() (const MWWorld::Scene::PendingObject& object) const
+        {
+            return object.mPtr.getCell()==mCell;
+        }
+    };
+
 }
 
 
@@ -79,6 +136,9 @@ namespace MWWorld
 
     void Scene::update (float duration, bool paused){
         mRendering.update (duration, paused);
+
+        if (!mPendingCells.empty())
+            insertPending();
     }
 
     void Scene::unloadCell (CellStoreCollection::iterator iter)
@@ -94,6 +154,7 @@ namespace MWWorld
             {
                 Ogre::SceneNode* node = *iter2;
                 mPhysics->removeObject (node->getName());
+                mHandles.erase (node->getName());
             }
         }
 
@@ -108,6 +169,10 @@ namespace MWWorld
                 mPhysics->removeHeightField( (*iter)->mCell->getGridX(), (*iter)->mCell->getGridY() );
         }
 
+        if (mPendingCells.erase (*iter))
+            mPendingObjects.erase (std::remove_if (mPendingObjects.begin(), mPendingObjects.end(),
+                IsInCell (*iter)), mPendingObjects.end());
+
         mRendering.removeCell(*iter);
 
         MWBase::Environment::get().getWorld()->getLocalScripts().clearCell (*iter);
@@ -118,7 +183,7 @@ namespace MWWorld
         mActiveCells.erase(*iter);
     }
 
-    void Scene::loadCell (Ptr::CellStore *cell, Loading::Listener* loadingListener)
+    void Scene::loadCell (Ptr::CellStore *cell, Loading::Listener* loadingListener, bool incremental)
     {
         std::pair<CellStoreCollection::iterator, bool> result = mActiveCells.insert(cell);
 
@@ -149,20 +214,120 @@ namespace MWWorld
 
             // ... then references. This is important for adjustPosition to work correctly.
             /// \todo rescale depending on the state of a new GMST
-            insertCell (*cell, true, loadingListener);
+            if (incremental)
+            {
+                queueCell (*cell, true);
+                return;
+            }
 
-            mRendering.cellAdded (cell);
+            insertCell (*cell, true, loadingListener);
 
-            mRendering.configureAmbient(*cell);
-            mRendering.requestMap(cell);
-            mRendering.configureAmbient(*cell);
+            finishCell (cell);
         }
+        else if (mPendingCells.find (cell)!=mPendingCells.end())
+            return; // local scripts are registered once the cell is complete
 
         // register local scripts
         // ??? Should this go into the above if block ???
         MWBase::Environment::get().getWorld()->getLocalScripts().addCell (cell);
     }
 
+    void Scene::finishCell (CellStore *cell)
+    {
+        mRendering.cellAdded (cell);
+
+        mRendering.configureAmbient(*cell);
+        mRendering.requestMap(cell);
+        mRendering.configureAmbient(*cell);
+    }
+
+    void Scene::queueCell (Ptr::CellStore &cell, bool rescale)
+    {
+        std::vector<Ptr> objects;
+
+        queueCellRefList(cell.mActivators, cell, rescale, objects);
+        queueCellRefList(cell.mPotions, cell, rescale, objects);
+        queueCellRefList(cell.mAppas, cell, rescale, objects);
+        queueCellRefList(cell.mArmors, cell, rescale, objects);
+        queueCellRefList(cell.mBooks, cell, rescale, objects);
+        queueCellRefList(cell.mClothes, cell, rescale, objects);
+        queueCellRefList(cell.mContainers, cell, rescale, objects);
+        queueCellRefList(cell.mDoors, cell, rescale, objects);
+        queueCellRefList(cell.mIngreds, cell, rescale, objects);
+        queueCellRefList(cell.mCreatureLists, cell, rescale, objects);
+        queueCellRefList(cell.mItemLists, cell, rescale, objects);
+        queueCellRefList(cell.mLights, cell, rescale, objects);
+        queueCellRefList(cell.mLockpicks, cell, rescale, objects);
+        queueCellRefList(cell.mMiscItems, cell, rescale, objects);
+        queueCellRefList(cell.mProbes, cell, rescale, objects);
+        queueCellRefList(cell.mRepairs, cell, rescale, objects);
+        queueCellRefList(cell.mStatics, cell, rescale, objects);
+        queueCellRefList(cell.mWeapons, cell, rescale, objects);
+        queueCellRefList(cell.mCreatures, cell, rescale, objects);
+        queueCellRefList(cell.mNpcs, cell, rescale, objects);
+
+        mPendingCells[&cell] = static_cast<int> (objects.size());
+
+        const float *pos =
+            MWBase::Environment::get().getWorld()->getPlayer().getPlayer().getRefData().getPosition().pos;
+        Ogre::Vector3 playerPos (pos[0], pos[1], pos[2]);
+
+        // The objects already queued are sorted. Sort the new ones and merge them in, the
+        // priority of each object is computed once only.
+        std::size_t size = mPendingObjects.size();
+        mPendingObjects.reserve (size+objects.size());
+
+        for (std::vector<Ptr>::const_iterator iter (objects.begin()); iter!=objects.end(); ++iter)
+        {
+            PendingObject object;
+            object.mPtr = *iter;
+            object.mPriority = getInsertionPriority (*iter, playerPos);
+            mPendingObjects.push_back (object);
+        }
+
+        std::sort (mPendingObjects.begin()+size, mPendingObjects.end(), compareInsertionOrder);
+        std::inplace_merge (mPendingObjects.begin(), mPendingObjects.begin()+size,
+            mPendingObjects.end(), compareInsertionOrder);
+    }
+
+    void Scene::insertPending()
+    {
+        boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+        // at least one object per frame
+        while (!mPendingObjects.empty())
+        {
+            Ptr ptr = mPendingObjects.back().mPtr;
+            mPendingObjects.pop_back();
+
+            --mPendingCells[ptr.getCell()];
+
+            // may have been disabled, deleted or added to the scene in the meantime
+            if (ptr.getRefData().getCount() && ptr.getRefData().isEnabled() &&
+                !ptr.getRefData().getBaseNode())
+                insertRef (mRendering, ptr, *mPhysics, mHandles);
+
+            if ((boost::posix_time::microsec_clock::universal_time()-start).total_microseconds()>=
+                mAttachBudget*1000)
+                break;
+        }
+
+        // Building the static geometry of a cell is expensive. Only one cell per frame.
+        for (std::map<CellStore *, int>::iterator iter (mPendingCells.begin());
+            iter!=mPendingCells.end(); ++iter)
+        {
+            if (iter->second==0)
+            {
+                CellStore *cell = iter->first;
+                mPendingCells.erase (iter);
+
+                finishCell (cell);
+                MWBase::Environment::get().getWorld()->getLocalScripts().addCell (cell);
+                break;
+            }
+        }
+    }
+
     void Scene::playerCellChange(MWWorld::CellStore *cell, const ESM::Position& pos, bool adjustPlayerPos)
     {
         MWBase::World *world = MWBase::Environment::get().getWorld();
@@ -212,6 +377,10 @@ namespace MWWorld
         std::string loadingExteriorText = "#{sLoadingMessage3}";
         loadingListener->setLabel(loadingExteriorText);
 
+        // When walking across a cell border, the player's new cell is already active. The cells
+        // coming into view can then be inserted over the following frames.
+        bool incremental = !adjustPlayerPos && mAttachBudget>0;
+
         CellStoreCollection::iterator active = mActiveCells.begin();
 
         // get the number of cells to unload
@@ -266,7 +435,7 @@ namespace MWWorld
                     ++iter;
                 }
 
-                if (iter==mActiveCells.end())
+                if (iter==mActiveCells.end() && !(incremental && (x!=X || y!=Y)))
                     refsToLoad += countRefs(*MWBase::Environment::get().getWorld()->getExterior(x, y));
             }
 
@@ -293,7 +462,7 @@ namespace MWWorld
                 {
                     CellStore *cell = MWBase::Environment::get().getWorld()->getExterior(x, y);
 
-                    loadCell (cell, loadingListener);
+                    loadCell (cell, loadingListener, incremental && (x!=X || y!=Y));
                 }
             }
 
@@ -330,7 +499,8 @@ namespace MWWorld
 
     //We need the ogre renderer and a scene node.
     Scene::Scene (MWRender::RenderingManager& rendering, PhysicsSystem *physics)
-    : mCurrentCell (0), mCellChanged (false), mPhysics(physics), mRendering(rendering)
+    : mCurrentCell (0), mCellChanged (false), mPhysics(physics), mRendering(rendering),
+      mAttachBudget (Settings::Manager::getFloat ("attach budget", "Cells"))
     {
     }
 
@@ -477,32 +647,34 @@ namespace MWWorld
     void Scene::insertCell (Ptr::CellStore &cell, bool rescale, Loading::Listener* loadingListener)
     {
         // Loop through all references in the cell
-        insertCellRefList(mRendering, cell.mActivators, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mPotions, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mAppas, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mArmors, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mBooks, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mClothes, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mContainers, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mDoors, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mIngreds, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mCreatureLists, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mItemLists, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mLights, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mLockpicks, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mMiscItems, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mProbes, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mRepairs, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mStatics, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mWeapons, cell, *mPhysics, rescale, loadingListener);
+        insertCellRefList(mRendering, cell.mActivators, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mPotions, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mAppas, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mArmors, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mBooks, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mClothes, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mContainers, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mDoors, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mIngreds, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mCreatureLists, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mItemLists, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mLights, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mLockpicks, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mMiscItems, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mProbes, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mRepairs, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mStatics, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mWeapons, cell, *mPhysics, rescale, loadingListener, mHandles);
         // Load NPCs and creatures _after_ everything else (important for adjustPosition to work correctly)
-        insertCellRefList(mRendering, cell.mCreatures, cell, *mPhysics, rescale, loadingListener);
-        insertCellRefList(mRendering, cell.mNpcs, cell, *mPhysics, rescale, loadingListener);
+        insertCellRefList(mRendering, cell.mCreatures, cell, *mPhysics, rescale, loadingListener, mHandles);
+        insertCellRefList(mRendering, cell.mNpcs, cell, *mPhysics, rescale, loadingListener, mHandles);
     }
 
     void Scene::addObjectToScene (const Ptr& ptr)
     {
         mRendering.addObject(ptr);
+        if (ptr.getRefData().getBaseNode())
+            mHandles[ptr.getRefData().getHandle()] = ptr;
         MWWorld::Class::get(ptr).insertObject(ptr, *mPhysics);
         MWBase::Environment::get().getWorld()->rotateObject(ptr, 0, 0, 0, true);
         MWBase::Environment::get().getWorld()->scaleObject(ptr, ptr.getCellRef().mScale);
@@ -513,6 +685,7 @@ namespace MWWorld
         MWBase::Environment::get().getMechanicsManager()->remove (ptr);
         MWBase::Environment::get().getSoundManager()->stopSound3D (ptr);
         mPhysics->removeObject (ptr.getRefData().getHandle());
+        mHandles.erase (ptr.getRefData().getHandle());
         mRendering.removeObject (ptr);
     }
 
@@ -527,4 +700,26 @@ namespace MWWorld
         }
         return false;
     }
+
+    void Scene::updateObjectCell (const Ptr& old, const Ptr& cur)
+    {
+        if (cur.getRefData().getBaseNode())
+            mHandles[cur.getRefData().getHandle()] = cur;
+        else
+            mHandles.erase (old.getRefData().getHandle());
+    }
+
+    Ptr Scene::searchPtrViaHandle (const std::string& handle) const
+    {
+        HandleMap::const_iterator iter = mHandles.find (handle);
+
+        if (iter==mHandles.end())
+            return Ptr();
+
+        // should not happen, but don't hand out deleted references
+        if (!iter->second.getRefData().getCount() || !iter->second.getRefData().getBaseNode())
+            return Ptr();
+
+        return iter->second;
+    }
 }
@@ -1,6 +1,17 @@
 #ifndef GAME_MWWORLD_SCENE_H
 #define GAME_MWWORLD_SCENE_H
 
+#ifdef _WIN32
+#include <boost/tr1/tr1/unordered_map>
+#elif defined HAVE_UNORDERED_MAP
+#include <unordered_map>
+#else
+#include <tr1/unordered_map>
+#endif
+
+#include <map>
+#include <vector>
+
 #include "../mwrender/renderingmanager.hpp"
 
 #include "ptr.hpp"
@@ -44,6 +55,16 @@ namespace MWWorld
 
             typedef std::set<CellStore *> CellStoreCollection;
 
+            /// Ogre handle -> reference, for all objects in the scene
+            typedef std::tr1::unordered_map<std::string, Ptr> HandleMap;
+
+            /// Object queued for insertion by insertPending
+            struct PendingObject
+            {
+                Ptr mPtr;
+                float mPriority; ///< objects with lower values are inserted first
+            };
+
         private:
 
             //OEngine::Render::OgreRenderer& mRenderer;
@@ -52,12 +73,28 @@ namespace MWWorld
             bool mCellChanged;
             PhysicsSystem *mPhysics;
             MWRender::RenderingManager& mRendering;
+            HandleMap mHandles;
+
+            // incremental insertion of cells
+            float mAttachBudget; // milliseconds per frame, 0: insert cells at once
+            std::vector<PendingObject> mPendingObjects; // in reverse order of insertion
+            std::map<CellStore *, int> mPendingCells; // number of objects still to insert
 
             void playerCellChange (CellStore *cell, const ESM::Position& position,
                 bool adjustPlayerPos = true);
 
             void insertCell (Ptr::CellStore &cell, bool rescale, Loading::Listener* loadingListener);
 
+            /// Queue the objects of \a cell for insertion by insertPending.
+            void queueCell (Ptr::CellStore &cell, bool rescale);
+
+            /// Insert queued objects (nearest to the player first) until the frame's budget is
+            /// used up, then complete at most one cell whose objects have all been inserted.
+            void insertPending();
+
+            /// Steps of loadCell that have to wait until all objects of the cell are inserted.
+            void finishCell (CellStore *cell);
+
             int countRefs (const Ptr::CellStore& cell);
 
         public:
@@ -68,7 +105,10 @@ namespace MWWorld
 
             void unloadCell (CellStoreCollection::iterator iter);
 
-            void loadCell (CellStore *cell, Loading::Listener* loadingListener);
+            void loadCell (CellStore *cell, Loading::Listener* loadingListener,
+                bool incremental = false);
+            ///< \param incremental Spread the insertion of the cell's objects over the following
+            /// frames (see [Cells] attach budget). Only the terrain is added right away.
 
             void changeCell (int X, int Y, const ESM::Position& position, bool adjustPlayerPos);
 
@@ -99,6 +139,13 @@ namespace MWWorld
             ///< Remove an object from the scene, but not from the world model.
 
             bool isCellActive(const CellStore &cell);
+
+            void updateObjectCell (const Ptr& old, const Ptr& cur);
+            ///< \a old has been moved to another cell as \a cur. If \a cur has taken over the scene
+            /// node, its handle now refers to \a cur, otherwise the handle of \a old is dropped.
+
+            Ptr searchPtrViaHandle (const std::string& handle) const;
+            ///< Return an empty Ptr, if no object in the scene has this handle.
     };
 }
 
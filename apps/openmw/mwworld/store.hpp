@@ -4,12 +4,22 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <stdexcept>
 
+#include <components/esm/esmwriter.hpp>
+#include <components/misc/stringindex.hpp>
+
 #include "recordcmp.hpp"
 
 namespace MWWorld
 {
+    /// Record that has been parsed (possibly on a worker thread), but not yet added to its store
+    struct StagedRecord
+    {
+        virtual ~StagedRecord() {}
+    };
+
     struct StoreBase
     {
         virtual ~StoreBase() {}
@@ -20,6 +30,23 @@ namespace MWWorld
         virtual size_t getSize() const = 0;
         virtual void load(ESM::ESMReader &esm, const std::string &id) = 0;
 
+        /// Parse a record without modifying the store. Must not touch any shared state, so that
+        /// different content files can be parsed concurrently.
+        /// \return 0, if the record depends on previously loaded data and has to go through load()
+        /// in load order instead.
+        virtual StagedRecord *loadStaged(ESM::ESMReader &esm, const std::string &id) const { return 0; }
+
+        /// Add a record returned by loadStaged() to the store.
+        virtual void applyStaged(StagedRecord &record) {}
+
+        /// Can the records of this store be restored from a startup snapshot? Stores whose
+        /// records refer back into their content file (e.g. via ESM_Context) can not.
+        virtual bool isSnapshotted() const { return false; }
+
+        /// Write all static records in a form that can be read back by load().
+        /// \param type Record type this store is registered for
+        virtual void writeSnapshot(ESM::ESMWriter &writer, int type) const {}
+
         virtual bool eraseStatic(const std::string &id) {return false;}
         virtual void clearDynamic() {}
     };
@@ -95,31 +122,103 @@ namespace MWWorld
         typedef std::map<std::string, T> Dynamic;
         typedef std::map<std::string, T> Static;
 
-        class GetRecords {
-            const std::string mFind;
-            std::vector<const T*> *mRecords;
+        // Hash indices over the map keys, for lookups without allocating a lower case copy
+        Misc::StringIndex<T> mStaticIndex;
+        Misc::StringIndex<T> mDynamicIndex;
 
-        public:
-            GetRecords(const std::string &str, std::vector<const T*> *records)
-              : mFind(Misc::StringUtils::lowerCase(str)), mRecords(records)
-            { }
+        // Non-zero record header flags of the static records (e.g. persistent NPCs), so that
+        // snapshots can write them back.
+        std::map<std::string, unsigned int> mRecordFlags;
 
-            void operator()(const T *item)
-            {
-                if(Misc::StringUtils::ciCompareLen(mFind, item->mId, mFind.size()) == 0)
-                    mRecords->push_back(item);
+        void setRecordFlags(const std::string &idLower, unsigned int flags) {
+            if (flags != 0)
+                mRecordFlags[idLower] = flags;
+            else
+                mRecordFlags.erase(idLower);
+        }
+
+        unsigned int getRecordFlags(const std::string &idLower) const {
+            std::map<std::string, unsigned int>::const_iterator it = mRecordFlags.find(idLower);
+            return it != mRecordFlags.end() ? it->second : 0;
+        }
+
+        /// Get the static record with the given lower case id, adding it if it does not exist
+        T &getStatic(const std::string &idLower) {
+            typename Static::iterator it = mStatic.find(idLower);
+            if (it == mStatic.end()) {
+                it = mStatic.insert(std::make_pair(idLower, T())).first;
+                mStaticIndex.insert(it->first, &it->second);
+                mSortedValid = false;
             }
+            return it->second;
+        }
+
+        struct Staged : public StagedRecord
+        {
+            T mRecord;
+            unsigned int mFlags;
         };
 
+        // Static records in key order, for prefix searches. Built in setUp().
+        std::vector<typename Static::iterator> mSorted;
+        bool mSortedValid; // mSorted holds all static records
+
+        struct IteratorLess
+        {
+            bool operator()(const typename Static::iterator &left, const typename Static::iterator &right) const {
+                return left->first < right->first;
+            }
+        };
+
+        /// Compare the start of a lower case \a key with \a prefix, ignoring the case of \a prefix.
+        /// Orders like std::string::compare of the key and the lower case prefix would.
+        static int comparePrefix(const std::string &key, const std::string &prefix) {
+            for (size_t i = 0; i < prefix.size(); ++i) {
+                if (i == key.size()) {
+                    return -1;
+                }
+                int k = static_cast<unsigned char>(key[i]);
+                int p = std::tolower(static_cast<unsigned char>(prefix[i]));
+                if (k != p) {
+                    return k < p ? -1 : 1;
+                }
+            }
+            return 0;
+        }
+
+        /// Find the range of mSorted whose keys start with \a prefix
+        void findPrefix(const std::string &prefix, size_t &begin, size_t &end) const {
+            size_t low = 0, high = mSorted.size();
+            while (low < high) {
+                size_t mid = (low + high) / 2;
+                if (comparePrefix(mSorted[mid]->first, prefix) < 0)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            begin = low;
+
+            high = mSorted.size();
+            while (low < high) {
+                size_t mid = (low + high) / 2;
+                if (comparePrefix(mSorted[mid]->first, prefix) <= 0)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            end = low;
+        }
+
 
         friend class ESMStore;
 
     public:
         Store()
+          : mSortedValid(false)
         {}
 
         Store(const Store<T> &orig)
-          : mStatic(orig.mData)
+          : mStatic(orig.mData), mSortedValid(false)
         {}
 
         typedef SharedIterator<T> iterator;
@@ -128,35 +227,59 @@ namespace MWWorld
         virtual void clearDynamic()
         {
             mDynamic.clear();
+            mDynamicIndex.clear();
             mShared.clear();
         }
 
         const T *search(const std::string &id) const {
-            T item;
-            item.mId = Misc::StringUtils::lowerCase(id);
-
-            typename std::map<std::string, T>::const_iterator it = mStatic.find(item.mId);
-
-            if (it != mStatic.end() && Misc::StringUtils::ciEqual(it->second.mId, id)) {
-                return &(it->second);
+            if (const T *ptr = mStaticIndex.find(id)) {
+                return ptr;
             }
+            return mDynamicIndex.find(id);
+        }
 
-            typename Dynamic::const_iterator dit = mDynamic.find(item.mId);
-            if (dit != mDynamic.end()) {
-                return &dit->second;
+        /// Same as search(), but skips case conversion for ids that are lower case already
+        const T *searchLowerCase(const std::string &idLower) const {
+            if (const T *ptr = mStaticIndex.findLowerCase(idLower)) {
+                return ptr;
             }
-
-            return 0;
+            return mDynamicIndex.findLowerCase(idLower);
         }
 
         /** Returns a random record that starts with the named ID, or NULL if not found. */
         const T *searchRandom(const std::string &id) const
         {
-            std::vector<const T*> results;
-            std::for_each(mShared.begin(), mShared.end(), GetRecords(id, &results));
-            if(!results.empty())
-                return results[int(std::rand()/((double)RAND_MAX+1)*results.size())];
-            return NULL;
+            size_t begin, end;
+            findPrefix(id, begin, end);
+
+            // Dynamic records are few and rarely match, so just walk their sorted range. The map is
+            // ordered by lower case ID, so the range starts at the lower bound of the prefix.
+            typename Dynamic::const_iterator dynamicBegin = mDynamic.end();
+            if (!mDynamic.empty()) {
+                bool isLower = true;
+                for (size_t i = 0; i < id.size() && isLower; ++i) {
+                    isLower = std::tolower(static_cast<unsigned char>(id[i])) == static_cast<unsigned char>(id[i]);
+                }
+                if (isLower) {
+                    dynamicBegin = mDynamic.lower_bound(id);
+                } else {
+                    dynamicBegin = mDynamic.lower_bound(Misc::StringUtils::lowerCase(id));
+                }
+            }
+            size_t dynamicCount = 0;
+            for (typename Dynamic::const_iterator it = dynamicBegin; it != mDynamic.end() && comparePrefix(it->first, id) == 0; ++it)
+                ++dynamicCount;
+
+            size_t count = (end - begin) + dynamicCount;
+            if (count == 0)
+                return NULL;
+
+            size_t index = int(std::rand()/((double)RAND_MAX+1)*count);
+            if (index < end - begin)
+                return &mSorted[begin + index]->second;
+
+            std::advance(dynamicBegin, index - (end - begin));
+            return &dynamicBegin->second;
         }
 
         const T *find(const std::string &id) const {
@@ -185,19 +308,55 @@ namespace MWWorld
 
         void load(ESM::ESMReader &esm, const std::string &id) {
             std::string idLower = Misc::StringUtils::lowerCase(id);
-            mStatic[idLower] = T();
-            mStatic[idLower].mId = idLower;
-            mStatic[idLower].load(esm);
+            T &record = getStatic(idLower);
+            record = T();
+            record.mId = idLower;
+            record.load(esm);
+            setRecordFlags(idLower, esm.getRecordFlags());
+        }
+
+        StagedRecord *loadStaged(ESM::ESMReader &esm, const std::string &id) const {
+            std::auto_ptr<Staged> staged(new Staged);
+            staged->mRecord.mId = Misc::StringUtils::lowerCase(id);
+            staged->mRecord.load(esm);
+            staged->mFlags = esm.getRecordFlags();
+            return staged.release();
+        }
+
+        void applyStaged(StagedRecord &record) {
+            const Staged &staged = static_cast<Staged &>(record);
+            getStatic(staged.mRecord.mId) = staged.mRecord;
+            setRecordFlags(staged.mRecord.mId, staged.mFlags);
+        }
+
+        bool isSnapshotted() const {
+            return true;
+        }
+
+        void writeSnapshot(ESM::ESMWriter &writer, int type) const {
+            ESM::NAME recName;
+            recName.val = type;
+            std::string name = recName.toString();
+            for (typename Static::const_iterator it = mStatic.begin(); it != mStatic.end(); ++it) {
+                writer.startRecord(name, getRecordFlags(it->first));
+                writer.writeHNCString("NAME", it->second.mId);
+                it->second.save(writer);
+                writer.endRecord(name);
+            }
         }
 
         void setUp() {
             //std::sort(mStatic.begin(), mStatic.end(), RecordCmp());
 
             mShared.reserve(mStatic.size());
+            mSorted.clear();
+            mSorted.reserve(mStatic.size());
             typename std::map<std::string, T>::iterator it = mStatic.begin();
             for (; it != mStatic.end(); ++it) {
                 mShared.push_back(&(it->second));
+                mSorted.push_back(it);
             }
+            mSortedValid = true;
         }
 
         iterator begin() const {
@@ -227,6 +386,7 @@ namespace MWWorld
             T *ptr = &result.first->second;
             if (result.second) {
                 mShared.push_back(ptr);
+                mDynamicIndex.insert(result.first->first, ptr);
             } else {
                 *ptr = item;
             }
@@ -240,6 +400,12 @@ namespace MWWorld
             T *ptr = &result.first->second;
             if (result.second) {
                 mShared.push_back(ptr);
+                mStaticIndex.insert(result.first->first, ptr);
+                if (mSortedValid) {
+                    // Already set up; keep the prefix index in order
+                    mSorted.insert(std::lower_bound(mSorted.begin(), mSorted.end(), result.first, IteratorLess()),
+                        result.first);
+                }
             } else {
                 *ptr = item;
             }
@@ -265,6 +431,13 @@ namespace MWWorld
                     }
                     ++sharedIter;
                 }
+                typename std::vector<typename Static::iterator>::iterator sorted =
+                    std::lower_bound(mSorted.begin(), mSorted.end(), it, IteratorLess());
+                if (sorted != mSorted.end() && *sorted == it) {
+                    mSorted.erase(sorted);
+                }
+                mStaticIndex.erase(it->first);
+                mRecordFlags.erase(it->first);
                 mStatic.erase(it);
             }
 
@@ -277,6 +450,7 @@ namespace MWWorld
             if (it == mDynamic.end()) {
                 return false;
             }
+            mDynamicIndex.erase(it->first);
             mDynamic.erase(it);
 
             // have to reinit the whole shared part
@@ -300,10 +474,40 @@ namespace MWWorld
         if (it == mStatic.end()) {
             it = mStatic.insert( std::make_pair( idLower, ESM::Dialogue() ) ).first;
             it->second.mId = id; // don't smash case here, as this line is printed... I think
+            mStaticIndex.insert(it->first, &it->second);
+            mSortedValid = false;
         }
 
         //I am not sure is it need to load the dialog from a plugin if it was already loaded from prevois plugins
         it->second.load(esm);
+        setRecordFlags(idLower, esm.getRecordFlags());
+    }
+
+    template <>
+    inline StagedRecord *Store<ESM::Dialogue>::loadStaged(ESM::ESMReader &esm, const std::string &id) const {
+        // Dialogues are merged with records from previous files, and the following INFO records
+        // refer to them, so they are loaded in order.
+        return 0;
+    }
+
+    template <>
+    inline void Store<ESM::Dialogue>::writeSnapshot(ESM::ESMWriter &writer, int type) const {
+        for (Static::const_iterator it = mStatic.begin(); it != mStatic.end(); ++it) {
+            writer.startRecord("DIAL", getRecordFlags(it->first));
+            writer.writeHNCString("NAME", it->second.mId);
+            it->second.save(writer);
+            writer.endRecord("DIAL");
+
+            // INFO records belong to the preceding DIAL record. Their header flags are not used
+            // by the loader, so they are not kept.
+            std::vector<ESM::DialInfo>::const_iterator info = it->second.mInfo.begin();
+            for (; info != it->second.mInfo.end(); ++info) {
+                writer.startRecord("INFO");
+                writer.writeHNCString("INAM", info->mId);
+                info->save(writer);
+                writer.endRecord("INFO");
+            }
+        }
     }
 
     template <>
@@ -311,7 +515,17 @@ namespace MWWorld
         ESM::Script scpt;
         scpt.load(esm);
         Misc::StringUtils::toLower(scpt.mId);
-        mStatic[scpt.mId] = scpt;
+        getStatic(scpt.mId) = scpt;
+        setRecordFlags(scpt.mId, esm.getRecordFlags());
+    }
+
+    template <>
+    inline StagedRecord *Store<ESM::Script>::loadStaged(ESM::ESMReader &esm, const std::string &id) const {
+        std::auto_ptr<Staged> staged(new Staged);
+        staged->mRecord.load(esm);
+        Misc::StringUtils::toLower(staged->mRecord.mId);
+        staged->mFlags = esm.getRecordFlags();
+        return staged.release();
     }
 
     template <>
@@ -319,7 +533,17 @@ namespace MWWorld
         ESM::StartScript s;
         s.load(esm);
         s.mId = Misc::StringUtils::toLower(s.mScript);
-        mStatic[s.mId] = s;
+        getStatic(s.mId) = s;
+        setRecordFlags(s.mId, esm.getRecordFlags());
+    }
+
+    template <>
+    inline StagedRecord *Store<ESM::StartScript>::loadStaged(ESM::ESMReader &esm, const std::string &id) const {
+        std::auto_ptr<Staged> staged(new Staged);
+        staged->mRecord.load(esm);
+        staged->mRecord.mId = Misc::StringUtils::toLower(staged->mRecord.mScript);
+        staged->mFlags = esm.getRecordFlags();
+        return staged.release();
     }
 
     template <>
@@ -414,6 +638,30 @@ namespace MWWorld
             }
         };
 
+        struct StagedLand : public StagedRecord
+        {
+            ESM::Land *mLand;
+
+            StagedLand(ESM::Land *land) : mLand(land) {}
+            ~StagedLand() { delete mLand; }
+        };
+
+        void insert(ESM::Land *ptr) {
+            // Same area defined in multiple plugins? -> last plugin wins
+            // Can't use search() because we aren't sorted yet - is there any other way to speed this up?
+            for (std::vector<ESM::Land*>::iterator it = mStatic.begin(); it != mStatic.end(); ++it)
+            {
+                if ((*it)->mX == ptr->mX && (*it)->mY == ptr->mY)
+                {
+                    delete *it;
+                    mStatic.erase(it);
+                    break;
+                }
+            }
+
+            mStatic.push_back(ptr);
+        }
+
     public:
         typedef SharedIterator<ESM::Land> iterator;
 
@@ -465,20 +713,19 @@ namespace MWWorld
         void load(ESM::ESMReader &esm, const std::string &id) {
             ESM::Land *ptr = new ESM::Land();
             ptr->load(esm);
+            insert(ptr);
+        }
 
-            // Same area defined in multiple plugins? -> last plugin wins
-            // Can't use search() because we aren't sorted yet - is there any other way to speed this up?
-            for (std::vector<ESM::Land*>::iterator it = mStatic.begin(); it != mStatic.end(); ++it)
-            {
-                if ((*it)->mX == ptr->mX && (*it)->mY == ptr->mY)
-                {
-                    delete *it;
-                    mStatic.erase(it);
-                    break;
-                }
-            }
+        StagedRecord *loadStaged(ESM::ESMReader &esm, const std::string &id) const {
+            std::auto_ptr<StagedLand> staged(new StagedLand(new ESM::Land));
+            staged->mLand->load(esm);
+            return staged.release();
+        }
 
-            mStatic.push_back(ptr);
+        void applyStaged(StagedRecord &record) {
+            StagedLand &staged = static_cast<StagedLand &>(record);
+            insert(staged.mLand);
+            staged.mLand = 0;
         }
 
         void setUp() {
@@ -819,11 +1066,39 @@ namespace MWWorld
 
     public:
 
+        struct StagedPathgrid : public StagedRecord
+        {
+            ESM::Pathgrid mRecord;
+        };
+
         void load(ESM::ESMReader &esm, const std::string &id) {
             mStatic.push_back(ESM::Pathgrid());
             mStatic.back().load(esm);
         }
 
+        StagedRecord *loadStaged(ESM::ESMReader &esm, const std::string &id) const {
+            std::auto_ptr<StagedPathgrid> staged(new StagedPathgrid);
+            staged->mRecord.load(esm);
+            return staged.release();
+        }
+
+        void applyStaged(StagedRecord &record) {
+            mStatic.push_back(static_cast<StagedPathgrid &>(record).mRecord);
+        }
+
+        bool isSnapshotted() const {
+            return true;
+        }
+
+        void writeSnapshot(ESM::ESMWriter &writer, int type) const {
+            // the header flags of PGRD records are not used by the loader, so they are not kept
+            for (std::vector<ESM::Pathgrid>::const_iterator it = mStatic.begin(); it != mStatic.end(); ++it) {
+                writer.startRecord("PGRD");
+                it->save(writer);
+                writer.endRecord("PGRD");
+            }
+        }
+
         size_t getSize() const {
             return mStatic.size();
         }
@@ -967,6 +1242,18 @@ namespace MWWorld
             return mStatic.size();
         }
 
+        void writeSnapshot(ESM::ESMWriter &writer) const {
+            ESM::NAME recName;
+            recName.val = T::sRecordId;
+            std::string name = recName.toString();
+            // the header flags of indexed records are not used by their loaders, so they are not kept
+            for (iterator it = mStatic.begin(); it != mStatic.end(); ++it) {
+                writer.startRecord(name);
+                it->save(writer);
+                writer.endRecord(name);
+            }
+        }
+
         void setUp() {
             /// \note This method sorts indexed values for further
             /// searches. Every loaded item is present in storage, but
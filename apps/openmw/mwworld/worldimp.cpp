@@ -14,6 +14,8 @@
 #include <components/bsa/bsa_archive.hpp>
 #include <components/files/collections.hpp>
 #include <components/compiler/locals.hpp>
+#include <components/profiling/frameprofiler.hpp>
+#include <components/settings/settings.hpp>
 
 #include <boost/math/special_functions/sign.hpp>
 
@@ -43,6 +45,7 @@
 #include "contentloader.hpp"
 #include "esmloader.hpp"
 #include "omwloader.hpp"
+#include "cellpreloader.hpp"
 
 using namespace Ogre;
 
@@ -72,23 +75,6 @@ namespace
         }
     }
 */
-    template<typename T>
-    MWWorld::LiveCellRef<T> *searchViaHandle (const std::string& handle,
-        MWWorld::CellRefList<T>& refList)
-    {
-        typedef typename MWWorld::CellRefList<T>::List::iterator iterator;
-
-        for (iterator iter (refList.mList.begin()); iter!=refList.mList.end(); ++iter)
-        {
-            if (iter->mData.getCount() > 0 && iter->mData.getBaseNode()){
-            if (iter->mData.getHandle()==handle)
-            {
-                return &*iter;
-            }
-            }
-        }
-        return 0;
-    }
 }
 
 namespace MWWorld
@@ -120,57 +106,17 @@ namespace MWWorld
             }
         }
 
+        void finish()
+        {
+            for (LoadersContainer::iterator it = mLoaders.begin(); it != mLoaders.end(); ++it)
+                it->second->finish();
+        }
+
         private:
           typedef std::tr1::unordered_map<std::string, ContentLoader*> LoadersContainer;
           LoadersContainer mLoaders;
     };
 
-    Ptr World::getPtrViaHandle (const std::string& handle, Ptr::CellStore& cell)
-    {
-        if (MWWorld::LiveCellRef<ESM::Activator> *ref =
-            searchViaHandle (handle, cell.mActivators))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Potion> *ref = searchViaHandle (handle, cell.mPotions))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Apparatus> *ref = searchViaHandle (handle, cell.mAppas))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Armor> *ref = searchViaHandle (handle, cell.mArmors))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Book> *ref = searchViaHandle (handle, cell.mBooks))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Clothing> *ref = searchViaHandle (handle, cell.mClothes))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Container> *ref =
-            searchViaHandle (handle, cell.mContainers))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Creature> *ref =
-            searchViaHandle (handle, cell.mCreatures))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Door> *ref = searchViaHandle (handle, cell.mDoors))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Ingredient> *ref =
-            searchViaHandle (handle, cell.mIngreds))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Light> *ref = searchViaHandle (handle, cell.mLights))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Lockpick> *ref = searchViaHandle (handle, cell.mLockpicks))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Miscellaneous> *ref = searchViaHandle (handle, cell.mMiscItems))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::NPC> *ref = searchViaHandle (handle, cell.mNpcs))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Probe> *ref = searchViaHandle (handle, cell.mProbes))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Repair> *ref = searchViaHandle (handle, cell.mRepairs))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Static> *ref = searchViaHandle (handle, cell.mStatics))
-            return Ptr (ref, &cell);
-        if (MWWorld::LiveCellRef<ESM::Weapon> *ref = searchViaHandle (handle, cell.mWeapons))
-            return Ptr (ref, &cell);
-        return Ptr();
-    }
-
-
     int World::getDaysPerMonth (int month) const
     {
         switch (month)
@@ -212,7 +158,8 @@ namespace MWWorld
         const boost::filesystem::path& resDir, const boost::filesystem::path& cacheDir,
         ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap, int mActivationDistanceOverride)
     : mPlayer (0), mLocalScripts (mStore), mGlobalVariables (0),
-      mSky (true), mCells (mStore, mEsm),
+      mGameHourSlot (-1), mDaySlot (-1), mMonthSlot (-1),
+      mSky (true), mCells (mStore, mEsm), mCellPreloader (0),
       mActivationDistanceOverride (mActivationDistanceOverride),
       mFallback(fallbackMap), mPlayIntro(0), mTeleportEnabled(true), mLevitationEnabled(false),
       mFacedDistance(FLT_MAX), mGodMode(false)
@@ -232,7 +179,7 @@ namespace MWWorld
         listener->loadingOn();
 
         GameContentLoader gameContentLoader(*listener);
-        EsmLoader esmLoader(mStore, mEsm, encoder, *listener);
+        EsmLoader esmLoader(mStore, mEsm, encoder, *listener, cacheDir / "esmstore.snapshot");
         OmwLoader omwLoader(*listener);
 
         gameContentLoader.addLoader(".esm", &esmLoader);
@@ -253,7 +200,17 @@ namespace MWWorld
 
         mGlobalVariables = new Globals (mStore);
 
+        // slots do not change when mGlobalVariables is recreated from the same store
+        mGameHourSlot = mGlobalVariables->getSlot ("gamehour");
+        mDaySlot = mGlobalVariables->getSlot ("day");
+        mMonthSlot = mGlobalVariables->getSlot ("month");
+
         mWorldScene = new Scene(*mRendering, mPhysics);
+
+        if (Settings::Manager::getBool ("preload enabled", "Cells"))
+            mCellPreloader = new CellPreloader (mCells, mStore, mEsm, *encoder,
+                Settings::Manager::getInt ("preload cell budget", "Cells"),
+                Settings::Manager::getFloat ("preload look ahead", "Cells"));
     }
 
     void World::startNewGame()
@@ -263,6 +220,9 @@ namespace MWWorld
         mStore.clearDynamic();
         mStore.setUp();
 
+        if (mCellPreloader)
+            mCellPreloader->clear();
+
         mCells.clear();
 
         // Rebuild player
@@ -352,6 +312,7 @@ namespace MWWorld
 
     World::~World()
     {
+        delete mCellPreloader;
         delete mWeatherManager;
         delete mWorldScene;
         delete mGlobalVariables;
@@ -438,6 +399,28 @@ namespace MWWorld
         return mGlobalVariables->getType (name);
     }
 
+    int World::getGlobalVariableSlot (const std::string& name) const
+    {
+        return mGlobalVariables->getSlot (name);
+    }
+
+    Globals::Data World::getGlobalVariable (int slot) const
+    {
+        return (*mGlobalVariables)[slot];
+    }
+
+    void World::setGlobalVariable (int slot, float value)
+    {
+        if (slot==mGameHourSlot)
+            setHour (value);
+        else if (slot==mDaySlot)
+            setDay (static_cast<int> (value));
+        else if (slot==mMonthSlot)
+            setMonth (static_cast<int> (value));
+        else
+            (*mGlobalVariables)[slot].mFloat = value;
+    }
+
     std::vector<std::string> World::getGlobals () const
     {
         return mGlobalVariables->getGlobals();
@@ -532,17 +515,8 @@ namespace MWWorld
     {
         if (mPlayer->getPlayer().getRefData().getHandle()==handle)
             return mPlayer->getPlayer();
-        for (Scene::CellStoreCollection::const_iterator iter (mWorldScene->getActiveCells().begin());
-            iter!=mWorldScene->getActiveCells().end(); ++iter)
-        {
-            Ptr::CellStore* cellstore = *iter;
-            Ptr ptr = getPtrViaHandle (handle, *cellstore);
 
-            if (!ptr.isEmpty())
-                return ptr;
-        }
-
-        return MWWorld::Ptr();
+        return mWorldScene->searchPtrViaHandle (handle);
     }
 
     void World::addContainerScripts(const Ptr& reference, Ptr::CellStore * cell)
@@ -905,6 +879,7 @@ namespace MWWorld
                     MWWorld::Ptr newPtr = MWWorld::Class::get(ptr)
                             .copyToCell(ptr, newCell);
                     newPtr.getRefData().setBaseNode(0);
+                    mCells.addRef(newPtr);
 
                     objectLeftActiveCell(ptr, newPtr);
                 }
@@ -912,8 +887,10 @@ namespace MWWorld
                 {
                     MWWorld::Ptr copy =
                         MWWorld::Class::get(ptr).copyToCell(ptr, newCell, pos);
+                    mCells.addRef(copy);
 
                     mRendering->updateObjectCell(ptr, copy);
+                    mWorldScene->updateObjectCell(ptr, copy);
 
                     MWBase::MechanicsManager *mechMgr = MWBase::Environment::get().getMechanicsManager();
                     mechMgr->updateCell(ptr, copy);
@@ -1292,7 +1269,20 @@ namespace MWWorld
         mWorldScene->update (duration, paused);
 
         if (!paused)
+        {
+            static Profiling::Phase phase ("Physics");
+            Profiling::ScopedTimer timer (MWBase::Environment::get().getFrameProfiler(), phase);
             doPhysics (duration);
+        }
+
+        if (mCellPreloader)
+        {
+            const float *pos = mPlayer->getPlayer().getRefData().getPosition().pos;
+            Ptr::CellStore *cell = mWorldScene->getCurrentCell();
+
+            mCellPreloader->update (duration, Ogre::Vector3 (pos[0], pos[1], pos[2]),
+                cell && cell->isExterior());
+        }
 
         performUpdateSceneQueries ();
 
@@ -1443,7 +1433,7 @@ namespace MWWorld
         {
             MWWorld::LiveCellRef<ESM::Door>& ref = *it;
 
-            if (ref.mRef.mTeleport)
+            if (ref.mRef.mTeleport && ref.mData.getCount())
             {
                 World::DoorMarker newMarker;
                 newMarker.name = MWClass::Door::getDestination(ref);
@@ -1542,6 +1532,7 @@ namespace MWWorld
         /// \todo add searching correct cell for position specified
         MWWorld::Ptr dropped =
             MWWorld::Class::get(object).copyToCell(object, cell, pos);
+        mCells.addRef(dropped);
 
         if (object.getClass().isActor() || adjustPos)
         {
@@ -1810,7 +1801,7 @@ namespace MWWorld
             for (CellRefList<ESM::Container>::List::iterator container = refList.begin(); container != refList.end(); ++container)
             {
                 MWWorld::Ptr ptr (&*container, *cellIt);
-                if (Misc::StringUtils::ciEqual(ptr.getCellRef().mOwner, npc.getCellRef().mRefID))
+                if (ptr.getRefData().getCount() && Misc::StringUtils::ciEqual(ptr.getCellRef().mOwner, npc.getCellRef().mRefID))
                     out.push_back(ptr);
             }
         }
@@ -1886,7 +1877,7 @@ namespace MWWorld
         }
         const DoorList &doors = cellStore->mDoors.mList;
         for (DoorList::const_iterator it = doors.begin(); it != doors.end(); ++it) {
-            if (!it->mRef.mTeleport) {
+            if (!it->mRef.mTeleport || !it->mData.getCount()) {
                 continue;
             }
 
@@ -1908,7 +1899,7 @@ namespace MWWorld
                 // and use it destination to position inside cell.
                 const DoorList &doors = source->mDoors.mList;
                 for (DoorList::const_iterator jt = doors.begin(); jt != doors.end(); ++jt) {
-                    if (it->mRef.mTeleport &&
+                    if (it->mRef.mTeleport && jt->mData.getCount() &&
                         Misc::StringUtils::ciEqual(name, jt->mRef.mDestCell))
                     {
                         /// \note Using _any_ door pointed to the interior,
@@ -2047,6 +2038,8 @@ namespace MWWorld
                 contentLoader.load(col.getPath(*it), idx);
             }
         }
+
+        contentLoader.finish();
     }
 
     void World::castSpell(const Ptr &actor)
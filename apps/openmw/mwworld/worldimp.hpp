@@ -49,6 +49,7 @@ namespace MWWorld
 {
     class WeatherManager;
     class Player;
+    class CellPreloader;
 
     /// \brief The game world and its visual representation
 
@@ -65,10 +66,14 @@ namespace MWWorld
             MWWorld::ESMStore mStore;
             LocalScripts mLocalScripts;
             MWWorld::Globals *mGlobalVariables;
+            int mGameHourSlot;
+            int mDaySlot;
+            int mMonthSlot;
             MWWorld::PhysicsSystem *mPhysics;
             bool mSky;
 
             Cells mCells;
+            CellPreloader *mCellPreloader; // 0: preloading disabled
 
             OEngine::Physic::PhysicEngine* mPhysEngine;
 
@@ -78,8 +83,6 @@ namespace MWWorld
             World (const World&);
             World& operator= (const World&);
 
-            Ptr getPtrViaHandle (const std::string& handle, Ptr::CellStore& cellStore);
-
             int mActivationDistanceOverride;
             std::string mFacedHandle;
             float mFacedDistance;
@@ -218,6 +221,14 @@ namespace MWWorld
             virtual char getGlobalVariableType (const std::string& name) const;
             ///< Return ' ', if there is no global variable with this name.
 
+            virtual int getGlobalVariableSlot (const std::string& name) const;
+            ///< Return -1, if there is no global variable with this name.
+
+            virtual Globals::Data getGlobalVariable (int slot) const;
+
+            virtual void setGlobalVariable (int slot, float value);
+            ///< Set value independently from real type (time variables also update the game time).
+
             virtual std::vector<std::string> getGlobals () const;
 
             virtual std::string getCurrentCellName () const;
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "components/compiler/generator.hpp"
+#include "components/compiler/optimizer.hpp"
+
+using Compiler::Generator::segment0;
+using Compiler::Generator::segment5;
+
+namespace
+{
+  /// Assemble a script without float and string literals
+  std::vector<Interpreter::Type_Code> assemble(const std::vector<Interpreter::Type_Code> &code,
+      const std::vector<Interpreter::Type_Code> &integers)
+  {
+    std::vector<Interpreter::Type_Code> script;
+    script.push_back(code.size());
+    script.push_back(integers.size());
+    script.push_back(0);
+    script.push_back(0);
+    script.insert(script.end(), code.begin(), code.end());
+    script.insert(script.end(), integers.begin(), integers.end());
+    return script;
+  }
+}
+
+struct OptimizerTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(OptimizerTest, constant_expression_is_folded)
+{
+  // set x to 2 + 3
+  std::vector<Interpreter::Type_Code> code;
+  code.push_back(segment0(0, 0));
+  code.push_back(segment5(4));
+  code.push_back(segment0(0, 1));
+  code.push_back(segment5(4));
+  code.push_back(segment5(9));
+  code.push_back(segment0(0, 0));
+  code.push_back(segment5(0));
+
+  std::vector<Interpreter::Type_Code> integers;
+  integers.push_back(2);
+  integers.push_back(3);
+
+  std::vector<Interpreter::Type_Code> original = assemble(code, integers);
+  std::vector<Interpreter::Type_Code> optimized = original;
+  Compiler::optimize(optimized);
+
+  std::vector<Interpreter::Type_Code> expected;
+  expected.push_back(segment0(0, 5));
+  expected.push_back(segment0(0, 0));
+  expected.push_back(segment5(0));
+
+  ASSERT_EQ(assemble(expected, integers), optimized);
+  ASSERT_EQ("", Compiler::verifyOptimized(original, optimized));
+}
+
+TEST_F(OptimizerTest, jumps_are_threaded_and_skips_preserved)
+{
+  std::vector<Interpreter::Type_Code> code;
+  code.push_back(segment0(0, 0)); // 0: push 0
+  code.push_back(segment5(24));   // 1: skip zero
+  code.push_back(segment0(1, 2)); // 2: jump to 4
+  code.push_back(segment5(38));   // 3: menu mode
+  code.push_back(segment0(1, 2)); // 4: jump to 6
+  code.push_back(segment5(38));   // 5: menu mode
+  code.push_back(segment0(1, 1)); // 6: jump to 7
+  code.push_back(segment5(20));   // 7: return
+
+  std::vector<Interpreter::Type_Code> original = assemble(code, std::vector<Interpreter::Type_Code>());
+  std::vector<Interpreter::Type_Code> optimized = original;
+  Compiler::optimize(optimized);
+
+  std::vector<Interpreter::Type_Code> expected;
+  expected.push_back(segment0(0, 0));
+  expected.push_back(segment5(24));
+  expected.push_back(segment0(1, 4));
+  expected.push_back(segment5(38));
+  expected.push_back(segment0(1, 2));
+  expected.push_back(segment5(38));
+  expected.push_back(segment5(20));
+
+  ASSERT_EQ(assemble(expected, std::vector<Interpreter::Type_Code>()), optimized);
+  ASSERT_EQ("", Compiler::verifyOptimized(original, optimized));
+}
+
+TEST_F(OptimizerTest, division_by_zero_is_not_folded)
+{
+  std::vector<Interpreter::Type_Code> code;
+  code.push_back(segment0(0, 1));
+  code.push_back(segment0(0, 0));
+  code.push_back(segment5(15));
+  code.push_back(segment0(0, 0));
+  code.push_back(segment5(0));
+
+  std::vector<Interpreter::Type_Code> original = assemble(code, std::vector<Interpreter::Type_Code>());
+  std::vector<Interpreter::Type_Code> optimized = original;
+  Compiler::optimize(optimized);
+
+  ASSERT_EQ(original, optimized);
+}
+
+TEST_F(OptimizerTest, verifier_detects_changed_behaviour)
+{
+  std::vector<Interpreter::Type_Code> code;
+  code.push_back(segment0(0, 2));
+  code.push_back(segment0(0, 3));
+  code.push_back(segment5(9));
+  code.push_back(segment0(0, 0));
+  code.push_back(segment5(0));
+
+  std::vector<Interpreter::Type_Code> original = assemble(code, std::vector<Interpreter::Type_Code>());
+
+  std::vector<Interpreter::Type_Code> wrong;
+  wrong.push_back(segment0(0, 6));
+  wrong.push_back(segment0(0, 0));
+  wrong.push_back(segment5(0));
+
+  ASSERT_NE("", Compiler::verifyOptimized(original,
+      assemble(wrong, std::vector<Interpreter::Type_Code>())));
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "components/misc/chunkedvector.hpp"
+
+struct ChunkedVectorTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(ChunkedVectorTest, push_back_does_not_move_elements)
+{
+  Misc::ChunkedVector<std::string> vector;
+  std::vector<std::string *> addresses;
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    vector.push_back(std::string(1, char('a' + i % 26)));
+    addresses.push_back(&vector.back());
+  }
+
+  ASSERT_EQ(1000u, vector.size());
+
+  int i = 0;
+  for (Misc::ChunkedVector<std::string>::iterator iter = vector.begin(); iter != vector.end(); ++iter, ++i)
+  {
+    ASSERT_EQ(addresses[i], &*iter);
+    ASSERT_EQ(std::string(1, char('a' + i % 26)), *iter);
+    ASSERT_EQ(addresses[i], &vector[i]);
+  }
+  ASSERT_EQ(1000, i);
+}
+
+TEST_F(ChunkedVectorTest, iterates_backwards_across_chunks)
+{
+  Misc::ChunkedVector<int> vector;
+  ASSERT_TRUE(vector.begin() == vector.end());
+
+  for (int i = 0; i < 100; ++i)
+    vector.push_back(i);
+
+  int expected = 99;
+  Misc::ChunkedVector<int>::const_iterator iter = vector.end();
+  while (iter != vector.begin())
+  {
+    --iter;
+    ASSERT_EQ(expected--, *iter);
+  }
+  ASSERT_EQ(-1, expected);
+}
+
+TEST_F(ChunkedVectorTest, copy_is_independent)
+{
+  Misc::ChunkedVector<int> vector;
+  for (int i = 0; i < 10; ++i)
+    vector.push_back(i);
+
+  Misc::ChunkedVector<int> copy(vector);
+  copy.push_back(10);
+  copy.front() = -1;
+
+  ASSERT_EQ(10u, vector.size());
+  ASSERT_EQ(0, vector.front());
+  ASSERT_EQ(11u, copy.size());
+  ASSERT_EQ(10, copy.back());
+
+  vector = copy;
+  ASSERT_EQ(11u, vector.size());
+  ASSERT_EQ(-1, vector[0]);
+
+  vector.clear();
+  ASSERT_TRUE(vector.empty());
+  ASSERT_TRUE(vector.begin() == vector.end());
+}
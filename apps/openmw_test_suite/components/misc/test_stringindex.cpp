@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "components/misc/stringindex.hpp"
+#include "components/misc/stringops.hpp"
+
+struct StringIndexTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(StringIndexTest, find_is_case_insensitive)
+{
+  std::string key("fargoth");
+  int value = 1;
+
+  Misc::StringIndex<int> index;
+  index.insert(key, &value);
+
+  ASSERT_EQ(&value, index.find("fargoth"));
+  ASSERT_EQ(&value, index.find("Fargoth"));
+  ASSERT_EQ(&value, index.find("FARGOTH"));
+  ASSERT_EQ(&value, index.findLowerCase("fargoth"));
+  ASSERT_TRUE(index.findLowerCase("Fargoth") == 0);
+  ASSERT_TRUE(index.find("fargot") == 0);
+  ASSERT_TRUE(index.find("fargothh") == 0);
+}
+
+TEST_F(StringIndexTest, insert_replaces_existing_value)
+{
+  std::string key("gold_001");
+  int first = 1, second = 2;
+
+  Misc::StringIndex<int> index;
+  index.insert(key, &first);
+  index.insert(key, &second);
+
+  ASSERT_EQ(1u, index.size());
+  ASSERT_EQ(&second, index.find("Gold_001"));
+}
+
+TEST_F(StringIndexTest, erase_keeps_other_entries_reachable)
+{
+  std::map<std::string, int> records;
+  Misc::StringIndex<int> index;
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    std::ostringstream stream;
+    stream << "record_" << i;
+    std::map<std::string, int>::iterator it = records.insert(std::make_pair(stream.str(), i)).first;
+    index.insert(it->first, &it->second);
+  }
+
+  for (int i = 0; i < 1000; i += 3)
+  {
+    std::ostringstream stream;
+    stream << "record_" << i;
+    ASSERT_TRUE(index.erase(stream.str()));
+    ASSERT_FALSE(index.erase(stream.str()));
+  }
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    std::ostringstream stream;
+    stream << "RECORD_" << i;
+    int *found = index.find(stream.str());
+    if (i % 3 == 0)
+      ASSERT_TRUE(found == 0);
+    else
+    {
+      ASSERT_TRUE(found != 0);
+      ASSERT_EQ(i, *found);
+    }
+  }
+}
+
+// Not a correctness test: compares lookups against the lower case + std::map approach previously
+// used by MWWorld::Store<T>::search. Disabled by default, run with --gtest_also_run_disabled_tests.
+TEST_F(StringIndexTest, DISABLED_benchmark_against_map)
+{
+  const int count = 20000;
+  const int lookups = 1000000;
+
+  std::map<std::string, int> records;
+  std::vector<std::string> ids;
+  Misc::StringIndex<int> index;
+
+  for (int i = 0; i < count; ++i)
+  {
+    std::ostringstream stream;
+    stream << "Ex_Common_Record_" << i;
+    ids.push_back(stream.str());
+    std::map<std::string, int>::iterator it =
+        records.insert(std::make_pair(Misc::StringUtils::lowerCase(stream.str()), i)).first;
+    index.insert(it->first, &it->second);
+  }
+
+  long mapSum = 0;
+  std::clock_t start = std::clock();
+  for (int i = 0; i < lookups; ++i)
+  {
+    std::map<std::string, int>::const_iterator it =
+        records.find(Misc::StringUtils::lowerCase(ids[(i * 7919u) % count]));
+    mapSum += it->second;
+  }
+  double mapTime = double(std::clock() - start) / CLOCKS_PER_SEC;
+
+  long indexSum = 0;
+  start = std::clock();
+  for (int i = 0; i < lookups; ++i)
+    indexSum += *index.find(ids[(i * 7919u) % count]);
+  double indexTime = double(std::clock() - start) / CLOCKS_PER_SEC;
+
+  ASSERT_EQ(mapSum, indexSum);
+
+  std::cout << lookups << " lookups in " << count << " records: std::map " << mapTime
+            << "s, StringIndex " << indexTime << "s" << std::endl;
+}
@@ -0,0 +1,82 @@
+#ifndef OPENMW_TEST_SUITE_PATHGRID_GRIDHELPERS_H
+#define OPENMW_TEST_SUITE_PATHGRID_GRIDHELPERS_H
+
+#include <algorithm>
+#include <vector>
+
+#include "components/esm/loadpgrd.hpp"
+
+namespace PathgridTest
+{
+  /// Add \a columns x \a rows points, \a spacing units apart (starting at \a offset), connected to
+  /// their right and upper neighbours.
+  ///
+  /// \param heightStep if not 0, the points are raised by multiples of it, so that the grid is uneven
+  /// \param dropOneIn if not 0, about one in \a dropOneIn connections is left out (at random, but
+  /// the same ones on every call)
+  /// \param bothWays list each connection by both points, like in the content files
+  inline void addGrid(ESM::Pathgrid& grid, int columns, int rows, int spacing, int offset = 0,
+      int heightStep = 0, int dropOneIn = 0, bool bothWays = false)
+  {
+    int first = static_cast<int>(grid.mPoints.size());
+    unsigned int seed = 12345;
+
+    for (int y = 0; y < rows; ++y)
+      for (int x = 0; x < columns; ++x)
+      {
+        ESM::Pathgrid::Point point;
+        point.mX = offset + x * spacing;
+        point.mY = offset + y * spacing;
+        point.mZ = (x * y) % 7 * heightStep;
+        point.mAutogenerated = 0;
+        point.mConnectionNum = 0;
+        point.mUnknown = 0;
+        grid.mPoints.push_back(point);
+      }
+
+    for (int y = 0; y < rows; ++y)
+      for (int x = 0; x < columns; ++x)
+      {
+        int index = first + y * columns + x;
+
+        for (int direction = 0; direction < 2; ++direction)
+        {
+          int neighbour = direction == 0 ? (x + 1 < columns ? index + 1 : -1)
+                                         : (y + 1 < rows ? index + columns : -1);
+
+          seed = seed * 1103515245 + 12345;
+
+          if (neighbour == -1 || (dropOneIn != 0 && (seed >> 16) % dropOneIn == 0))
+            continue;
+
+          ESM::Pathgrid::Edge edge;
+          edge.mV0 = index;
+          edge.mV1 = neighbour;
+          grid.mEdges.push_back(edge);
+
+          if (bothWays)
+          {
+            std::swap(edge.mV0, edge.mV1);
+            grid.mEdges.push_back(edge);
+          }
+        }
+      }
+  }
+
+  /// Point positions in the layout taken by Pathgrid::SpatialIndex (x, y, z of each point)
+  inline std::vector<float> getPositions(const ESM::Pathgrid& grid)
+  {
+    std::vector<float> positions;
+
+    for (std::size_t i = 0; i < grid.mPoints.size(); ++i)
+    {
+      positions.push_back(static_cast<float>(grid.mPoints[i].mX));
+      positions.push_back(static_cast<float>(grid.mPoints[i].mY));
+      positions.push_back(static_cast<float>(grid.mPoints[i].mZ));
+    }
+
+    return positions;
+  }
+}
+
+#endif
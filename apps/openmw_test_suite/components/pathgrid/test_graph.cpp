@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+
+#include "components/esm/loadpgrd.hpp"
+#include "components/pathgrid/graph.hpp"
+
+#include "gridhelpers.hpp"
+
+namespace
+{
+  /// Square, uneven grid of points, with some connections left out
+  ESM::Pathgrid makeGrid(int size, int spacing)
+  {
+    ESM::Pathgrid grid;
+    PathgridTest::addGrid(grid, size, size, spacing, 0, 16, 5, true);
+    return grid;
+  }
+
+  float getLength(const Pathgrid::Graph& graph, const std::vector<int>& path)
+  {
+    float length = 0;
+
+    for (std::size_t i = 1; i < path.size(); ++i)
+      length += graph.getDistance(path[i - 1], path[i]);
+
+    return length;
+  }
+
+  // The search PathFinder used before: Dijkstra on a graph built for every query, stopped
+  // with an exception once the goal is reached.
+  struct FoundPath {};
+
+  typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS,
+      boost::property<boost::vertex_index_t, int, ESM::Pathgrid::Point>,
+      boost::property<boost::edge_weight_t, float> > ReferenceGraph;
+  typedef ReferenceGraph::vertex_descriptor PointID;
+
+  class GoalVisitor : public boost::default_dijkstra_visitor
+  {
+      PointID mGoal;
+
+    public:
+      GoalVisitor(PointID goal) : mGoal(goal) {}
+
+      void examine_vertex(PointID u, const ReferenceGraph&)
+      {
+        if (u == mGoal)
+          throw FoundPath();
+      }
+  };
+
+  float distance(const ESM::Pathgrid::Point& a, const ESM::Pathgrid::Point& b)
+  {
+    float x = a.mX - b.mX;
+    float y = a.mY - b.mY;
+    float z = a.mZ - b.mZ;
+    return std::sqrt(x * x + y * y + z * z);
+  }
+
+  /// \return path length (-1: no path)
+  float findReferencePath(const ESM::Pathgrid& pathgrid, int start, int end)
+  {
+    ReferenceGraph graph;
+
+    for (std::size_t i = 0; i < pathgrid.mPoints.size(); ++i)
+      graph[boost::add_vertex(graph)] = pathgrid.mPoints[i];
+
+    for (std::size_t i = 0; i < pathgrid.mEdges.size(); ++i)
+    {
+      PointID u = pathgrid.mEdges[i].mV0;
+      PointID v = pathgrid.mEdges[i].mV1;
+      boost::put(boost::edge_weight, graph, boost::add_edge(u, v, graph).first,
+          distance(graph[u], graph[v]));
+    }
+
+    std::vector<PointID> p(boost::num_vertices(graph));
+    std::vector<float> d(boost::num_vertices(graph));
+
+    try
+    {
+      boost::dijkstra_shortest_paths(graph, start,
+          boost::predecessor_map(&p[0]).distance_map(&d[0]).visitor(GoalVisitor(end)));
+    }
+    catch (const FoundPath&)
+    {
+      return d[end];
+    }
+
+    return -1;
+  }
+}
+
+struct PathgridGraphTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(PathgridGraphTest, duplicate_connections_are_merged)
+{
+  ESM::Pathgrid grid = makeGrid(2, 128);
+  Pathgrid::Graph graph(grid);
+
+  ASSERT_EQ(4, graph.getPointCount());
+
+  for (int i = 0; i < graph.getPointCount(); ++i)
+    ASSERT_GE(2, graph.getNeighbourEnd(i) - graph.getNeighbourBegin(i));
+}
+
+TEST_F(PathgridGraphTest, astar_matches_dijkstra)
+{
+  ESM::Pathgrid grid = makeGrid(20, 128);
+  Pathgrid::Graph graph(grid);
+  Pathgrid::Search search;
+  std::vector<int> path;
+
+  int points = graph.getPointCount();
+
+  for (int i = 0; i < 200; ++i)
+  {
+    int start = (i * 7919) % points;
+    int end = (i * 104729 + 13) % points;
+
+    float expected = findReferencePath(grid, start, end);
+
+    if (expected < 0)
+    {
+      ASSERT_FALSE(search.findPath(graph, start, end, path));
+      ASSERT_TRUE(path.empty());
+      continue;
+    }
+
+    ASSERT_TRUE(search.findPath(graph, start, end, path));
+    ASSERT_EQ(start, path.front());
+    ASSERT_EQ(end, path.back());
+    ASSERT_NEAR(expected, getLength(graph, path), 0.01f * expected + 0.01f);
+  }
+}
+
+TEST_F(PathgridGraphTest, unconnected_points_have_no_path)
+{
+  ESM::Pathgrid grid = makeGrid(3, 128);
+  grid.mEdges.clear();
+
+  Pathgrid::Graph graph(grid);
+  Pathgrid::Search search;
+  std::vector<int> path;
+
+  ASSERT_FALSE(search.findPath(graph, 0, 8, path));
+  ASSERT_TRUE(search.findPath(graph, 4, 4, path));
+  ASSERT_EQ(1u, path.size());
+}
+
+TEST_F(PathgridGraphTest, cache_keeps_graph_until_erased)
+{
+  ESM::Pathgrid grid = makeGrid(3, 128);
+  Pathgrid::GraphCache cache;
+
+  Pathgrid::GraphCache::GraphPtr graph = cache.get(grid);
+  ASSERT_EQ(graph, cache.get(grid));
+
+  cache.erase(&grid);
+  ASSERT_EQ(0u, cache.size());
+  ASSERT_EQ(9, graph->getPointCount());
+}
+
+TEST_F(PathgridGraphTest, cached_astar_matches_dijkstra_on_city_grid)
+{
+  // roughly the size of a large city path grid
+  ESM::Pathgrid grid = makeGrid(24, 256);
+  const int queries = 500;
+
+  int points = static_cast<int>(grid.mPoints.size());
+
+  Pathgrid::GraphCache cache;
+  Pathgrid::Search search;
+  std::vector<int> path;
+
+  for (int i = 0; i < queries; ++i)
+  {
+    int start = (i * 7919) % points;
+    int end = (i * 104729) % points;
+
+    float expected = std::max(0.0f, findReferencePath(grid, start, end));
+
+    Pathgrid::GraphCache::GraphPtr graph = cache.get(grid);
+    float length = search.findPath(*graph, start, end, path) ? getLength(*graph, path) : 0;
+
+    ASSERT_NEAR(expected, length, 0.01f * expected + 0.01f);
+  }
+}
+
+// Not a correctness test (see above): times the old search against the new one. Disabled by
+// default, run with --gtest_also_run_disabled_tests.
+TEST_F(PathgridGraphTest, DISABLED_benchmark_against_dijkstra)
+{
+  // roughly the size of a large city path grid
+  ESM::Pathgrid grid = makeGrid(24, 256);
+  const int queries = 500;
+
+  int points = static_cast<int>(grid.mPoints.size());
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+  float referenceLength = 0;
+  for (int i = 0; i < queries; ++i)
+    referenceLength += std::max(0.0f, findReferencePath(grid, (i * 7919) % points, (i * 104729) % points));
+
+  boost::posix_time::ptime middle = boost::posix_time::microsec_clock::universal_time();
+
+  Pathgrid::GraphCache cache;
+  Pathgrid::Search search;
+  std::vector<int> path;
+
+  float length = 0;
+  for (int i = 0; i < queries; ++i)
+  {
+    Pathgrid::GraphCache::GraphPtr graph = cache.get(grid);
+    if (search.findPath(*graph, (i * 7919) % points, (i * 104729) % points, path))
+      length += getLength(*graph, path);
+  }
+
+  boost::posix_time::ptime end = boost::posix_time::microsec_clock::universal_time();
+
+  std::cout
+      << "[ BENCHMARK] " << queries << " queries on " << points << " points: rebuilt graph + Dijkstra "
+      << (middle - start).total_microseconds() << " us, cached graph + A* "
+      << (end - middle).total_microseconds() << " us" << std::endl;
+
+  ASSERT_NEAR(referenceLength, length, 0.01f * referenceLength);
+}
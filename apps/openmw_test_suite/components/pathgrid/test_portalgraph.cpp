@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "components/pathgrid/portalgraph.hpp"
+
+#include "gridhelpers.hpp"
+
+namespace
+{
+  const float cellSize = 8192;
+
+  /// Exterior path grids from a map
+  class TestStorage : public Pathgrid::Storage
+  {
+    public:
+      std::map<std::pair<int, int>, ESM::Pathgrid> mPathgrids;
+
+      virtual const ESM::Pathgrid *getExterior(int x, int y) const
+      {
+        std::map<std::pair<int, int>, ESM::Pathgrid>::const_iterator iter =
+            mPathgrids.find(std::make_pair(x, y));
+        return iter != mPathgrids.end() ? &iter->second : 0;
+      }
+
+      /// 8 x 8 points, 1024 units apart, connected to their horizontal and vertical neighbours
+      void addCell(int x, int y)
+      {
+        ESM::Pathgrid& grid = mPathgrids[std::make_pair(x, y)];
+        grid.mData.mX = x;
+        grid.mData.mY = y;
+
+        PathgridTest::addGrid(grid, 8, 8, 1024, 512);
+      }
+  };
+
+  void checkPath(const std::vector<ESM::Pathgrid::Point>& path, const float *start, const float *end)
+  {
+    ASSERT_FALSE(path.empty());
+    ASSERT_GT(1024, std::abs(path.front().mX - start[0]) + std::abs(path.front().mY - start[1]));
+    ASSERT_GT(1024, std::abs(path.back().mX - end[0]) + std::abs(path.back().mY - end[1]));
+
+    // no jumps: neighbouring points of the grids and portals are 1024 units apart
+    for (std::size_t i = 1; i < path.size(); ++i)
+      ASSERT_GE(1024, std::abs(path[i].mX - path[i - 1].mX) + std::abs(path[i].mY - path[i - 1].mY));
+  }
+}
+
+struct PortalGraphTest : public ::testing::Test
+{
+  protected:
+    TestStorage mStorage;
+    Pathgrid::GraphCache mGraphs;
+
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(PortalGraphTest, path_crosses_several_cells)
+{
+  for (int x = 0; x < 3; ++x)
+    mStorage.addCell(x, 0);
+
+  Pathgrid::PortalGraph portals(mStorage, mGraphs, cellSize);
+
+  float start[3] = { 600, 4000, 0 };
+  float end[3] = { 3 * cellSize - 600, 4000, 0 };
+
+  std::vector<ESM::Pathgrid::Point> path;
+  ASSERT_TRUE(portals.findPath(start, end, path));
+  checkPath(path, start, end);
+
+  // the shortest path is a straight line
+  ASSERT_EQ(24u, path.size());
+}
+
+TEST_F(PortalGraphTest, path_avoids_cells_without_pathgrid)
+{
+  for (int x = 0; x < 3; ++x)
+    for (int y = 0; y < 3; ++y)
+      if (x != 1 || y != 1)
+        mStorage.addCell(x, y);
+
+  Pathgrid::PortalGraph portals(mStorage, mGraphs, cellSize);
+
+  float start[3] = { 4000, cellSize + 4000, 0 };
+  float end[3] = { 2 * cellSize + 4000, cellSize + 4000, 0 };
+
+  std::vector<ESM::Pathgrid::Point> path;
+  ASSERT_TRUE(portals.findPath(start, end, path));
+  checkPath(path, start, end);
+
+  for (std::size_t i = 0; i < path.size(); ++i)
+    ASSERT_FALSE(path[i].mX >= cellSize && path[i].mX < 2 * cellSize &&
+        path[i].mY >= cellSize && path[i].mY < 2 * cellSize);
+}
+
+TEST_F(PortalGraphTest, abstract_paths_are_cached)
+{
+  for (int x = 0; x < 4; ++x)
+    mStorage.addCell(x, 0);
+
+  Pathgrid::PortalGraph portals(mStorage, mGraphs, cellSize);
+
+  float start[3] = { 600, 4000, 0 };
+  float end[3] = { 4 * cellSize - 600, 4000, 0 };
+
+  std::vector<ESM::Pathgrid::Point> first;
+  ASSERT_TRUE(portals.findPath(start, end, first));
+  ASSERT_EQ(1u, portals.getCachedPathCount());
+
+  std::vector<ESM::Pathgrid::Point> second;
+  ASSERT_TRUE(portals.findPath(start, end, second));
+  ASSERT_EQ(1u, portals.getCachedPathCount());
+  ASSERT_EQ(first.size(), second.size());
+
+  // graphs dropped in the meantime are rebuilt
+  mGraphs.clear();
+  ASSERT_TRUE(portals.findPath(start, end, second));
+  ASSERT_EQ(first.size(), second.size());
+}
+
+TEST_F(PortalGraphTest, no_path_within_one_cell_or_without_connection)
+{
+  mStorage.addCell(0, 0);
+  mStorage.addCell(5, 0);
+
+  Pathgrid::PortalGraph portals(mStorage, mGraphs, cellSize);
+
+  float start[3] = { 600, 600, 0 };
+  float sameCell[3] = { 4000, 4000, 0 };
+  float farCell[3] = { 5 * cellSize + 600, 600, 0 };
+
+  std::vector<ESM::Pathgrid::Point> path;
+  ASSERT_FALSE(portals.findPath(start, sameCell, path));
+  ASSERT_FALSE(portals.findPath(start, farCell, path));
+  ASSERT_TRUE(path.empty());
+}
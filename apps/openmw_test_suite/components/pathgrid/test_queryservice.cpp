@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include "components/pathgrid/queryservice.hpp"
+
+#include "gridhelpers.hpp"
+
+namespace
+{
+  /// Update until the request is no longer pending
+  Pathgrid::QueryService::Status waitForResult(Pathgrid::QueryService& service,
+      Pathgrid::QueryService::RequestId id, std::vector<ESM::Pathgrid::Point>& path)
+  {
+    for (int i = 0; i < 1000; ++i)
+    {
+      service.update();
+
+      Pathgrid::QueryService::Status status = service.getResult(id, path);
+
+      if (status != Pathgrid::QueryService::Status_Pending)
+        return status;
+
+      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    }
+
+    return Pathgrid::QueryService::Status_Pending;
+  }
+
+  /// Wait until the worker is done with all requests
+  void waitForWorker(Pathgrid::QueryService& service)
+  {
+    for (int i = 0; i < 1000 && service.getQueueDepth() > 0; ++i)
+      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+  }
+}
+
+struct QueryServiceTest : public ::testing::Test
+{
+  protected:
+    ESM::Pathgrid mGrid;
+    Pathgrid::GraphCache mGraphs;
+
+    virtual void SetUp()
+    {
+      // a line of points, 100 units apart
+      PathgridTest::addGrid(mGrid, 10, 1, 100);
+    }
+
+    virtual void TearDown()
+    {
+    }
+};
+
+TEST_F(QueryServiceTest, path_arrives_on_later_update)
+{
+  Pathgrid::QueryService service(0);
+
+  float start[3] = { 1000, 2010, 0 };
+  float goal[3] = { 1890, 1990, 0 };
+
+  Pathgrid::QueryService::RequestId id =
+      service.submit(mGraphs.get(mGrid), 1000, 2000, start, goal);
+
+  ASSERT_NE(0u, id);
+
+  std::vector<ESM::Pathgrid::Point> path;
+  ASSERT_EQ(Pathgrid::QueryService::Status_Found, waitForResult(service, id, path));
+
+  // points in world coordinates, from the point closest to the start to the one closest to the goal
+  ASSERT_EQ(10u, path.size());
+  ASSERT_EQ(1000, path.front().mX);
+  ASSERT_EQ(1900, path.back().mX);
+  ASSERT_EQ(2000, path.back().mY);
+
+  // a result can be picked up only once
+  ASSERT_EQ(Pathgrid::QueryService::Status_Unknown, service.getResult(id, path));
+}
+
+TEST_F(QueryServiceTest, unconnected_points_have_no_path)
+{
+  ESM::Pathgrid grid;
+  PathgridTest::addGrid(grid, 2, 1, 100);
+  grid.mEdges.clear();
+
+  Pathgrid::QueryService service(0);
+
+  float start[3] = { 0, 0, 0 };
+  float goal[3] = { 100, 0, 0 };
+
+  Pathgrid::QueryService::RequestId id = service.submit(mGraphs.get(grid), 0, 0, start, goal);
+
+  std::vector<ESM::Pathgrid::Point> path;
+  ASSERT_EQ(Pathgrid::QueryService::Status_NotFound, waitForResult(service, id, path));
+}
+
+TEST_F(QueryServiceTest, cancelled_requests_have_no_result)
+{
+  Pathgrid::QueryService service(0);
+
+  float start[3] = { 0, 0, 0 };
+  float goal[3] = { 900, 0, 0 };
+
+  std::vector<Pathgrid::QueryService::RequestId> ids;
+
+  for (int i = 0; i < 20; ++i)
+    ids.push_back(service.submit(mGraphs.get(mGrid), 0, 0, start, goal));
+
+  // cancel every other request, whether it is queued, being solved or finished already
+  for (std::size_t i = 0; i < ids.size(); i += 2)
+    service.cancel(ids[i]);
+
+  waitForWorker(service);
+  service.update();
+
+  std::vector<ESM::Pathgrid::Point> path;
+
+  for (std::size_t i = 0; i < ids.size(); ++i)
+  {
+    if (i % 2)
+      ASSERT_EQ(Pathgrid::QueryService::Status_Found, waitForResult(service, ids[i], path));
+    else
+      ASSERT_EQ(Pathgrid::QueryService::Status_Unknown, service.getResult(ids[i], path));
+  }
+
+  ASSERT_EQ(0, service.getQueueDepth());
+  ASSERT_EQ(0, service.getWaitingResults());
+}
+
+TEST_F(QueryServiceTest, results_per_update_are_limited)
+{
+  Pathgrid::QueryService service(3);
+
+  float start[3] = { 0, 0, 0 };
+  float goal[3] = { 900, 0, 0 };
+
+  std::vector<Pathgrid::QueryService::RequestId> ids;
+
+  for (int i = 0; i < 7; ++i)
+    ids.push_back(service.submit(mGraphs.get(mGrid), 0, 0, start, goal));
+
+  waitForWorker(service);
+
+  for (int i = 0; i < 1000 && service.getWaitingResults() < 7; ++i)
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+
+  ASSERT_EQ(7, service.getWaitingResults());
+
+  std::vector<ESM::Pathgrid::Point> path;
+
+  // results are handed over in the order of the requests
+  service.update();
+  ASSERT_EQ(4, service.getWaitingResults());
+  ASSERT_EQ(Pathgrid::QueryService::Status_Found, service.getResult(ids[2], path));
+  ASSERT_EQ(Pathgrid::QueryService::Status_Pending, service.getResult(ids[3], path));
+
+  service.update();
+  service.update();
+  ASSERT_EQ(0, service.getWaitingResults());
+  ASSERT_EQ(Pathgrid::QueryService::Status_Found, service.getResult(ids[6], path));
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "components/pathgrid/spatialindex.hpp"
+
+#include "gridhelpers.hpp"
+
+namespace
+{
+  float squaredDistance(const std::vector<float>& positions, int point, float x, float y, float z)
+  {
+    x -= positions[point * 3];
+    y -= positions[point * 3 + 1];
+    z -= positions[point * 3 + 2];
+    return x * x + y * y + z * z;
+  }
+
+  /// Linear scan, like the lookups before the index
+  int findClosest(const std::vector<float>& positions, float x, float y, float z)
+  {
+    int closest = -1;
+
+    for (int i = 0; i < static_cast<int>(positions.size() / 3); ++i)
+      if (closest == -1 || squaredDistance(positions, i, x, y, z) < squaredDistance(positions, closest, x, y, z))
+        closest = i;
+
+    return closest;
+  }
+}
+
+struct SpatialIndexTest : public ::testing::Test
+{
+  protected:
+    std::vector<float> mPositions;
+    unsigned int mSeed;
+
+    virtual void SetUp()
+    {
+      mSeed = 4711;
+
+      // clustered like a town, with a few outlying points
+      for (int i = 0; i < 600; ++i)
+      {
+        float spread = i % 10 == 0 ? 8192 : 1500;
+        mPositions.push_back(random(spread));
+        mPositions.push_back(random(spread));
+        mPositions.push_back(random(500));
+      }
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    float random(float range)
+    {
+      mSeed = mSeed * 1103515245 + 12345;
+      return static_cast<float>(static_cast<int>((mSeed >> 8) % 65536) - 32768) / 32768 * range;
+    }
+};
+
+TEST_F(SpatialIndexTest, closest_point_matches_linear_scan)
+{
+  Pathgrid::SpatialIndex index(mPositions);
+
+  for (int i = 0; i < 1000; ++i)
+  {
+    // includes positions far outside of the area covered by the points
+    float range = i % 4 == 0 ? 20000 : 4000;
+    float x = random(range);
+    float y = random(range);
+    float z = random(range);
+
+    ASSERT_EQ(findClosest(mPositions, x, y, z), index.getClosestPoint(x, y, z));
+  }
+}
+
+TEST_F(SpatialIndexTest, points_in_radius_match_linear_scan)
+{
+  Pathgrid::SpatialIndex index(mPositions);
+  std::vector<int> points;
+
+  for (int i = 0; i < 200; ++i)
+  {
+    float x = random(4000);
+    float y = random(4000);
+    float z = random(500);
+    float radius = i % 2 ? 512 : 2048;
+
+    std::vector<int> expected;
+    for (int point = 0; point < static_cast<int>(mPositions.size() / 3); ++point)
+      if (squaredDistance(mPositions, point, x, y, z) <= radius * radius)
+        expected.push_back(point);
+
+    index.getPointsInRadius(x, y, z, radius, points);
+    ASSERT_EQ(expected, points);
+  }
+}
+
+TEST_F(SpatialIndexTest, degenerate_point_sets)
+{
+  std::vector<float> empty;
+  Pathgrid::SpatialIndex emptyIndex(empty);
+  ASSERT_EQ(-1, emptyIndex.getClosestPoint(0, 0, 0));
+
+  // all points on one line
+  ESM::Pathgrid line;
+  PathgridTest::addGrid(line, 10, 1, 100);
+
+  Pathgrid::SpatialIndex lineIndex(PathgridTest::getPositions(line));
+  ASSERT_EQ(9, lineIndex.getClosestPoint(5000, 300, 0));
+  ASSERT_EQ(3, lineIndex.getClosestPoint(320, -50, 10));
+}
@@ -33,6 +33,10 @@ namespace Compiler
             virtual char getGlobalType (const std::string& name) const = 0;
             ///< 'l: long, 's': short, 'f': float, ' ': does not exist.
 
+            virtual int getGlobalSlot (const std::string& name) const { return -1; }
+            ///< Slot for accessing the global variable \a name without a name lookup at runtime.
+            /// \return -1, if the variable has to be accessed by name.
+
             virtual char getMemberType (const std::string& name, const std::string& id) const = 0;
             ///< 'l: long, 's': short, 'f': float, ' ': does not exist.
 
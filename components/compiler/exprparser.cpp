@@ -302,7 +302,8 @@ namespace Compiler
 
             if (type!=' ')
             {
-                Generator::fetchGlobal (mCode, mLiterals, type, name2);
+                Generator::fetchGlobal (mCode, mLiterals, type, name2,
+                    getContext().getGlobalSlot (name2));
                 mNextOperand = false;
                 mOperands.push_back (type=='f' ? 'f' : 'l');
                 return true;
@@ -260,6 +260,36 @@ namespace
         code.push_back (Compiler::Generator::segment5 (44));
     }
 
+    void opStoreGlobalSlotShort (Compiler::Generator::CodeContainer& code)
+    {
+        code.push_back (Compiler::Generator::segment5 (65));
+    }
+
+    void opStoreGlobalSlotLong (Compiler::Generator::CodeContainer& code)
+    {
+        code.push_back (Compiler::Generator::segment5 (66));
+    }
+
+    void opStoreGlobalSlotFloat (Compiler::Generator::CodeContainer& code)
+    {
+        code.push_back (Compiler::Generator::segment5 (67));
+    }
+
+    void opFetchGlobalSlotShort (Compiler::Generator::CodeContainer& code)
+    {
+        code.push_back (Compiler::Generator::segment5 (68));
+    }
+
+    void opFetchGlobalSlotLong (Compiler::Generator::CodeContainer& code)
+    {
+        code.push_back (Compiler::Generator::segment5 (69));
+    }
+
+    void opFetchGlobalSlotFloat (Compiler::Generator::CodeContainer& code)
+    {
+        code.push_back (Compiler::Generator::segment5 (70));
+    }
+
     void opStoreMemberShort (Compiler::Generator::CodeContainer& code)
     {
         code.push_back (Compiler::Generator::segment5 (59));
@@ -664,11 +694,12 @@ namespace Compiler
         }
 
         void assignToGlobal (CodeContainer& code, Literals& literals, char localType,
-            const std::string& name, const CodeContainer& value, char valueType)
+            const std::string& name, int slot, const CodeContainer& value, char valueType)
         {
-            int index = literals.addString (name);
-
-            opPushInt (code, index);
+            if (slot>=0)
+                opPushInt (code, slot);
+            else
+                opPushInt (code, literals.addString (name));
 
             std::copy (value.begin(), value.end(), std::back_inserter (code));
 
@@ -688,17 +719,26 @@ namespace Compiler
             {
                 case 'f':
 
-                    opStoreGlobalFloat (code);
+                    if (slot>=0)
+                        opStoreGlobalSlotFloat (code);
+                    else
+                        opStoreGlobalFloat (code);
                     break;
 
                 case 's':
 
-                    opStoreGlobalShort (code);
+                    if (slot>=0)
+                        opStoreGlobalSlotShort (code);
+                    else
+                        opStoreGlobalShort (code);
                     break;
 
                 case 'l':
 
-                    opStoreGlobalLong (code);
+                    if (slot>=0)
+                        opStoreGlobalSlotLong (code);
+                    else
+                        opStoreGlobalLong (code);
                     break;
 
                 default:
@@ -708,27 +748,37 @@ namespace Compiler
         }
 
         void fetchGlobal (CodeContainer& code, Literals& literals, char localType,
-            const std::string& name)
+            const std::string& name, int slot)
         {
-            int index = literals.addString (name);
-
-            opPushInt (code, index);
+            if (slot>=0)
+                opPushInt (code, slot);
+            else
+                opPushInt (code, literals.addString (name));
 
             switch (localType)
             {
                 case 'f':
 
-                    opFetchGlobalFloat (code);
+                    if (slot>=0)
+                        opFetchGlobalSlotFloat (code);
+                    else
+                        opFetchGlobalFloat (code);
                     break;
 
                 case 's':
 
-                    opFetchGlobalShort (code);
+                    if (slot>=0)
+                        opFetchGlobalSlotShort (code);
+                    else
+                        opFetchGlobalShort (code);
                     break;
 
                 case 'l':
 
-                    opFetchGlobalLong (code);
+                    if (slot>=0)
+                        opFetchGlobalSlotLong (code);
+                    else
+                        opFetchGlobalLong (code);
                     break;
 
                 default:
@@ -96,10 +96,12 @@ namespace Compiler
         void menuMode (CodeContainer& code);
 
         void assignToGlobal (CodeContainer& code, Literals& literals, char localType,
-            const std::string& name, const CodeContainer& value, char valueType);
+            const std::string& name, int slot, const CodeContainer& value, char valueType);
+        ///< \param slot Slot of the global variable (-1: access by \a name)
 
         void fetchGlobal (CodeContainer& code, Literals& literals, char localType,
-            const std::string& name);
+            const std::string& name, int slot);
+        ///< \param slot Slot of the global variable (-1: access by \a name)
 
         void assignToMember (CodeContainer& code, Literals& literals, char memberType,
             const std::string& name, const std::string& id, const CodeContainer& value, char valueType);
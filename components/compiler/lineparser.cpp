@@ -352,7 +352,8 @@ namespace Compiler
             std::vector<Interpreter::Type_Code> code;
             char type = mExprParser.append (code);
 
-            Generator::assignToGlobal (mCode, mLiterals, mType, mName, code, type);
+            Generator::assignToGlobal (mCode, mLiterals, mType, mName,
+                getContext().getGlobalSlot (mName), code, type);
 
             mState = EndState;
             return true;
@@ -228,6 +228,7 @@ namespace Compiler
         const int opcodeToggleGodMode = 0x200021f;
         const int opcodeDisableLevitation = 0x2000220;
         const int opcodeEnableLevitation = 0x2000221;
+        const int opcodeProfileScripts = 0x2000226;
     }
 
     namespace Sky
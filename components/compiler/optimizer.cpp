@@ -0,0 +1,901 @@
+
+#include "optimizer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <utility>
+
+#include "generator.hpp"
+
+namespace
+{
+    using Interpreter::Type_Code;
+    using Interpreter::Type_Integer;
+    using Interpreter::Type_Float;
+
+    // segment 0 opcodes
+    const unsigned int opPushInt = 0;
+    const unsigned int opJumpForward = 1;
+    const unsigned int opJumpBackward = 2;
+
+    // segment 5 opcodes
+    const unsigned int opIntToFloat = 3;
+    const unsigned int opFetchIntLiteral = 4;
+    const unsigned int opFetchFloatLiteral = 5;
+    const unsigned int opFloatToInt = 6;
+    const unsigned int opNegateInt = 7;
+    const unsigned int opNegateFloat = 8;
+    const unsigned int opAddInt = 9;
+    const unsigned int opAddFloat = 10;
+    const unsigned int opSubInt = 11;
+    const unsigned int opSubFloat = 12;
+    const unsigned int opMulInt = 13;
+    const unsigned int opMulFloat = 14;
+    const unsigned int opDivInt = 15;
+    const unsigned int opDivFloat = 16;
+    const unsigned int opIntToFloat1 = 17;
+    const unsigned int opFloatToInt1 = 18;
+    const unsigned int opReturn = 20;
+    const unsigned int opSkipZero = 24;
+    const unsigned int opSkipNonZero = 25;
+    const unsigned int opCompareIntFirst = 26; // e, n, l, L, g, G
+    const unsigned int opCompareFloatFirst = 32;
+    const unsigned int opCompareFloatLast = 37;
+
+    bool isSegment0 (Type_Code code)
+    {
+        return (code>>30)==0;
+    }
+
+    bool getSegment5 (Type_Code code, unsigned int& opcode)
+    {
+        if ((code>>26)!=0x32)
+            return false;
+
+        opcode = code & 0x3ffffff;
+        return true;
+    }
+
+    bool isSkip (Type_Code code)
+    {
+        unsigned int opcode;
+        return getSegment5 (code, opcode) && (opcode==opSkipZero || opcode==opSkipNonZero);
+    }
+
+    Type_Code toCode (Type_Float value)
+    {
+        Type_Code code;
+        std::memcpy (&code, &value, sizeof (code));
+        return code;
+    }
+
+    Type_Float toFloat (Type_Code code)
+    {
+        Type_Float value;
+        std::memcpy (&value, &code, sizeof (value));
+        return value;
+    }
+
+    /// Integer arithmetic with the wrap around behaviour of the interpreter, but without
+    /// relying on signed overflow.
+    Type_Integer wrap (unsigned int value)
+    {
+        Type_Integer result;
+        std::memcpy (&result, &value, sizeof (result));
+        return result;
+    }
+
+    /// Script split into code and literal blocks
+    struct Script
+    {
+        std::vector<Type_Code> mCode;
+        std::vector<Type_Integer> mIntegers;
+        std::vector<Type_Float> mFloats;
+        std::vector<Type_Code> mStrings; ///< string literal block, kept as it is
+
+        bool parse (const std::vector<Type_Code>& code)
+        {
+            if (code.size()<4)
+                return false;
+
+            std::size_t size = code[0];
+            std::size_t integers = code[1];
+            std::size_t floats = code[2];
+            std::size_t strings = code[3];
+
+            if (code.size()!=4+size+integers+floats+strings)
+                return false;
+
+            std::vector<Type_Code>::const_iterator iter = code.begin()+4;
+
+            mCode.assign (iter, iter+size);
+            iter += size;
+
+            mIntegers.clear();
+            for (std::size_t i=0; i<integers; ++i)
+                mIntegers.push_back (wrap (*iter++));
+
+            mFloats.clear();
+            for (std::size_t i=0; i<floats; ++i)
+                mFloats.push_back (toFloat (*iter++));
+
+            mStrings.assign (iter, code.end());
+
+            return true;
+        }
+
+        void assemble (std::vector<Type_Code>& code) const
+        {
+            code.clear();
+
+            code.push_back (static_cast<Type_Code> (mCode.size()));
+            code.push_back (static_cast<Type_Code> (mIntegers.size()));
+            code.push_back (static_cast<Type_Code> (mFloats.size()));
+            code.push_back (static_cast<Type_Code> (mStrings.size()));
+
+            code.insert (code.end(), mCode.begin(), mCode.end());
+
+            for (std::size_t i=0; i<mIntegers.size(); ++i)
+                code.push_back (static_cast<Type_Code> (mIntegers[i]));
+
+            for (std::size_t i=0; i<mFloats.size(); ++i)
+                code.push_back (toCode (mFloats[i]));
+
+            code.insert (code.end(), mStrings.begin(), mStrings.end());
+        }
+
+        int getIntegerIndex (Type_Integer value)
+        {
+            std::vector<Type_Integer>::iterator iter =
+                std::find (mIntegers.begin(), mIntegers.end(), value);
+
+            if (iter==mIntegers.end())
+                iter = mIntegers.insert (mIntegers.end(), value);
+
+            return static_cast<int> (iter-mIntegers.begin());
+        }
+
+        int getFloatIndex (Type_Float value)
+        {
+            // compare bit patterns, so that 0 and -0 (and NaNs) are kept apart
+            for (std::size_t i=0; i<mFloats.size(); ++i)
+                if (toCode (mFloats[i])==toCode (value))
+                    return static_cast<int> (i);
+
+            mFloats.push_back (value);
+            return static_cast<int> (mFloats.size()-1);
+        }
+    };
+
+    /// Stack value. Constants are known, everything else is described by an expression.
+    struct Value
+    {
+        enum Kind
+        {
+            Kind_Integer, Kind_Float, Kind_Unknown
+        };
+
+        Kind mKind;
+        Type_Integer mInteger;
+        Type_Float mFloat;
+        std::string mExpression;
+
+        std::string describe() const
+        {
+            std::ostringstream stream;
+
+            switch (mKind)
+            {
+                case Kind_Integer: stream << "i" << mInteger; break;
+                case Kind_Float: stream << "f" << std::hex << toCode (mFloat); break;
+                case Kind_Unknown: stream << mExpression; break;
+            }
+
+            return stream.str();
+        }
+    };
+
+    Value makeInteger (Type_Integer value)
+    {
+        Value result;
+        result.mKind = Value::Kind_Integer;
+        result.mInteger = value;
+        result.mFloat = 0;
+        return result;
+    }
+
+    Value makeFloat (Type_Float value)
+    {
+        Value result;
+        result.mKind = Value::Kind_Float;
+        result.mInteger = 0;
+        result.mFloat = value;
+        return result;
+    }
+
+    Value makeUnknown (const std::string& expression)
+    {
+        Value result;
+        result.mKind = Value::Kind_Unknown;
+        result.mInteger = 0;
+        result.mFloat = 0;
+        result.mExpression = expression;
+        return result;
+    }
+
+    bool isUnary (unsigned int opcode)
+    {
+        return opcode==opIntToFloat || opcode==opFloatToInt || opcode==opNegateInt ||
+            opcode==opNegateFloat;
+    }
+
+    bool isBinary (unsigned int opcode)
+    {
+        return (opcode>=opAddInt && opcode<=opDivFloat) ||
+            (opcode>=opCompareIntFirst && opcode<=opCompareFloatLast);
+    }
+
+    /// Evaluate an instruction that replaces the top of the stack.
+    /// \return Could the operation be evaluated at compile time?
+    bool foldUnary (unsigned int opcode, const Value& operand, Value& result)
+    {
+        if (operand.mKind==Value::Kind_Integer)
+        {
+            switch (opcode)
+            {
+                case opIntToFloat:
+
+                    result = makeFloat (static_cast<Type_Float> (operand.mInteger));
+                    return true;
+
+                case opNegateInt:
+
+                    result = makeInteger (wrap (0u-static_cast<unsigned int> (operand.mInteger)));
+                    return true;
+            }
+        }
+        else if (operand.mKind==Value::Kind_Float)
+        {
+            switch (opcode)
+            {
+                case opFloatToInt:
+
+                    // out of range conversions are undefined; leave them to the interpreter
+                    if (operand.mFloat>=-2147483648.0f && operand.mFloat<2147483648.0f)
+                    {
+                        result = makeInteger (static_cast<Type_Integer> (operand.mFloat));
+                        return true;
+                    }
+
+                    break;
+
+                case opNegateFloat:
+
+                    result = makeFloat (-operand.mFloat);
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Evaluate an instruction that replaces the two topmost stack values.
+    /// \return Could the operation be evaluated at compile time?
+    bool foldBinary (unsigned int opcode, const Value& left, const Value& right, Value& result)
+    {
+        if (left.mKind==Value::Kind_Integer && right.mKind==Value::Kind_Integer)
+        {
+            Type_Integer a = left.mInteger;
+            Type_Integer b = right.mInteger;
+            unsigned int ua = static_cast<unsigned int> (a);
+            unsigned int ub = static_cast<unsigned int> (b);
+
+            switch (opcode)
+            {
+                case opAddInt: result = makeInteger (wrap (ua+ub)); return true;
+                case opSubInt: result = makeInteger (wrap (ua-ub)); return true;
+                case opMulInt: result = makeInteger (wrap (ua*ub)); return true;
+
+                case opDivInt:
+
+                    // division by zero must still throw at runtime
+                    if (b==0 || (b==-1 && a==std::numeric_limits<Type_Integer>::min()))
+                        return false;
+
+                    result = makeInteger (a/b);
+                    return true;
+
+                case opCompareIntFirst: result = makeInteger (a==b); return true;
+                case opCompareIntFirst+1: result = makeInteger (a!=b); return true;
+                case opCompareIntFirst+2: result = makeInteger (a<b); return true;
+                case opCompareIntFirst+3: result = makeInteger (a<=b); return true;
+                case opCompareIntFirst+4: result = makeInteger (a>b); return true;
+                case opCompareIntFirst+5: result = makeInteger (a>=b); return true;
+            }
+        }
+        else if (left.mKind==Value::Kind_Float && right.mKind==Value::Kind_Float)
+        {
+            Type_Float a = left.mFloat;
+            Type_Float b = right.mFloat;
+            Type_Float value;
+
+            switch (opcode)
+            {
+                case opAddFloat: value = a+b; result = makeFloat (value); return true;
+                case opSubFloat: value = a-b; result = makeFloat (value); return true;
+                case opMulFloat: value = a*b; result = makeFloat (value); return true;
+
+                case opDivFloat:
+
+                    if (b==0)
+                        return false;
+
+                    value = a/b;
+                    result = makeFloat (value);
+                    return true;
+
+                case opCompareFloatFirst: result = makeInteger (a==b); return true;
+                case opCompareFloatFirst+1: result = makeInteger (a!=b); return true;
+                case opCompareFloatFirst+2: result = makeInteger (a<b); return true;
+                case opCompareFloatFirst+3: result = makeInteger (a<=b); return true;
+                case opCompareFloatFirst+4: result = makeInteger (a>b); return true;
+                case opCompareFloatFirst+5: result = makeInteger (a>=b); return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Instruction during optimization
+    struct Item
+    {
+        enum Kind
+        {
+            Kind_Code, ///< instruction that is kept as it is
+            Kind_Constant, ///< push of a constant (immediate or via literal)
+            Kind_Jump, ///< unconditional jump
+            Kind_Removed
+        };
+
+        Kind mKind;
+        Type_Code mCode;
+        Value mValue;
+        int mTarget; ///< index of the jump target
+        bool mBoundary; ///< Target of a jump or skip; can't be merged with preceding items.
+        bool mProtected; ///< Follows a skip; must stay a single instruction.
+
+        bool getSegment5 (unsigned int& opcode) const
+        {
+            return mKind==Kind_Code && ::getSegment5 (mCode, opcode);
+        }
+    };
+
+    /// \return index of the next item after \a index, that can be merged with it (-1: none)
+    int getNext (const std::vector<Item>& items, int index)
+    {
+        for (++index; index<static_cast<int> (items.size()); ++index)
+        {
+            if (items[index].mBoundary)
+                return -1;
+
+            if (items[index].mKind!=Item::Kind_Removed)
+                return index;
+        }
+
+        return -1;
+    }
+
+    /// Try to merge the constant at \a index with the following instructions.
+    bool fold (std::vector<Item>& items, const Script& script, int index)
+    {
+        Item& first = items[index];
+
+        int second = getNext (items, index);
+
+        if (second==-1)
+            return false;
+
+        unsigned int opcode;
+        Value result;
+
+        if (items[second].getSegment5 (opcode))
+        {
+            const Value& value = first.mValue;
+
+            if (opcode==opFetchIntLiteral && value.mKind==Value::Kind_Integer &&
+                value.mInteger>=0 && value.mInteger<static_cast<int> (script.mIntegers.size()))
+                result = makeInteger (script.mIntegers[value.mInteger]);
+            else if (opcode==opFetchFloatLiteral && value.mKind==Value::Kind_Integer &&
+                value.mInteger>=0 && value.mInteger<static_cast<int> (script.mFloats.size()))
+                result = makeFloat (script.mFloats[value.mInteger]);
+            else if (!foldUnary (opcode, value, result))
+                return false;
+
+            first.mValue = result;
+            items[second].mKind = Item::Kind_Removed;
+            return true;
+        }
+
+        if (items[second].mKind!=Item::Kind_Constant)
+            return false;
+
+        int third = getNext (items, second);
+
+        if (third==-1 || !items[third].getSegment5 (opcode))
+            return false;
+
+        if (opcode==opIntToFloat1 || opcode==opFloatToInt1)
+        {
+            if (!foldUnary (opcode==opIntToFloat1 ? opIntToFloat : opFloatToInt, first.mValue,
+                result))
+                return false;
+
+            first.mValue = result;
+            items[third].mKind = Item::Kind_Removed;
+            return true;
+        }
+
+        if (!foldBinary (opcode, first.mValue, items[second].mValue, result))
+            return false;
+
+        first.mValue = result;
+        items[second].mKind = Item::Kind_Removed;
+        items[third].mKind = Item::Kind_Removed;
+        return true;
+    }
+
+    int getLength (const Item& item)
+    {
+        switch (item.mKind)
+        {
+            case Item::Kind_Removed: return 0;
+            case Item::Kind_Code: return 1;
+            case Item::Kind_Jump: return 1;
+
+            case Item::Kind_Constant:
+
+                if (item.mValue.mKind==Value::Kind_Integer &&
+                    item.mValue.mInteger>=0 && item.mValue.mInteger<=0xffffff)
+                    return 1;
+
+                return 2;
+        }
+
+        return 1;
+    }
+
+    void emitConstant (Script& script, const Value& value)
+    {
+        namespace Generator = Compiler::Generator;
+
+        if (value.mKind==Value::Kind_Integer)
+        {
+            if (value.mInteger>=0 && value.mInteger<=0xffffff)
+            {
+                script.mCode.push_back (Generator::segment0 (opPushInt, value.mInteger));
+            }
+            else
+            {
+                int index = script.getIntegerIndex (value.mInteger);
+                script.mCode.push_back (Generator::segment0 (opPushInt, index));
+                script.mCode.push_back (Generator::segment5 (opFetchIntLiteral));
+            }
+        }
+        else
+        {
+            int index = script.getFloatIndex (value.mFloat);
+            script.mCode.push_back (Generator::segment0 (opPushInt, index));
+            script.mCode.push_back (Generator::segment5 (opFetchFloatLiteral));
+        }
+    }
+
+    /// Values pushed since the last event of a symbolic execution
+    struct Stack
+    {
+        std::vector<Value> mValues;
+        int mUnknown; ///< number of values taken from below the last event
+
+        Stack() : mUnknown (0) {}
+
+        void push (const Value& value)
+        {
+            mValues.push_back (value);
+        }
+
+        Value pop()
+        {
+            if (mValues.empty())
+            {
+                std::ostringstream stream;
+                stream << "?" << mUnknown++;
+                return makeUnknown (stream.str());
+            }
+
+            Value value = mValues.back();
+            mValues.pop_back();
+            return value;
+        }
+
+        std::string describe() const
+        {
+            std::ostringstream stream;
+
+            stream << "[";
+
+            for (std::size_t i=0; i<mValues.size(); ++i)
+                stream << (i ? " " : "") << mValues[i].describe();
+
+            stream << "] ?" << mUnknown;
+
+            return stream.str();
+        }
+    };
+
+    std::string describeOperation (unsigned int opcode, const Value& operand)
+    {
+        std::ostringstream stream;
+        stream << "(op" << opcode << " " << operand.describe() << ")";
+        return stream.str();
+    }
+
+    std::string describeOperation (unsigned int opcode, const Value& left, const Value& right)
+    {
+        std::ostringstream stream;
+        stream << "(op" << opcode << " " << left.describe() << " " << right.describe() << ")";
+        return stream.str();
+    }
+
+    /// Symbolic execution of a segment 5 instruction without side effects.
+    /// \return Was the instruction executed (false: it needs to be treated as an event)?
+    bool evaluate (const Script& script, unsigned int opcode, Stack& stack)
+    {
+        Value result;
+
+        if (opcode==opFetchIntLiteral || opcode==opFetchFloatLiteral)
+        {
+            Value index = stack.pop();
+
+            if (opcode==opFetchIntLiteral && index.mKind==Value::Kind_Integer &&
+                index.mInteger>=0 && index.mInteger<static_cast<int> (script.mIntegers.size()))
+                result = makeInteger (script.mIntegers[index.mInteger]);
+            else if (opcode==opFetchFloatLiteral && index.mKind==Value::Kind_Integer &&
+                index.mInteger>=0 && index.mInteger<static_cast<int> (script.mFloats.size()))
+                result = makeFloat (script.mFloats[index.mInteger]);
+            else
+                result = makeUnknown (describeOperation (opcode, index));
+
+            stack.push (result);
+            return true;
+        }
+
+        if (opcode==opIntToFloat1 || opcode==opFloatToInt1)
+        {
+            Value top = stack.pop();
+            Value second = stack.pop();
+
+            if (!foldUnary (opcode==opIntToFloat1 ? opIntToFloat : opFloatToInt, second, result))
+                result = makeUnknown (describeOperation (opcode, second));
+
+            stack.push (result);
+            stack.push (top);
+            return true;
+        }
+
+        if (isUnary (opcode))
+        {
+            Value operand = stack.pop();
+
+            if (!foldUnary (opcode, operand, result))
+                result = makeUnknown (describeOperation (opcode, operand));
+
+            stack.push (result);
+            return true;
+        }
+
+        if (isBinary (opcode))
+        {
+            Value right = stack.pop();
+            Value left = stack.pop();
+
+            if (!foldBinary (opcode, left, right, result))
+                result = makeUnknown (describeOperation (opcode, left, right));
+
+            stack.push (result);
+            return true;
+        }
+
+        return false;
+    }
+
+    /// Follow the control flow from \a index to the next event (any instruction that is not a
+    /// push, a literal fetch, an arithmetic operation or an unconditional jump).
+    /// \return index of the event (size of the code for the end of the script, -1 for an
+    /// endless loop)
+    int walk (const Script& script, int index, Stack& stack)
+    {
+        int size = static_cast<int> (script.mCode.size());
+
+        for (int steps=0; steps<=size; ++steps)
+        {
+            if (index<0 || index>=size)
+                return size;
+
+            Type_Code code = script.mCode[index];
+            unsigned int opcode;
+
+            if (isSegment0 (code))
+            {
+                int arg = static_cast<int> (code & 0xffffff);
+
+                switch (code>>24)
+                {
+                    case opPushInt: stack.push (makeInteger (arg)); ++index; continue;
+                    case opJumpForward: index += arg; continue;
+                    case opJumpBackward: index -= arg; continue;
+                }
+
+                return index;
+            }
+
+            if (!getSegment5 (code, opcode) || !evaluate (script, opcode, stack))
+                return index;
+
+            ++index;
+        }
+
+        return -1;
+    }
+
+    std::string describeEvent (const Script& script, int index, const Stack& stack)
+    {
+        if (index==-1)
+            return "endless loop";
+
+        if (index==static_cast<int> (script.mCode.size()))
+            return "end of script";
+
+        std::ostringstream stream;
+        stream << "0x" << std::hex << script.mCode[index] << " " << stack.describe();
+        return stream.str();
+    }
+}
+
+namespace Compiler
+{
+    void optimize (std::vector<Interpreter::Type_Code>& code)
+    {
+        Script script;
+
+        if (!script.parse (code))
+            return;
+
+        int size = static_cast<int> (script.mCode.size());
+
+        std::vector<Item> items (size);
+
+        for (int i=0; i<size; ++i)
+        {
+            Item& item = items[i];
+            item.mKind = Item::Kind_Code;
+            item.mCode = script.mCode[i];
+            item.mTarget = 0;
+            item.mBoundary = false;
+            item.mProtected = false;
+
+            if (isSegment0 (item.mCode))
+            {
+                int arg = static_cast<int> (item.mCode & 0xffffff);
+
+                switch (item.mCode>>24)
+                {
+                    case opPushInt:
+
+                        item.mKind = Item::Kind_Constant;
+                        item.mValue = makeInteger (arg);
+                        break;
+
+                    case opJumpForward:
+                    case opJumpBackward:
+
+                        item.mKind = Item::Kind_Jump;
+                        item.mTarget = (item.mCode>>24)==opJumpForward ? i+arg : i-arg;
+
+                        if (item.mTarget<0 || item.mTarget>size)
+                            return;
+
+                        break;
+                }
+            }
+        }
+
+        for (int i=0; i<size; ++i)
+        {
+            if (items[i].mKind==Item::Kind_Jump && items[i].mTarget<size)
+                items[items[i].mTarget].mBoundary = true;
+
+            if (items[i].mKind==Item::Kind_Code && isSkip (items[i].mCode))
+            {
+                if (i+1<size)
+                    items[i+1].mBoundary = items[i+1].mProtected = true;
+
+                if (i+2<size)
+                    items[i+2].mBoundary = true;
+            }
+        }
+
+        // constant folding
+        for (bool changed = true; changed; )
+        {
+            changed = false;
+
+            for (int i=0; i<size; ++i)
+                if (items[i].mKind==Item::Kind_Constant && fold (items, script, i))
+                    changed = true;
+        }
+
+        // jumps to jumps
+        for (int i=0; i<size; ++i)
+            if (items[i].mKind==Item::Kind_Jump)
+            {
+                int& target = items[i].mTarget;
+
+                for (int steps=0; steps<size && target<size && items[target].mKind==Item::Kind_Jump &&
+                    items[target].mTarget!=i; ++steps)
+                    target = items[target].mTarget;
+            }
+
+        // jumps to the next instruction
+        for (int i=size-1; i>=0; --i)
+            if (items[i].mKind==Item::Kind_Jump && !items[i].mProtected && items[i].mTarget>i)
+            {
+                int next = i+1;
+
+                while (next<items[i].mTarget && items[next].mKind==Item::Kind_Removed)
+                    ++next;
+
+                if (next==items[i].mTarget)
+                    items[i].mKind = Item::Kind_Removed;
+            }
+
+        // relocation
+        std::vector<int> positions (size+1);
+        int position = 0;
+
+        for (int i=0; i<size; ++i)
+        {
+            positions[i] = position;
+
+            int length = getLength (items[i]);
+
+            if (items[i].mProtected && length!=1)
+                return;
+
+            position += length;
+        }
+
+        positions[size] = position;
+
+        Script optimized;
+        optimized.mIntegers = script.mIntegers;
+        optimized.mFloats = script.mFloats;
+        optimized.mStrings = script.mStrings;
+
+        for (int i=0; i<size; ++i)
+        {
+            const Item& item = items[i];
+
+            switch (item.mKind)
+            {
+                case Item::Kind_Removed:
+
+                    break;
+
+                case Item::Kind_Code:
+
+                    optimized.mCode.push_back (item.mCode);
+                    break;
+
+                case Item::Kind_Constant:
+
+                    emitConstant (optimized, item.mValue);
+                    break;
+
+                case Item::Kind_Jump:
+                {
+                    int offset = positions[item.mTarget]-positions[i];
+
+                    if (offset==0 || offset>0xffffff || offset<-0xffffff)
+                        return;
+
+                    optimized.mCode.push_back (offset>0 ?
+                        Generator::segment0 (opJumpForward, offset) :
+                        Generator::segment0 (opJumpBackward, -offset));
+                    break;
+                }
+            }
+        }
+
+        optimized.assemble (code);
+    }
+
+    std::string verifyOptimized (const std::vector<Interpreter::Type_Code>& original,
+        const std::vector<Interpreter::Type_Code>& optimized)
+    {
+        Script scripts[2];
+
+        if (!scripts[0].parse (original))
+            return "malformed original code";
+
+        if (!scripts[1].parse (optimized))
+            return "malformed optimized code";
+
+        if (scripts[0].mStrings!=scripts[1].mStrings)
+            return "string literals differ";
+
+        // literals may only be appended
+        if (scripts[0].mIntegers.size()>scripts[1].mIntegers.size() ||
+            !std::equal (scripts[0].mIntegers.begin(), scripts[0].mIntegers.end(),
+            scripts[1].mIntegers.begin()))
+            return "integer literals differ";
+
+        if (scripts[0].mFloats.size()>scripts[1].mFloats.size())
+            return "float literals differ";
+
+        for (std::size_t i=0; i<scripts[0].mFloats.size(); ++i)
+            if (toCode (scripts[0].mFloats[i])!=toCode (scripts[1].mFloats[i]))
+                return "float literals differ";
+
+        // Walk both scripts in parallel from event to event. Once an event has been executed the
+        // stack content is unknown, so each pair of event successors only needs to be checked once.
+        std::set<std::pair<int, int> > visited;
+        std::vector<std::pair<int, int> > pending (1, std::make_pair (0, 0));
+
+        while (!pending.empty())
+        {
+            std::pair<int, int> start = pending.back();
+            pending.pop_back();
+
+            if (!visited.insert (start).second)
+                continue;
+
+            Stack stacks[2];
+            int events[2];
+            std::string descriptions[2];
+
+            for (int i=0; i<2; ++i)
+            {
+                events[i] = walk (scripts[i], i ? start.second : start.first, stacks[i]);
+                descriptions[i] = describeEvent (scripts[i], events[i], stacks[i]);
+            }
+
+            if (descriptions[0]!=descriptions[1])
+            {
+                std::ostringstream stream;
+                stream
+                    << "instruction " << events[0] << " (" << descriptions[0]
+                    << ") does not match optimized instruction " << events[1]
+                    << " (" << descriptions[1] << ")";
+                return stream.str();
+            }
+
+            if (events[0]==-1 || events[0]==static_cast<int> (scripts[0].mCode.size()))
+                continue;
+
+            Type_Code code = scripts[0].mCode[events[0]];
+            unsigned int opcode;
+
+            if (getSegment5 (code, opcode) && opcode==opReturn)
+                continue;
+
+            pending.push_back (std::make_pair (events[0]+1, events[1]+1));
+
+            if (isSkip (code))
+                pending.push_back (std::make_pair (events[0]+2, events[1]+2));
+        }
+
+        return "";
+    }
+}
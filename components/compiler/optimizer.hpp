@@ -0,0 +1,34 @@
+#ifndef COMPILER_OPTIMIZER_H_INCLUDED
+#define COMPILER_OPTIMIZER_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include <components/interpreter/types.hpp>
+
+namespace Compiler
+{
+    /// Peephole optimization of a complete script (header, code and literals, as produced by
+    /// Output::getCode).
+    ///
+    /// - literal fetches with a constant index are replaced by immediate pushes
+    /// - arithmetic, conversions and comparisons on constant operands are folded
+    /// - jumps to unconditional jumps are redirected to the final target
+    /// - jumps to the next instruction are removed
+    ///
+    /// Instructions that are the target of a jump or a skip are never merged with the
+    /// instructions in front of them. Existing literals keep their indices, literals created by
+    /// folding are appended. If the code can not be handled, it is left unchanged.
+    void optimize (std::vector<Interpreter::Type_Code>& code);
+
+    /// Check that \a optimized behaves like \a original.
+    ///
+    /// Both scripts are executed symbolically along all control flow paths. Every instruction
+    /// that is not a constant operation, a literal fetch or a jump must be reached in the same
+    /// order and with the same operands on the stack.
+    /// \return Description of the first difference (empty, if there is none)
+    std::string verifyOptimized (const std::vector<Interpreter::Type_Code>& original,
+        const std::vector<Interpreter::Type_Code>& optimized);
+}
+
+#endif
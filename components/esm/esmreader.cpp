@@ -1,5 +1,6 @@
 #include "esmreader.hpp"
 #include <stdexcept>
+#include <iostream>
 
 #include "../files/constrainedfiledatastream.hpp"
 
@@ -11,7 +12,7 @@ using namespace Misc;
 ESM_Context ESMReader::getContext()
 {
     // Update the file position before returning
-    mCtx.filePos = mEsm->tell();
+    mCtx.filePos = getFileOffset();
     return mCtx;
 }
 
@@ -19,6 +20,10 @@ ESMReader::ESMReader()
     : mBuffer(50*1024)
     , mRecordFlags(0)
     , mIdx(0)
+    , mMapBegin(NULL)
+    , mMapPtr(NULL)
+    , mMapEnd(NULL)
+    , mUseMapping(true)
     , mGlobalReaderList(NULL)
     , mEncoder(NULL)
 {
@@ -39,12 +44,27 @@ void ESMReader::restoreContext(const ESM_Context &rc)
     mCtx = rc;
 
     // Make sure we seek to the right place
-    mEsm->seek(mCtx.filePos);
+    seek(mCtx.filePos);
+}
+
+void ESMReader::seek(size_t pos)
+{
+    if (mMapBegin)
+    {
+        if (pos > static_cast<size_t> (mMapEnd - mMapBegin))
+            fail("Attempt to seek past end of file");
+        mMapPtr = mMapBegin + pos;
+    }
+    else
+        mEsm->seek(pos);
 }
 
 void ESMReader::close()
 {
     mEsm.setNull();
+    // Only drop our reference; copies of this reader may still share the mapping.
+    mMappedFile = boost::iostreams::mapped_file_source();
+    mMapBegin = mMapPtr = mMapEnd = NULL;
     mCtx.filename.clear();
     mCtx.leftFile = 0;
     mCtx.leftRec = 0;
@@ -76,12 +96,43 @@ void ESMReader::open(Ogre::DataStreamPtr _esm, const std::string &name)
 
 void ESMReader::open(const std::string &file)
 {
-    open (openConstrainedFileDataStream (file.c_str ()), file);
+    openRaw(file);
+
+    if (getRecName() != "TES3")
+        fail("Not a valid Morrowind file");
+
+    getRecHeader();
+
+    mHeader.load (*this);
 }
 
 void ESMReader::openRaw(const std::string &file)
 {
-    openRaw (openConstrainedFileDataStream (file.c_str ()), file);
+    if (!mUseMapping)
+    {
+        openRaw (openConstrainedFileDataStream (file.c_str ()), file);
+        return;
+    }
+
+    close();
+
+    try
+    {
+        mMappedFile.open(file);
+    }
+    catch (const std::exception &e)
+    {
+        // Mapping can fail (e.g. empty files or exhausted address space); fall back to the
+        // buffered stream in that case.
+        std::cerr << "Failed to memory map " << file << ": " << e.what() << std::endl;
+        openRaw (openConstrainedFileDataStream (file.c_str ()), file);
+        return;
+    }
+
+    mMapBegin = mMapPtr = mMappedFile.data();
+    mMapEnd = mMapBegin + mMappedFile.size();
+    mCtx.filename = file;
+    mCtx.leftFile = mMappedFile.size();
 }
 
 int64_t ESMReader::getHNLong(const char *name)
@@ -117,8 +168,7 @@ std::string ESMReader::getHString()
     {
         // Skip the following zero byte
         mCtx.leftRec--;
-        char c;
-        mEsm->read(&c, 1);
+        skip(1);
         return "";
     }
 
@@ -177,7 +227,7 @@ void ESMReader::getSubName()
     }
 
     // reading the subrecord data anyway.
-    mEsm->read(mCtx.subName.name, 4);
+    getExact(mCtx.subName.name, 4);
     mCtx.leftRec -= 4;
 }
 
@@ -185,7 +235,7 @@ bool ESMReader::isEmptyOrGetName()
 {
     if (mCtx.leftRec)
     {
-        mEsm->read(mCtx.subName.name, 4);
+        getExact(mCtx.subName.name, 4);
         mCtx.leftRec -= 4;
         return false;
     }
@@ -282,6 +332,15 @@ void ESMReader::getRecHeader(uint32_t &flags)
 
 void ESMReader::getExact(void*x, int size)
 {
+    if (mMapBegin)
+    {
+        if (size > mMapEnd - mMapPtr)
+            fail("Read error");
+        memcpy(x, mMapPtr, size);
+        mMapPtr += size;
+        return;
+    }
+
     int t = mEsm->read(x, size);
     if (t != size)
         fail("Read error");
@@ -289,6 +348,26 @@ void ESMReader::getExact(void*x, int size)
 
 std::string ESMReader::getString(int size)
 {
+    if (mMapBegin)
+    {
+        if (size > mMapEnd - mMapPtr)
+            fail("Read error");
+
+        // Pure ASCII strings need no conversion, so build the result straight from the
+        // mapped data. Like the encoder, stop at the first zero terminator.
+        const char *begin = mMapPtr;
+        const char *end = begin;
+        const char *last = begin + size;
+        while (end != last && *end && !(*end & 0x80))
+            ++end;
+
+        if (end == last || !*end)
+        {
+            mMapPtr += size;
+            return std::string(begin, end);
+        }
+    }
+
     size_t s = size;
     if (mBuffer.size() <= s)
         // Add some extra padding to reduce the chance of having to resize
@@ -316,8 +395,8 @@ void ESMReader::fail(const std::string &msg)
     ss << "\n  File: " << mCtx.filename;
     ss << "\n  Record: " << mCtx.recName.toString();
     ss << "\n  Subrecord: " << mCtx.subName.toString();
-    if (!mEsm.isNull())
-        ss << "\n  Offset: 0x" << hex << mEsm->tell();
+    if (mMapBegin || !mEsm.isNull())
+        ss << "\n  Offset: 0x" << hex << getFileOffset();
     throw std::runtime_error(ss.str());
 }
 
@@ -9,6 +9,8 @@
 
 #include <OgreDataStream.h>
 
+#include <boost/iostreams/device/mapped_file.hpp>
+
 #include <components/misc/stringops.hpp>
 
 #include <components/to_utf8/to_utf8.hpp>
@@ -66,14 +68,20 @@ public:
   /// currently open file first, if any.
   void open(Ogre::DataStreamPtr _esm, const std::string &name);
 
+  /// Open a file from disk. If memory mapping is enabled (the default), the whole file is
+  /// mapped and read through a plain pointer; otherwise a buffered data stream is used.
   void open(const std::string &file);
 
   void openRaw(const std::string &file);
 
+  /// Enable or disable memory mapping for files opened by name. Takes effect on the next open.
+  void setMemoryMapped(bool mapped) { mUseMapping = mapped; }
+  bool isMemoryMapped() const { return mMapBegin != NULL; }
+
   /// Get the file size. Make sure that the file has been opened!
-  size_t getFileSize() { return mEsm->size(); }
+  size_t getFileSize() { return mMapBegin ? static_cast<size_t> (mMapEnd - mMapBegin) : mEsm->size(); }
   /// Get the current position in the file. Make sure that the file has been opened!
-  size_t getFileOffset() { return mEsm->tell(); }
+  size_t getFileOffset() { return mMapBegin ? static_cast<size_t> (mMapPtr - mMapBegin) : mEsm->tell(); }
 
   // This is a quick hack for multiple esm/esp files. Each plugin introduces its own
   //  terrain palette, but ESMReader does not pass a reference to the correct plugin
@@ -245,8 +253,18 @@ public:
   // them from native encoding to UTF8 in the process.
   std::string getString(int size);
 
-  void skip(int bytes) { mEsm->seek(mEsm->tell()+bytes); }
-  uint64_t getOffset() { return mEsm->tell(); }
+  void skip(int bytes)
+  {
+      if (mMapBegin)
+      {
+          if (bytes > mMapEnd - mMapPtr)
+              fail("Attempt to skip past end of file");
+          mMapPtr += bytes;
+      }
+      else
+          mEsm->seek(mEsm->tell()+bytes);
+  }
+  uint64_t getOffset() { return getFileOffset(); }
 
   /// Used for error handling
   void fail(const std::string &msg);
@@ -258,8 +276,19 @@ public:
   unsigned int getRecordFlags() { return mRecordFlags; }
 
 private:
+  /// Move the read position to an absolute file offset
+  void seek(size_t pos);
+
   Ogre::DataStreamPtr mEsm;
 
+  // Memory mapped file. When mapped, mMapBegin is non-NULL and all reads go through mMapPtr
+  // instead of mEsm.
+  boost::iostreams::mapped_file_source mMappedFile;
+  const char *mMapBegin;
+  const char *mMapPtr;
+  const char *mMapEnd;
+  bool mUseMapping;
+
   ESM_Context mCtx;
 
   unsigned int mRecordFlags;
@@ -49,6 +49,19 @@ namespace Interpreter
 
             virtual void setGlobalFloat (const std::string& name, float value) = 0;
 
+            virtual int getGlobalShort (int slot) const = 0;
+            ///< Access via a slot resolved at compile time (see Compiler::Context::getGlobalSlot)
+
+            virtual int getGlobalLong (int slot) const = 0;
+
+            virtual float getGlobalFloat (int slot) const = 0;
+
+            virtual void setGlobalShort (int slot, int value) = 0;
+
+            virtual void setGlobalLong (int slot, int value) = 0;
+
+            virtual void setGlobalFloat (int slot, float value) = 0;
+
             virtual std::vector<std::string> getGlobals () const = 0;
             
             virtual char getGlobalType (const std::string& name) const = 0;
@@ -40,6 +40,12 @@ namespace Interpreter
         interpreter.installSegment5 (42, new OpFetchGlobalShort);
         interpreter.installSegment5 (43, new OpFetchGlobalLong);
         interpreter.installSegment5 (44, new OpFetchGlobalFloat);
+        interpreter.installSegment5 (65, new OpStoreGlobalSlotShort);
+        interpreter.installSegment5 (66, new OpStoreGlobalSlotLong);
+        interpreter.installSegment5 (67, new OpStoreGlobalSlotFloat);
+        interpreter.installSegment5 (68, new OpFetchGlobalSlotShort);
+        interpreter.installSegment5 (69, new OpFetchGlobalSlotLong);
+        interpreter.installSegment5 (70, new OpFetchGlobalSlotFloat);
         interpreter.installSegment5 (59, new OpStoreMemberShort);
         interpreter.installSegment5 (60, new OpStoreMemberLong);
         interpreter.installSegment5 (61, new OpStoreMemberFloat);
@@ -10,8 +10,12 @@
 
 namespace Interpreter
 {
-    void Interpreter::execute (Type_Code code)
+    Instruction Interpreter::decode (Type_Code code) const
     {
+        Instruction instruction;
+        instruction.mArg0 = 0;
+        instruction.mArg1 = 0;
+
         unsigned int segSpec = code>>30;
 
         switch (segSpec)
@@ -19,47 +23,53 @@ namespace Interpreter
             case 0:
             {
                 int opcode = code>>24;
-                unsigned int arg0 = code & 0xffffff;
-
-                std::map<int, Opcode1 *>::iterator iter = mSegment0.find (opcode);
-
-                if (iter==mSegment0.end())
-                    abortUnknownCode (0, opcode);
-
-                iter->second->execute (mRuntime, arg0);
-
-                return;
+                instruction.mType = Instruction::Type_Opcode1;
+                instruction.mOpcode1 = mSegment0.find (opcode);
+                instruction.mArg0 = code & 0xffffff;
+
+                if (!instruction.mOpcode1)
+                {
+                    instruction.mType = Instruction::Type_UnknownCode;
+                    instruction.mArg0 = 0;
+                    instruction.mArg1 = opcode;
+                }
+
+                return instruction;
             }
 
             case 1:
             {
                 int opcode = (code>>24) & 0x3f;
-                unsigned int arg0 = (code>>16) & 0xfff;
-                unsigned int arg1 = code & 0xfff;
-
-                std::map<int, Opcode2 *>::iterator iter = mSegment1.find (opcode);
-
-                if (iter==mSegment1.end())
-                    abortUnknownCode (1, opcode);
-
-                iter->second->execute (mRuntime, arg0, arg1);
-
-                return;
+                instruction.mType = Instruction::Type_Opcode2;
+                instruction.mOpcode2 = mSegment1.find (opcode);
+                instruction.mArg0 = (code>>16) & 0xfff;
+                instruction.mArg1 = code & 0xfff;
+
+                if (!instruction.mOpcode2)
+                {
+                    instruction.mType = Instruction::Type_UnknownCode;
+                    instruction.mArg0 = 1;
+                    instruction.mArg1 = opcode;
+                }
+
+                return instruction;
             }
 
             case 2:
             {
                 int opcode = (code>>20) & 0x3ff;
-                unsigned int arg0 = code & 0xfffff;
-
-                std::map<int, Opcode1 *>::iterator iter = mSegment2.find (opcode);
-
-                if (iter==mSegment2.end())
-                    abortUnknownCode (2, opcode);
-
-                iter->second->execute (mRuntime, arg0);
-
-                return;
+                instruction.mType = Instruction::Type_Opcode1;
+                instruction.mOpcode1 = mSegment2.find (opcode);
+                instruction.mArg0 = code & 0xfffff;
+
+                if (!instruction.mOpcode1)
+                {
+                    instruction.mType = Instruction::Type_UnknownCode;
+                    instruction.mArg0 = 2;
+                    instruction.mArg1 = opcode;
+                }
+
+                return instruction;
             }
         }
 
@@ -70,50 +80,89 @@ namespace Interpreter
             case 0x30:
             {
                 int opcode = (code>>8) & 0x3ffff;
-                unsigned int arg0 = code & 0xff;
+                instruction.mType = Instruction::Type_Opcode1;
+                instruction.mOpcode1 = mSegment3.find (opcode);
+                instruction.mArg0 = code & 0xff;
+
+                if (!instruction.mOpcode1)
+                {
+                    instruction.mType = Instruction::Type_UnknownCode;
+                    instruction.mArg0 = 3;
+                    instruction.mArg1 = opcode;
+                }
+
+                return instruction;
+            }
 
-                std::map<int, Opcode1 *>::iterator iter = mSegment3.find (opcode);
+            case 0x31:
+            {
+                int opcode = (code>>16) & 0x3ff;
+                instruction.mType = Instruction::Type_Opcode2;
+                instruction.mOpcode2 = mSegment4.find (opcode);
+                instruction.mArg0 = (code>>8) & 0xff;
+                instruction.mArg1 = code & 0xff;
+
+                if (!instruction.mOpcode2)
+                {
+                    instruction.mType = Instruction::Type_UnknownCode;
+                    instruction.mArg0 = 4;
+                    instruction.mArg1 = opcode;
+                }
+
+                return instruction;
+            }
 
-                if (iter==mSegment3.end())
-                    abortUnknownCode (3, opcode);
+            case 0x32:
+            {
+                int opcode = code & 0x3ffffff;
+                instruction.mType = Instruction::Type_Opcode0;
+                instruction.mOpcode0 = mSegment5.find (opcode);
 
-                iter->second->execute (mRuntime, arg0);
+                if (!instruction.mOpcode0)
+                {
+                    instruction.mType = Instruction::Type_UnknownCode;
+                    instruction.mArg0 = 5;
+                    instruction.mArg1 = opcode;
+                }
 
-                return;
+                return instruction;
             }
+        }
 
-            case 0x31:
-            {
-                int opcode = (code>>16) & 0x3ff;
-                unsigned int arg0 = (code>>8) & 0xff;
-                unsigned int arg1 = code & 0xff;
+        instruction.mType = Instruction::Type_UnknownSegment;
+        instruction.mArg0 = code;
+        return instruction;
+    }
 
-                std::map<int, Opcode2 *>::iterator iter = mSegment4.find (opcode);
+    void Interpreter::execute (const Instruction& instruction)
+    {
+        switch (instruction.mType)
+        {
+            case Instruction::Type_Opcode0:
 
-                if (iter==mSegment4.end())
-                    abortUnknownCode (4, opcode);
+                instruction.mOpcode0->execute (mRuntime);
+                return;
 
-                iter->second->execute (mRuntime, arg0, arg1);
+            case Instruction::Type_Opcode1:
 
+                instruction.mOpcode1->execute (mRuntime, instruction.mArg0);
                 return;
-            }
 
-            case 0x32:
-            {
-                int opcode = code & 0x3ffffff;
+            case Instruction::Type_Opcode2:
 
-                std::map<int, Opcode0 *>::iterator iter = mSegment5.find (opcode);
+                instruction.mOpcode2->execute (mRuntime, instruction.mArg0, instruction.mArg1);
+                return;
 
-                if (iter==mSegment5.end())
-                    abortUnknownCode (5, opcode);
+            case Instruction::Type_UnknownCode:
 
-                iter->second->execute (mRuntime);
+                abortUnknownCode (instruction.mArg0, instruction.mArg1);
+                return;
 
+            case Instruction::Type_UnknownSegment:
+
+                abortUnknownSegment (instruction.mArg0);
                 return;
-            }
         }
-
-        abortUnknownSegment (code);
     }
 
     void Interpreter::abortUnknownCode (int segment, int opcode)
@@ -135,63 +184,56 @@ namespace Interpreter
     }
 
     Interpreter::Interpreter()
+    : mSegment0 (0x20), mSegment1 (0x20), mSegment2 (0x200), mSegment3 (0x20000),
+      mSegment4 (0x200), mSegment5 (0x2000000)
     {}
 
     Interpreter::~Interpreter()
-    {
-        for (std::map<int, Opcode1 *>::iterator iter (mSegment0.begin());
-            iter!=mSegment0.end(); ++iter)
-            delete iter->second;
-
-        for (std::map<int, Opcode2 *>::iterator iter (mSegment1.begin());
-            iter!=mSegment1.end(); ++iter)
-            delete iter->second;
-
-        for (std::map<int, Opcode1 *>::iterator iter (mSegment2.begin());
-            iter!=mSegment2.end(); ++iter)
-            delete iter->second;
-
-        for (std::map<int, Opcode1 *>::iterator iter (mSegment3.begin());
-            iter!=mSegment3.end(); ++iter)
-            delete iter->second;
-
-        for (std::map<int, Opcode2 *>::iterator iter (mSegment4.begin());
-            iter!=mSegment4.end(); ++iter)
-            delete iter->second;
-
-        for (std::map<int, Opcode0 *>::iterator iter (mSegment5.begin());
-            iter!=mSegment5.end(); ++iter)
-            delete iter->second;
-    }
+    {}
 
     void Interpreter::installSegment0 (int code, Opcode1 *opcode)
     {
-        mSegment0.insert (std::make_pair (code, opcode));
+        mSegment0.install (code, opcode);
     }
 
     void Interpreter::installSegment1 (int code, Opcode2 *opcode)
     {
-        mSegment1.insert (std::make_pair (code, opcode));
+        mSegment1.install (code, opcode);
     }
 
     void Interpreter::installSegment2 (int code, Opcode1 *opcode)
     {
-        mSegment2.insert (std::make_pair (code, opcode));
+        mSegment2.install (code, opcode);
     }
 
     void Interpreter::installSegment3 (int code, Opcode1 *opcode)
     {
-        mSegment3.insert (std::make_pair (code, opcode));
+        mSegment3.install (code, opcode);
     }
 
     void Interpreter::installSegment4 (int code, Opcode2 *opcode)
     {
-        mSegment4.insert (std::make_pair (code, opcode));
+        mSegment4.install (code, opcode);
     }
 
     void Interpreter::installSegment5 (int code, Opcode0 *opcode)
     {
-        mSegment5.insert (std::make_pair (code, opcode));
+        mSegment5.install (code, opcode);
+    }
+
+    void Interpreter::decode (const Type_Code *code, int codeSize, Program& program) const
+    {
+        assert (codeSize>=4);
+
+        int opcodes = static_cast<int> (code[0]);
+
+        const Type_Code *codeBlock = code + 4;
+
+        program.clear();
+        program.reserve (opcodes);
+
+        for (int i=0; i<opcodes; ++i)
+            program.push_back (decode (codeBlock[i]));
     }
 
     void Interpreter::run (const Type_Code *code, int codeSize, Context& context)
@@ -208,9 +250,62 @@ namespace Interpreter
         {
             Type_Code code = codeBlock[mRuntime.getPC()];
             mRuntime.setPC (mRuntime.getPC()+1);
-            execute (code);
+            execute (decode (code));
         }
 
         mRuntime.clear();
     }
+
+    void Interpreter::run (const Type_Code *code, int codeSize, const Program& program,
+        Context& context, unsigned int *instructionCounts)
+    {
+        assert (codeSize>=4);
+        assert (program.size()==code[0]);
+
+        mRuntime.configure (code, codeSize, context);
+
+        int opcodes = static_cast<int> (program.size());
+
+        if (instructionCounts)
+        {
+            // separate loop, so that running without profiling does not pay for it
+            while (mRuntime.getPC()>=0 && mRuntime.getPC()<opcodes)
+            {
+                int pc = mRuntime.getPC();
+                ++instructionCounts[pc];
+                mRuntime.setPC (pc+1);
+                execute (program[pc]);
+            }
+        }
+        else
+        {
+            while (mRuntime.getPC()>=0 && mRuntime.getPC()<opcodes)
+            {
+                const Instruction& instruction = program[mRuntime.getPC()];
+                mRuntime.setPC (mRuntime.getPC()+1);
+                execute (instruction);
+            }
+        }
+
+        mRuntime.clear();
+    }
+
+    bool Interpreter::getOpcode (Type_Code code, int& segment, int& opcode)
+    {
+        switch (code>>30)
+        {
+            case 0: segment = 0; opcode = code>>24; return true;
+            case 1: segment = 1; opcode = (code>>24) & 0x3f; return true;
+            case 2: segment = 2; opcode = (code>>20) & 0x3ff; return true;
+        }
+
+        switch (code>>26)
+        {
+            case 0x30: segment = 3; opcode = (code>>8) & 0x3ffff; return true;
+            case 0x31: segment = 4; opcode = (code>>16) & 0x3ff; return true;
+            case 0x32: segment = 5; opcode = code & 0x3ffffff; return true;
+        }
+
+        return false;
+    }
 }
@@ -1,7 +1,7 @@
 #ifndef INTERPRETER_INTERPRETER_H_INCLUDED
 #define INTERPRETER_INTERPRETER_H_INCLUDED
 
-#include <map>
+#include <vector>
 
 #include "runtime.hpp"
 #include "types.hpp"
@@ -12,25 +12,129 @@ namespace Interpreter
     class Opcode1;
     class Opcode2;
 
+    /// Instruction with the opcode already looked up
+    struct Instruction
+    {
+        enum Type
+        {
+            Type_Opcode0, Type_Opcode1, Type_Opcode2,
+            Type_UnknownCode, ///< mArg0: segment, mArg1: opcode
+            Type_UnknownSegment ///< mArg0: code
+        };
+
+        Type mType;
+
+        union
+        {
+            Opcode0 *mOpcode0;
+            Opcode1 *mOpcode1;
+            Opcode2 *mOpcode2;
+        };
+
+        unsigned int mArg0;
+        unsigned int mArg1;
+    };
+
+    /// Code of a script translated by Interpreter::decode. Only valid for the interpreter that
+    /// decoded it.
+    typedef std::vector<Instruction> Program;
+
     class Interpreter
     {
+            /// Opcodes of one segment, indexed by code
+            ///
+            /// Builtin opcodes and extension opcodes (which start at the upper half of the segment's
+            /// code space) are kept in separate dense ranges, so that the table does not have to
+            /// span the unused codes in between.
+            template<typename T>
+            class OpcodeTable
+            {
+                    struct Range
+                    {
+                        std::vector<T *> mOpcodes;
+                        unsigned int mBase; // code of mOpcodes[0]
+
+                        Range() : mBase (0) {}
+
+                        ~Range()
+                        {
+                            for (typename std::vector<T *>::iterator iter (mOpcodes.begin());
+                                iter!=mOpcodes.end(); ++iter)
+                                delete *iter;
+                        }
+
+                        void install (unsigned int code, T *opcode)
+                        {
+                            if (mOpcodes.empty())
+                                mBase = code;
+                            else if (code<mBase)
+                            {
+                                mOpcodes.insert (mOpcodes.begin(), mBase-code, static_cast<T *> (0));
+                                mBase = code;
+                            }
+
+                            if (code-mBase>=mOpcodes.size())
+                                mOpcodes.resize (code-mBase+1, 0);
+
+                            if (mOpcodes[code-mBase])
+                                delete opcode; // first one wins
+                            else
+                                mOpcodes[code-mBase] = opcode;
+                        }
+
+                        T *find (unsigned int code) const
+                        {
+                            unsigned int index = code-mBase; // wraps around for code<mBase
+                            return index<mOpcodes.size() ? mOpcodes[index] : 0;
+                        }
+                    };
+
+                    Range mBuiltin;
+                    Range mExtension;
+                    unsigned int mExtensionBase; // first extension code
+
+                    OpcodeTable (const OpcodeTable&);
+                    OpcodeTable& operator= (const OpcodeTable&);
+
+                public:
+
+                    OpcodeTable (unsigned int extensionBase) : mExtensionBase (extensionBase) {}
+
+                    void install (unsigned int code, T *opcode)
+                    {
+                        if (code<mExtensionBase)
+                            mBuiltin.install (code, opcode);
+                        else
+                            mExtension.install (code, opcode);
+                    }
+
+                    T *find (unsigned int code) const
+                    {
+                        return code<mExtensionBase ? mBuiltin.find (code) : mExtension.find (code);
+                    }
+            };
+
             Runtime mRuntime;
-            std::map<int, Opcode1 *> mSegment0;
-            std::map<int, Opcode2 *> mSegment1;
-            std::map<int, Opcode1 *> mSegment2;
-            std::map<int, Opcode1 *> mSegment3;
-            std::map<int, Opcode2 *> mSegment4;
-            std::map<int, Opcode0 *> mSegment5;
+            OpcodeTable<Opcode1> mSegment0;
+            OpcodeTable<Opcode2> mSegment1;
+            OpcodeTable<Opcode1> mSegment2;
+            OpcodeTable<Opcode1> mSegment3;
+            OpcodeTable<Opcode2> mSegment4;
+            OpcodeTable<Opcode0> mSegment5;
 
             // not implemented
             Interpreter (const Interpreter&);
             Interpreter& operator= (const Interpreter&);
 
-            void execute (Type_Code code);
+            Instruction decode (Type_Code code) const;
+
+            void execute (const Instruction& instruction);
 
             void abortUnknownCode (int segment, int opcode);
+            ///< Always throws.
 
             void abortUnknownSegment (Type_Code code);
+            ///< Always throws.
 
         public:
 
@@ -56,7 +160,22 @@ namespace Interpreter
             void installSegment5 (int code, Opcode0 *opcode);
             ///< ownership of \a opcode is transferred to *this.
 
+            void decode (const Type_Code *code, int codeSize, Program& program) const;
+            ///< Look up the opcodes of all instructions in \a code once, so that \a code can be
+            /// run repeatedly without decoding it again. Must be called after all opcodes have been
+            /// installed.
+
             void run (const Type_Code *code, int codeSize, Context& context);
+
+            void run (const Type_Code *code, int codeSize, const Program& program, Context& context,
+                unsigned int *instructionCounts = 0);
+            ///< Run \a code, using \a program as decoded by this interpreter.
+            /// \param instructionCounts If not 0, the n-th element is incremented each time the n-th
+            /// instruction is executed (one element per instruction).
+
+            static bool getOpcode (Type_Code code, int& segment, int& opcode);
+            ///< Split an instruction into segment and opcode.
+            /// \return false, if the instruction does not belong to a valid segment.
     };
 }
 
@@ -206,6 +206,90 @@ namespace Interpreter
             }
     };
 
+    class OpStoreGlobalSlotShort : public Opcode0
+    {
+        public:
+
+            virtual void execute (Runtime& runtime)
+            {
+                Type_Integer data = runtime[0].mInteger;
+                int slot = runtime[1].mInteger;
+
+                runtime.getContext().setGlobalShort (slot, data);
+
+                runtime.pop();
+                runtime.pop();
+            }
+    };
+
+    class OpStoreGlobalSlotLong : public Opcode0
+    {
+        public:
+
+            virtual void execute (Runtime& runtime)
+            {
+                Type_Integer data = runtime[0].mInteger;
+                int slot = runtime[1].mInteger;
+
+                runtime.getContext().setGlobalLong (slot, data);
+
+                runtime.pop();
+                runtime.pop();
+            }
+    };
+
+    class OpStoreGlobalSlotFloat : public Opcode0
+    {
+        public:
+
+            virtual void execute (Runtime& runtime)
+            {
+                Type_Float data = runtime[0].mFloat;
+                int slot = runtime[1].mInteger;
+
+                runtime.getContext().setGlobalFloat (slot, data);
+
+                runtime.pop();
+                runtime.pop();
+            }
+    };
+
+    class OpFetchGlobalSlotShort : public Opcode0
+    {
+        public:
+
+            virtual void execute (Runtime& runtime)
+            {
+                int slot = runtime[0].mInteger;
+                Type_Integer value = runtime.getContext().getGlobalShort (slot);
+                runtime[0].mInteger = value;
+            }
+    };
+
+    class OpFetchGlobalSlotLong : public Opcode0
+    {
+        public:
+
+            virtual void execute (Runtime& runtime)
+            {
+                int slot = runtime[0].mInteger;
+                Type_Integer value = runtime.getContext().getGlobalLong (slot);
+                runtime[0].mInteger = value;
+            }
+    };
+
+    class OpFetchGlobalSlotFloat : public Opcode0
+    {
+        public:
+
+            virtual void execute (Runtime& runtime)
+            {
+                int slot = runtime[0].mInteger;
+                Type_Float value = runtime.getContext().getGlobalFloat (slot);
+                runtime[0].mFloat = value;
+            }
+    };
+
     class OpStoreMemberShort : public Opcode0
     {
         public:
@@ -35,7 +35,9 @@ namespace Interpreter
                     {
                         int index = runtime[0].mInteger;
                         runtime.pop();
-                        formattedMessage += runtime.getStringLiteral (index);
+                        std::size_t length = 0;
+                        const char *literal = runtime.getStringLiteral (index, length);
+                        formattedMessage.append (literal, length);
                     }
                     else if (c=='g' || c=='G')
                     {
@@ -7,7 +7,30 @@
 
 namespace Interpreter
 {
-    Runtime::Runtime() : mContext (0), mCode (0), mPC (0), mCodeSize(0) {}
+    Runtime::Runtime()
+    : mContext (0), mCode (0), mCodeSize (0), mPC (0), mStackSize (0), mStringOffsetsValid (false)
+    {}
+
+    void Runtime::buildStringOffsets() const
+    {
+        mStringOffsets.clear();
+
+        const char *literalBlock =
+            reinterpret_cast<const char *> (mCode + 4 + mCode[0] + mCode[1] + mCode[2]);
+
+        int size = static_cast<int> (mCode[3])*4;
+
+        // One entry per literal plus the end of the last one. The padding at the end of the block
+        // shows up as additional empty literals, which are never referenced.
+        int offset = 0;
+
+        for (; offset<size; offset += std::strlen (literalBlock+offset) + 1)
+            mStringOffsets.push_back (offset);
+
+        mStringOffsets.push_back (offset);
+
+        mStringOffsetsValid = true;
+    }
 
     int Runtime::getPC() const
     {
@@ -34,20 +57,23 @@ namespace Interpreter
 
     std::string Runtime::getStringLiteral (int index) const
     {
-        assert (index>=0 && static_cast<int> (mCode[3])>0);
+        std::size_t length = 0;
+        const char *literal = getStringLiteral (index, length);
+        return std::string (literal, length);
+    }
 
-        const char *literalBlock =
-            reinterpret_cast<const char *> (mCode + 4 + mCode[0] + mCode[1] + mCode[2]);
+    const char *Runtime::getStringLiteral (int index, std::size_t& length) const
+    {
+        if (!mStringOffsetsValid)
+            buildStringOffsets();
 
-        int offset = 0;
+        assert (index>=0 && index+1<static_cast<int> (mStringOffsets.size()));
 
-        for (; index; --index)
-        {
-            offset += std::strlen (literalBlock+offset) + 1;
-            assert (offset/4<static_cast<int> (mCode[3]));
-        }
+        const char *literalBlock =
+            reinterpret_cast<const char *> (mCode + 4 + mCode[0] + mCode[1] + mCode[2]);
 
-        return literalBlock+offset;
+        length = mStringOffsets[index+1] - mStringOffsets[index] - 1;
+        return literalBlock + mStringOffsets[index];
     }
 
     void Runtime::configure (const Interpreter::Type_Code *code, int codeSize, Context& context)
@@ -65,7 +91,8 @@ namespace Interpreter
         mContext = 0;
         mCode = 0;
         mCodeSize = 0;
-        mStack.clear();
+        mStackSize = 0;
+        mStringOffsetsValid = false;
     }
 
     void Runtime::setPC (int PC)
@@ -75,7 +102,10 @@ namespace Interpreter
 
     void Runtime::push (const Data& data)
     {
-        mStack.push_back (data);
+        if (mStackSize==StackCapacity)
+            throw std::runtime_error ("stack overflow");
+
+        mStack[mStackSize++] = data;
     }
 
     void Runtime::push (Type_Integer value)
@@ -94,18 +124,18 @@ namespace Interpreter
 
     void Runtime::pop()
     {
-        if (mStack.empty())
+        if (!mStackSize)
             throw std::runtime_error ("stack underflow");
 
-        mStack.resize (mStack.size()-1);
+        --mStackSize;
     }
 
     Data& Runtime::operator[] (int Index)
     {
-        if (Index<0 || Index>=static_cast<int> (mStack.size()))
+        if (Index<0 || Index>=mStackSize)
             throw std::runtime_error ("stack index out of range");
 
-        return mStack[mStack.size()-Index-1];
+        return mStack[mStackSize-Index-1];
     }
 
     Context& Runtime::getContext()
@@ -1,6 +1,7 @@
 #ifndef INTERPRETER_RUNTIME_H_INCLUDED
 #define INTERPRETER_RUNTIME_H_INCLUDED
 
+#include <cstddef>
 #include <vector>
 #include <string>
 
@@ -14,11 +15,22 @@ namespace Interpreter
 
     class Runtime
     {
+        public:
+
+            enum { StackCapacity = 256 }; ///< maximum number of values on the stack
+
+        private:
+
             Context *mContext;
             const Type_Code *mCode;
             int mCodeSize;
             int mPC;
-            std::vector<Data> mStack;
+            Data mStack[StackCapacity];
+            int mStackSize;
+            mutable std::vector<int> mStringOffsets; // built on first string literal access
+            mutable bool mStringOffsetsValid;
+
+            void buildStringOffsets() const;
 
         public:
 
@@ -33,6 +45,10 @@ namespace Interpreter
 
             std::string getStringLiteral (int index) const;
 
+            const char *getStringLiteral (int index, std::size_t& length) const;
+            ///< Return string literal \a index without copying it. The string is 0-terminated,
+            /// \a length does not include the terminator. Valid until configure or clear is called.
+
             void configure (const Type_Code *code, int codeSize, Context& context);
             ///< \a context and \a code must exist as least until either configure, clear or
             /// the destructor is called. \a codeSize is given in 32-bit words.
@@ -43,7 +59,7 @@ namespace Interpreter
             ///< set program counter.
 
             void push (const Data& data);
-            ///< push data on stack
+            ///< push data on stack (throws on overflow)
 
             void push (Type_Integer value);
             ///< push integer data on stack.
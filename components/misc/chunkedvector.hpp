@@ -0,0 +1,266 @@
+#ifndef MISC_CHUNKEDVECTOR_H
+#define MISC_CHUNKEDVECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <vector>
+
+namespace Misc
+{
+/// Sequence container that never moves its elements.
+///
+/// Elements are stored contiguously in chunks. The first chunk holds FirstChunk elements, each
+/// following chunk twice as many as the one before. Appending never relocates existing elements,
+/// so pointers, references and iterators stay valid for the lifetime of the container (as with
+/// std::list, except that end() advances past appended elements), while iteration walks through
+/// a few dense arrays instead of scattered list nodes.
+///
+/// Only appending is supported; elements can not be removed individually.
+template <class T, std::size_t FirstChunk = 4>
+class ChunkedVector
+{
+    std::vector<T *> mChunks;
+    std::size_t mSize;
+    std::size_t mEndChunk; // position of end()
+    std::size_t mEndOffset;
+
+    static std::size_t chunkSize(std::size_t chunk)
+    {
+        return FirstChunk << chunk;
+    }
+
+    static T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(::operator new(count * sizeof(T)));
+    }
+
+    /// Chunk and offset of the element at \a index
+    static void locate(std::size_t index, std::size_t &chunk, std::size_t &offset)
+    {
+        chunk = 0;
+        offset = index;
+        while (offset >= chunkSize(chunk))
+        {
+            offset -= chunkSize(chunk);
+            ++chunk;
+        }
+    }
+
+public:
+    template <class Value>
+    class Iterator
+    {
+        const std::vector<T *> *mChunks;
+        std::size_t mChunk;
+        std::size_t mOffset;
+
+        template <class, std::size_t> friend class ChunkedVector;
+        template <class> friend class Iterator;
+
+        Iterator(const std::vector<T *> *chunks, std::size_t chunk, std::size_t offset)
+          : mChunks(chunks), mChunk(chunk), mOffset(offset)
+        {}
+
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Value *pointer;
+        typedef Value &reference;
+
+        Iterator() : mChunks(0), mChunk(0), mOffset(0) {}
+
+        /// Conversion from iterator to const_iterator
+        template <class Other>
+        Iterator(const Iterator<Other> &other)
+          : mChunks(other.mChunks), mChunk(other.mChunk), mOffset(other.mOffset)
+        {}
+
+        reference operator*() const
+        {
+            return (*mChunks)[mChunk][mOffset];
+        }
+
+        pointer operator->() const
+        {
+            return &(*mChunks)[mChunk][mOffset];
+        }
+
+        Iterator &operator++()
+        {
+            if (++mOffset == chunkSize(mChunk))
+            {
+                ++mChunk;
+                mOffset = 0;
+            }
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator iter = *this;
+            ++*this;
+            return iter;
+        }
+
+        Iterator &operator--()
+        {
+            if (mOffset == 0)
+            {
+                --mChunk;
+                mOffset = chunkSize(mChunk);
+            }
+            --mOffset;
+            return *this;
+        }
+
+        Iterator operator--(int)
+        {
+            Iterator iter = *this;
+            --*this;
+            return iter;
+        }
+
+        template <class Other>
+        bool operator==(const Iterator<Other> &other) const
+        {
+            return mChunk == other.mChunk && mOffset == other.mOffset;
+        }
+
+        template <class Other>
+        bool operator!=(const Iterator<Other> &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    typedef T value_type;
+    typedef Iterator<T> iterator;
+    typedef Iterator<const T> const_iterator;
+
+    ChunkedVector() : mSize(0), mEndChunk(0), mEndOffset(0) {}
+
+    ChunkedVector(const ChunkedVector &other) : mSize(0), mEndChunk(0), mEndOffset(0)
+    {
+        for (const_iterator iter = other.begin(); iter != other.end(); ++iter)
+            push_back(*iter);
+    }
+
+    ChunkedVector &operator=(const ChunkedVector &other)
+    {
+        if (this != &other)
+        {
+            ChunkedVector copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    ~ChunkedVector()
+    {
+        clear();
+    }
+
+    void swap(ChunkedVector &other)
+    {
+        mChunks.swap(other.mChunks);
+        std::swap(mSize, other.mSize);
+        std::swap(mEndChunk, other.mEndChunk);
+        std::swap(mEndOffset, other.mEndOffset);
+    }
+
+    void clear()
+    {
+        for (std::size_t i = 0; i < mChunks.size(); ++i)
+        {
+            std::size_t count = i < mEndChunk ? chunkSize(i) : (i == mEndChunk ? mEndOffset : 0);
+            for (std::size_t j = 0; j < count; ++j)
+                mChunks[i][j].~T();
+            ::operator delete(mChunks[i]);
+        }
+
+        mChunks.clear();
+        mSize = 0;
+        mEndChunk = 0;
+        mEndOffset = 0;
+    }
+
+    std::size_t size() const { return mSize; }
+
+    bool empty() const { return mSize == 0; }
+
+    void push_back(const T &item)
+    {
+        if (mEndChunk == mChunks.size())
+            mChunks.push_back(allocate(chunkSize(mEndChunk)));
+
+        new (&mChunks[mEndChunk][mEndOffset]) T(item);
+        ++mSize;
+
+        if (++mEndOffset == chunkSize(mEndChunk))
+        {
+            ++mEndChunk;
+            mEndOffset = 0;
+        }
+    }
+
+    T &back()
+    {
+        return *--end();
+    }
+
+    const T &back() const
+    {
+        return *--end();
+    }
+
+    T &front()
+    {
+        return mChunks[0][0];
+    }
+
+    const T &front() const
+    {
+        return mChunks[0][0];
+    }
+
+    T &operator[](std::size_t index)
+    {
+        std::size_t chunk, offset;
+        locate(index, chunk, offset);
+        return mChunks[chunk][offset];
+    }
+
+    const T &operator[](std::size_t index) const
+    {
+        std::size_t chunk, offset;
+        locate(index, chunk, offset);
+        return mChunks[chunk][offset];
+    }
+
+    iterator begin()
+    {
+        return iterator(&mChunks, 0, 0);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(&mChunks, 0, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(&mChunks, mEndChunk, mEndOffset);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(&mChunks, mEndChunk, mEndOffset);
+    }
+};
+
+}
+
+#endif
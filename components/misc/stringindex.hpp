@@ -0,0 +1,227 @@
+#ifndef MISC_STRINGINDEX_H
+#define MISC_STRINGINDEX_H
+
+#include <cctype>
+#include <string>
+#include <vector>
+
+namespace Misc
+{
+/// Case insensitive hash index from string ids to objects.
+///
+/// Open addressing with linear probing. Keys are stored in lower case and are not copied: the
+/// index only keeps a pointer to the key string, which has to stay valid (and unchanged) while
+/// it is in the index. Typically it is the key of the std::map node holding the object.
+///
+/// Lookups do not allocate. find() accepts keys of any case, findLowerCase() skips the case
+/// conversion for keys that are known to be lower case already.
+template <class T>
+class StringIndex
+{
+    struct Slot
+    {
+        const std::string *mKey; // 0 for an empty slot
+        size_t mHash;
+        T *mValue;
+    };
+
+    std::vector<Slot> mSlots; // size is always 0 or a power of two
+    size_t mSize;
+
+    static char lower(char c)
+    {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    template <bool ToLower>
+    static size_t hashImpl(const char *key, size_t length)
+    {
+        // FNV-1a
+        size_t hash = 2166136261u;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<unsigned char>(ToLower ? lower(key[i]) : key[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    template <bool ToLower>
+    static bool equal(const std::string &lowerKey, const char *key, size_t length)
+    {
+        if (lowerKey.size() != length)
+            return false;
+
+        for (size_t i = 0; i < length; ++i)
+            if (lowerKey[i] != (ToLower ? lower(key[i]) : key[i]))
+                return false;
+
+        return true;
+    }
+
+    template <bool ToLower>
+    T *findImpl(const char *key, size_t length) const
+    {
+        if (mSize == 0)
+            return 0;
+
+        size_t hash = hashImpl<ToLower>(key, length);
+        size_t mask = mSlots.size() - 1;
+
+        for (size_t i = hash & mask; mSlots[i].mKey; i = (i + 1) & mask)
+        {
+            const Slot &slot = mSlots[i];
+            if (slot.mHash == hash && equal<ToLower>(*slot.mKey, key, length))
+                return slot.mValue;
+        }
+        return 0;
+    }
+
+    void place(const Slot &slot)
+    {
+        size_t mask = mSlots.size() - 1;
+        size_t i = slot.mHash & mask;
+        while (mSlots[i].mKey)
+            i = (i + 1) & mask;
+        mSlots[i] = slot;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old;
+        old.swap(mSlots);
+
+        Slot empty = { 0, 0, 0 };
+        mSlots.resize(capacity, empty);
+
+        for (typename std::vector<Slot>::const_iterator it = old.begin(); it != old.end(); ++it)
+            if (it->mKey)
+                place(*it);
+    }
+
+public:
+    StringIndex() : mSize(0) {}
+
+    /// Hash of a lower case key, as used by the index
+    static size_t hash(const std::string &lowerKey)
+    {
+        return hashImpl<false>(lowerKey.c_str(), lowerKey.size());
+    }
+
+    size_t size() const { return mSize; }
+
+    bool empty() const { return mSize == 0; }
+
+    void clear()
+    {
+        mSlots.clear();
+        mSize = 0;
+    }
+
+    /// Make room for \a count entries without rehashing
+    void reserve(size_t count)
+    {
+        size_t capacity = 16;
+        while (capacity < count * 2)
+            capacity *= 2;
+
+        if (capacity > mSlots.size())
+            rehash(capacity);
+    }
+
+    /// Add or replace an entry.
+    /// \param lowerKey Lower case key. Only a pointer to it is stored.
+    void insert(const std::string &lowerKey, T *value)
+    {
+        if (Slot *existing = findSlot(lowerKey))
+        {
+            existing->mKey = &lowerKey;
+            existing->mValue = value;
+            return;
+        }
+
+        if ((mSize + 1) * 2 > mSlots.size())
+            rehash(mSlots.empty() ? 16 : mSlots.size() * 2);
+
+        Slot slot = { &lowerKey, hash(lowerKey), value };
+        place(slot);
+        ++mSize;
+    }
+
+    /// Remove an entry.
+    /// \return Was the key present?
+    bool erase(const std::string &lowerKey)
+    {
+        if (mSize == 0)
+            return false;
+
+        size_t h = hash(lowerKey);
+        size_t mask = mSlots.size() - 1;
+
+        size_t i = h & mask;
+        for (; mSlots[i].mKey; i = (i + 1) & mask)
+            if (mSlots[i].mHash == h && *mSlots[i].mKey == lowerKey)
+                break;
+
+        if (!mSlots[i].mKey)
+            return false;
+
+        // Backward shift deletion: move following entries of the same cluster into the gap, so
+        // that no tombstones are needed.
+        size_t gap = i;
+        for (size_t j = (gap + 1) & mask; mSlots[j].mKey; j = (j + 1) & mask)
+        {
+            size_t home = mSlots[j].mHash & mask;
+            if (((j - home) & mask) >= ((j - gap) & mask))
+            {
+                mSlots[gap] = mSlots[j];
+                gap = j;
+            }
+        }
+        mSlots[gap].mKey = 0;
+        --mSize;
+        return true;
+    }
+
+    /// Case insensitive lookup. \return 0, if not found.
+    T *find(const std::string &key) const
+    {
+        return findImpl<true>(key.c_str(), key.size());
+    }
+
+    T *find(const char *key, size_t length) const
+    {
+        return findImpl<true>(key, length);
+    }
+
+    /// Lookup of a key that is already lower case. \return 0, if not found.
+    T *findLowerCase(const std::string &lowerKey) const
+    {
+        return findImpl<false>(lowerKey.c_str(), lowerKey.size());
+    }
+
+    T *findLowerCase(const char *lowerKey, size_t length) const
+    {
+        return findImpl<false>(lowerKey, length);
+    }
+
+private:
+    Slot *findSlot(const std::string &lowerKey)
+    {
+        if (mSize == 0)
+            return 0;
+
+        size_t h = hash(lowerKey);
+        size_t mask = mSlots.size() - 1;
+
+        for (size_t i = h & mask; mSlots[i].mKey; i = (i + 1) & mask)
+            if (mSlots[i].mHash == h && *mSlots[i].mKey == lowerKey)
+                return &mSlots[i];
+
+        return 0;
+    }
+};
+
+}
+
+#endif
@@ -35,6 +35,19 @@ public:
         return true;
     }
 
+    /// Compare with a string that is not stored in a std::string (\a y needs no terminator)
+    static bool ciEqual(const std::string &x, const char *y, size_t length) {
+        if (x.size() != length) {
+            return false;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if (std::tolower(x[i]) != std::tolower(y[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     static int ciCompareLen(const std::string &x, const std::string &y, size_t len)
     {
         std::string::const_iterator xit = x.begin();
@@ -35,8 +35,7 @@
 
 #include <iostream>
 
-//TODO: when threading is needed, enable these
-//#include <boost/mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/locks.hpp>
 
 namespace Nif
@@ -44,15 +43,7 @@ namespace Nif
 
 class NIFFile::LoadedCache
 {
-    //TODO: enable this to make cache thread safe...
-    //typedef boost::mutex mutex;
-    
-    struct mutex
-    {
-        void lock () {};
-        void unlock () {}
-    };
-    
+    typedef boost::mutex mutex;
     typedef boost::lock_guard <mutex> lock_guard;
     typedef std::map < std::string, boost::weak_ptr <NIFFile> > loaded_map;
     typedef std::vector < boost::shared_ptr <NIFFile> > locked_files;
@@ -66,54 +57,49 @@ public:
 
     static ptr create (const std::string &name)
     {
-        lock_guard _ (sProtector);
+        {
+            lock_guard _ (sProtector);
 
-        ptr result;
+            // lookup the resource, it may (probably) still exist
+            loaded_map::iterator i = sLoadedMap.find (name);
 
-        // lookup the resource
-        loaded_map::iterator i = sLoadedMap.find (name);
+            if (i != sLoadedMap.end ())
+                if (ptr result = i->second.lock ())
+                    return result;
+        }
 
-        if (i == sLoadedMap.end ()) // it doesn't existing currently,
-        {                           // or hasn't in the very near past
+        // it doesn't exist currently, or is in the process of being
+        // destroyed: create it now. the file is parsed outside of the
+        // lock, so that threads loading different files (e.g. the cell
+        // preloader and the main thread) do not block each other
+        ptr result = boost::make_shared <NIFFile> (name, psudo_private_modifier());
 
-            // create it now, for smoother threading if needed, the
-            // loading should be performed outside of the sLoaderMap
-            // lock and an alternate mechanism should be used to
-            // synchronize threads competing to load the same resource
-            result = boost::make_shared <NIFFile> (name, psudo_private_modifier());
+        // declared before the lock guard, so that a discarded copy is
+        // destroyed (and released) after the lock has been given up
+        ptr discarded;
 
-            // if we are locking the cache add an extra reference
-            // to keep the file in memory
-            if (sLockLevel > 0)
-                sLockedFiles.push_back (result);
+        lock_guard _ (sProtector);
 
-            // stash a reference to the resource so that future
-            // calls can benefit
-            sLoadedMap [name] = boost::weak_ptr <NIFFile> (result);
-        }
-        else // it may (probably) still exists
+        // another thread may have loaded the same file in the meantime,
+        // in that case the first one wins
+        if (ptr existing = sLoadedMap [name].lock ())
         {
-            // attempt to get the reference
-            result = i->second.lock ();
-
-            if (!result) // resource is in the process of being destroyed
-            {
-                // create a new instance, to replace the one that has
-                // begun the irreversible process of being destroyed
-                result = boost::make_shared <NIFFile> (name, psudo_private_modifier());
-
-                // respect the cache lock...
-                if (sLockLevel > 0)
-                    sLockedFiles.push_back (result);
-
-                // we potentially overwrite an expired pointer here
-                // but the other thread performing the delete on
-                // the previous copy of this resource will detect it
-                // and make sure not to erase the new reference
-                sLoadedMap [name] = boost::weak_ptr <NIFFile> (result);
-            }
+            discarded = result;
+            return existing;
         }
 
+        // if we are locking the cache add an extra reference
+        // to keep the file in memory
+        if (sLockLevel > 0)
+            sLockedFiles.push_back (result);
+
+        // stash a reference to the resource so that future calls can
+        // benefit. we potentially overwrite an expired pointer here
+        // but the other thread performing the delete on the previous
+        // copy of this resource will detect it and make sure not to
+        // erase the new reference
+        sLoadedMap [name] = boost::weak_ptr <NIFFile> (result);
+
         // we made it!
         return result;
     }
@@ -141,6 +141,7 @@ namespace OgreInit
         Files::loadOgrePlugin(pluginDir, "RenderSystem_GLES2", *mRoot);
         Files::loadOgrePlugin(pluginDir, "RenderSystem_GL3Plus", *mRoot);
         Files::loadOgrePlugin(pluginDir, "RenderSystem_Direct3D9", *mRoot);
+        Files::loadOgrePlugin(pluginDir, "RenderSystem_NULL", *mRoot); // optional, for headless benchmarks
         Files::loadOgrePlugin(pluginDir, "Plugin_CgProgramManager", *mRoot);
         Files::loadOgrePlugin(pluginDir, "Plugin_ParticleFX", *mRoot);
     }
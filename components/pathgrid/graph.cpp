@@ -0,0 +1,241 @@
+#include "graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <components/esm/loadpgrd.hpp>
+
+namespace
+{
+    /// Heap order: smallest estimate on top.
+    struct Greater
+    {
+        bool operator() (const std::pair<float, int>& left, const std::pair<float, int>& right) const
+        {
+            return left.first>right.first;
+        }
+    };
+}
+
+namespace Pathgrid
+{
+    std::vector<float> Graph::getPositions (const ESM::Pathgrid& pathgrid)
+    {
+        std::vector<float> positions;
+        positions.reserve (pathgrid.mPoints.size()*3);
+
+        for (ESM::Pathgrid::PointList::const_iterator iter (pathgrid.mPoints.begin());
+            iter!=pathgrid.mPoints.end(); ++iter)
+        {
+            positions.push_back (iter->mX);
+            positions.push_back (iter->mY);
+            positions.push_back (iter->mZ);
+        }
+
+        return positions;
+    }
+
+    Graph::Graph (const ESM::Pathgrid& pathgrid)
+    : mPositions (getPositions (pathgrid)), mIndex (mPositions)
+    {
+        int points = static_cast<int> (pathgrid.mPoints.size());
+
+        // Most connections are listed by both of their points.
+        std::vector<std::pair<int, int> > connections;
+        connections.reserve (pathgrid.mEdges.size()*2);
+
+        for (ESM::Pathgrid::EdgeList::const_iterator iter (pathgrid.mEdges.begin());
+            iter!=pathgrid.mEdges.end(); ++iter)
+        {
+            if (iter->mV0<0 || iter->mV0>=points || iter->mV1<0 || iter->mV1>=points ||
+                iter->mV0==iter->mV1)
+                continue;
+
+            connections.push_back (std::make_pair (iter->mV0, iter->mV1));
+            connections.push_back (std::make_pair (iter->mV1, iter->mV0));
+        }
+
+        std::sort (connections.begin(), connections.end());
+        connections.erase (std::unique (connections.begin(), connections.end()), connections.end());
+
+        mOffsets.resize (points+1, 0);
+        mNeighbours.reserve (connections.size());
+        mWeights.reserve (connections.size());
+
+        for (std::vector<std::pair<int, int> >::const_iterator iter (connections.begin());
+            iter!=connections.end(); ++iter)
+        {
+            ++mOffsets[iter->first+1];
+            mNeighbours.push_back (iter->second);
+            mWeights.push_back (getDistance (iter->first, iter->second));
+        }
+
+        for (int i=0; i<points; ++i)
+            mOffsets[i+1] += mOffsets[i];
+    }
+
+    int Graph::getPointCount() const
+    {
+        return static_cast<int> (mOffsets.size())-1;
+    }
+
+    const float *Graph::getPosition (int point) const
+    {
+        return &mPositions[point*3];
+    }
+
+    int Graph::getNeighbourBegin (int point) const
+    {
+        return mOffsets[point];
+    }
+
+    int Graph::getNeighbourEnd (int point) const
+    {
+        return mOffsets[point+1];
+    }
+
+    int Graph::getNeighbour (int index) const
+    {
+        return mNeighbours[index];
+    }
+
+    float Graph::getWeight (int index) const
+    {
+        return mWeights[index];
+    }
+
+    float Graph::getDistance (int point1, int point2) const
+    {
+        const float *position1 = getPosition (point1);
+        const float *position2 = getPosition (point2);
+
+        float x = position1[0] - position2[0];
+        float y = position1[1] - position2[1];
+        float z = position1[2] - position2[2];
+
+        return std::sqrt (x*x + y*y + z*z);
+    }
+
+    const SpatialIndex& Graph::getIndex() const
+    {
+        return mIndex;
+    }
+
+
+    Search::Search() : mSearch (0) {}
+
+    void Search::prepare (int points)
+    {
+        if (static_cast<int> (mCost.size())<points)
+        {
+            mCost.resize (points);
+            mPredecessor.resize (points);
+            mReached.resize (points, 0);
+            mClosed.resize (points, 0);
+        }
+
+        if (++mSearch==0)
+        {
+            // search numbers wrapped around
+            std::fill (mReached.begin(), mReached.end(), 0);
+            std::fill (mClosed.begin(), mClosed.end(), 0);
+            mSearch = 1;
+        }
+
+        mOpen.clear();
+    }
+
+    bool Search::findPath (const Graph& graph, int start, int end, std::vector<int>& path)
+    {
+        path.clear();
+
+        int points = graph.getPointCount();
+
+        if (start<0 || start>=points || end<0 || end>=points)
+            return false;
+
+        prepare (points);
+
+        mCost[start] = 0;
+        mPredecessor[start] = start;
+        mReached[start] = mSearch;
+        mOpen.push_back (std::make_pair (graph.getDistance (start, end), start));
+
+        while (!mOpen.empty())
+        {
+            int point = mOpen.front().second;
+            std::pop_heap (mOpen.begin(), mOpen.end(), Greater());
+            mOpen.pop_back();
+
+            // The heuristic is consistent, so the first expansion of a point is the cheapest.
+            // Later entries for the same point are outdated.
+            if (mClosed[point]==mSearch)
+                continue;
+
+            mClosed[point] = mSearch;
+
+            if (point==end)
+            {
+                for (int i=end; ; i=mPredecessor[i])
+                {
+                    path.push_back (i);
+
+                    if (i==start)
+                        break;
+                }
+
+                std::reverse (path.begin(), path.end());
+                return true;
+            }
+
+            for (int i=graph.getNeighbourBegin (point); i<graph.getNeighbourEnd (point); ++i)
+            {
+                int neighbour = graph.getNeighbour (i);
+
+                if (mClosed[neighbour]==mSearch)
+                    continue;
+
+                float cost = mCost[point] + graph.getWeight (i);
+
+                if (mReached[neighbour]==mSearch && cost>=mCost[neighbour])
+                    continue;
+
+                mCost[neighbour] = cost;
+                mPredecessor[neighbour] = point;
+                mReached[neighbour] = mSearch;
+
+                mOpen.push_back (std::make_pair (cost + graph.getDistance (neighbour, end),
+                    neighbour));
+                std::push_heap (mOpen.begin(), mOpen.end(), Greater());
+            }
+        }
+
+        return false;
+    }
+
+
+    GraphCache::GraphPtr GraphCache::get (const ESM::Pathgrid& pathgrid)
+    {
+        Container::iterator iter = mGraphs.find (&pathgrid);
+
+        if (iter==mGraphs.end())
+            iter = mGraphs.insert (std::make_pair (&pathgrid, GraphPtr (new Graph (pathgrid)))).first;
+
+        return iter->second;
+    }
+
+    void GraphCache::erase (const ESM::Pathgrid *pathgrid)
+    {
+        mGraphs.erase (pathgrid);
+    }
+
+    void GraphCache::clear()
+    {
+        mGraphs.clear();
+    }
+
+    std::size_t GraphCache::size() const
+    {
+        return mGraphs.size();
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef COMPONENTS_PATHGRID_GRAPH_H
+#define COMPONENTS_PATHGRID_GRAPH_H
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "spatialindex.hpp"
+
+namespace ESM
+{
+    struct Pathgrid;
+}
+
+namespace Pathgrid
+{
+    /// \brief Compact adjacency structure of a path grid
+    ///
+    /// The neighbours of all points are stored in one array (compressed sparse rows), together
+    /// with the length of the connection. Path grid edges are treated as undirected. Positions
+    /// are in the coordinate system of the path grid (cell local for exterior cells). The points
+    /// are also put into a SpatialIndex.
+    ///
+    /// A graph is immutable once built and can be shared between threads.
+    class Graph
+    {
+            std::vector<float> mPositions; // x, y, z per point
+            std::vector<int> mOffsets; // first neighbour per point + end marker
+            std::vector<int> mNeighbours;
+            std::vector<float> mWeights; // same index as mNeighbours
+            SpatialIndex mIndex;
+
+            // not implemented
+            Graph (const Graph&);
+            Graph& operator= (const Graph&);
+
+            static std::vector<float> getPositions (const ESM::Pathgrid& pathgrid);
+
+        public:
+
+            Graph (const ESM::Pathgrid& pathgrid);
+
+            int getPointCount() const;
+
+            const float *getPosition (int point) const;
+            ///< x, y, z
+
+            int getNeighbourBegin (int point) const;
+            ///< Index of the first neighbour of \a point in getNeighbour/getWeight.
+
+            int getNeighbourEnd (int point) const;
+
+            int getNeighbour (int index) const;
+
+            float getWeight (int index) const;
+            ///< Distance to the neighbour with the same index.
+
+            float getDistance (int point1, int point2) const;
+            ///< Straight line distance between two points.
+
+            const SpatialIndex& getIndex() const;
+            ///< For nearest point and radius queries.
+    };
+
+    /// \brief A* search on a Graph
+    ///
+    /// Holds the per-point state of a search. Once the buffers have grown to the size of the
+    /// largest graph searched, searching does not allocate any more, so keep an instance around
+    /// instead of creating one per query. An instance must not be used by several threads at the
+    /// same time.
+    class Search
+    {
+            std::vector<float> mCost;
+            std::vector<int> mPredecessor;
+            std::vector<unsigned int> mReached; // search number, when the point has been reached
+            std::vector<unsigned int> mClosed; // search number, when the point has been expanded
+            std::vector<std::pair<float, int> > mOpen; // heap ordered by estimated total cost
+            unsigned int mSearch;
+
+            void prepare (int points);
+
+        public:
+
+            Search();
+
+            bool findPath (const Graph& graph, int start, int end, std::vector<int>& path);
+            ///< Find the shortest path from \a start to \a end (Euclidean distance heuristic).
+            ///
+            /// \param path Points of the path from \a start to \a end (both included). Cleared if
+            /// there is no path.
+            /// \return Has a path been found?
+    };
+
+    /// \brief Graphs of the path grids in use, built on first use
+    ///
+    /// Keyed on the address of the path grid record, so the record has to stay valid (and
+    /// unchanged), while its graph is cached.
+    class GraphCache
+    {
+        public:
+
+            typedef boost::shared_ptr<const Graph> GraphPtr;
+
+        private:
+
+            typedef std::map<const ESM::Pathgrid *, GraphPtr> Container;
+
+            Container mGraphs;
+
+        public:
+
+            GraphPtr get (const ESM::Pathgrid& pathgrid);
+
+            void erase (const ESM::Pathgrid *pathgrid);
+            ///< Drop the graph of \a pathgrid (e.g. when its cell is unloaded). Graphs still in
+            /// use elsewhere stay valid.
+
+            void clear();
+
+            std::size_t size() const;
+    };
+}
+
+#endif
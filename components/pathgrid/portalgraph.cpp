@@ -0,0 +1,545 @@
+#include "portalgraph.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    /// Only points this close to a cell border get a portal.
+    const float sBorderDistance = 1024;
+
+    /// Maximum distance between the linked points of a portal
+    const float sMaxPortalLength = 1536;
+
+    /// Minimum distance between the points of neighbouring portals on the same side of a border
+    const float sPortalSpacing = 512;
+
+    /// Heap order: smallest estimate on top.
+    struct Greater
+    {
+        bool operator() (const std::pair<float, int>& left, const std::pair<float, int>& right) const
+        {
+            return left.first>right.first;
+        }
+    };
+
+    float getDistance (const float *position1, const float *position2)
+    {
+        float x = position1[0] - position2[0];
+        float y = position1[1] - position2[1];
+        float z = position1[2] - position2[2];
+
+        return std::sqrt (x*x + y*y + z*z);
+    }
+
+    ESM::Pathgrid::Point makePoint (const float *position)
+    {
+        ESM::Pathgrid::Point point;
+        point.mX = static_cast<int> (position[0]);
+        point.mY = static_cast<int> (position[1]);
+        point.mZ = static_cast<int> (position[2]);
+        point.mAutogenerated = 0;
+        point.mConnectionNum = 0;
+        point.mUnknown = 0;
+        return point;
+    }
+
+    struct Candidate
+    {
+        float mLength;
+        int mPoint1;
+        int mPoint2;
+
+        bool operator< (const Candidate& candidate) const
+        {
+            return mLength<candidate.mLength;
+        }
+    };
+}
+
+namespace Pathgrid
+{
+    PortalGraph::PortalGraph (const Storage& storage, GraphCache& graphs, float cellSize, int margin,
+        std::size_t maxCachedPaths)
+    : mStorage (storage), mGraphs (graphs), mCellSize (cellSize), mMargin (margin),
+      mMaxCachedPaths (maxCachedPaths), mSearchNumber (0)
+    {}
+
+    GraphCache::GraphPtr PortalGraph::getGraph (const CellIndex& cell) const
+    {
+        const ESM::Pathgrid *pathgrid = mStorage.getExterior (cell.first, cell.second);
+
+        if (!pathgrid || pathgrid->mPoints.empty())
+            return GraphCache::GraphPtr();
+
+        return mGraphs.get (*pathgrid);
+    }
+
+    PortalGraph::CellIndex PortalGraph::getCell (float x, float y) const
+    {
+        return CellIndex (static_cast<int> (std::floor (x / mCellSize)),
+            static_cast<int> (std::floor (y / mCellSize)));
+    }
+
+    int PortalGraph::getNode (const CellIndex& cell, int point, const float *localPosition)
+    {
+        std::map<std::pair<CellIndex, int>, int>::const_iterator iter =
+            mNodeIds.find (std::make_pair (cell, point));
+
+        if (iter!=mNodeIds.end())
+            return iter->second;
+
+        int id = static_cast<int> (mNodes.size());
+
+        Node node;
+        node.mCell = cell;
+        node.mPoint = point;
+        node.mPosition[0] = localPosition[0] + cell.first * mCellSize;
+        node.mPosition[1] = localPosition[1] + cell.second * mCellSize;
+        node.mPosition[2] = localPosition[2];
+
+        mNodes.push_back (node);
+        mNodeIds.insert (std::make_pair (std::make_pair (cell, point), id));
+        mCells[cell].mNodes.push_back (id);
+
+        mCost.push_back (0);
+        mPredecessor.push_back (-1);
+        mReached.push_back (0);
+        mClosed.push_back (0);
+
+        return id;
+    }
+
+    void PortalGraph::linkBorder (const CellIndex& cell1, const CellIndex& cell2)
+    {
+        if (!mBorders.insert (std::make_pair (std::min (cell1, cell2), std::max (cell1, cell2))).second)
+            return;
+
+        GraphCache::GraphPtr graphs[2] = { getGraph (cell1), getGraph (cell2) };
+
+        if (!graphs[0] || !graphs[1])
+            return;
+
+        const CellIndex cells[2] = { cell1, cell2 };
+
+        // Link the points close to the border on either side to the nearest point on the other
+        // side. Shorter links are preferred, links too close to an existing one are dropped.
+        for (int side=0; side<2; ++side)
+        {
+            const Graph& graph = *graphs[side];
+            const Graph& other = *graphs[1-side];
+
+            int dx = cells[1-side].first - cells[side].first;
+            int dy = cells[1-side].second - cells[side].second;
+
+            std::vector<Candidate> candidates;
+
+            for (int point=0; point<graph.getPointCount(); ++point)
+            {
+                const float *position = graph.getPosition (point);
+
+                float distance = dx>0 ? mCellSize - position[0] : dx<0 ? position[0] :
+                    dy>0 ? mCellSize - position[1] : position[1];
+
+                if (distance>sBorderDistance)
+                    continue;
+
+                float otherPosition[3] =
+                {
+                    position[0] - dx * mCellSize, position[1] - dy * mCellSize, position[2]
+                };
+
+                Candidate candidate;
+                candidate.mPoint1 = point;
+                candidate.mPoint2 = other.getIndex().getClosestPoint (otherPosition[0],
+                    otherPosition[1], otherPosition[2]);
+                candidate.mLength = getDistance (otherPosition, other.getPosition (candidate.mPoint2));
+
+                if (candidate.mLength<=sMaxPortalLength)
+                    candidates.push_back (candidate);
+            }
+
+            std::sort (candidates.begin(), candidates.end());
+
+            std::vector<int> linked;
+
+            for (std::vector<Candidate>::const_iterator iter (candidates.begin());
+                iter!=candidates.end(); ++iter)
+            {
+                bool tooClose = false;
+
+                for (std::vector<int>::const_iterator iter2 (linked.begin());
+                    iter2!=linked.end() && !tooClose; ++iter2)
+                    tooClose = graph.getDistance (*iter2, iter->mPoint1)<sPortalSpacing;
+
+                if (tooClose)
+                    continue;
+
+                linked.push_back (iter->mPoint1);
+
+                int node1 = getNode (cells[side], iter->mPoint1, graph.getPosition (iter->mPoint1));
+                int node2 = getNode (cells[1-side], iter->mPoint2, other.getPosition (iter->mPoint2));
+
+                Edge edge;
+                edge.mCost = iter->mLength;
+
+                edge.mNode = node2;
+                mNodes[node1].mEdges.push_back (edge);
+
+                edge.mNode = node1;
+                mNodes[node2].mEdges.push_back (edge);
+            }
+        }
+    }
+
+    void PortalGraph::expand (const CellIndex& cell)
+    {
+        if (mCells[cell].mExpanded)
+            return;
+
+        mCells[cell].mExpanded = true;
+
+        linkBorder (cell, CellIndex (cell.first-1, cell.second));
+        linkBorder (cell, CellIndex (cell.first+1, cell.second));
+        linkBorder (cell, CellIndex (cell.first, cell.second-1));
+        linkBorder (cell, CellIndex (cell.first, cell.second+1));
+
+        GraphCache::GraphPtr graph = getGraph (cell);
+
+        if (!graph)
+            return;
+
+        // Nodes are not added to an expanded cell any more.
+        const std::vector<int>& nodes = mCells[cell].mNodes;
+
+        for (std::size_t i=0; i<nodes.size(); ++i)
+            for (std::size_t j=i+1; j<nodes.size(); ++j)
+            {
+                float cost = findCellPath (*graph, mNodes[nodes[i]].mPoint, mNodes[nodes[j]].mPoint);
+
+                if (cost<0)
+                    continue;
+
+                Edge edge;
+                edge.mCost = cost;
+
+                edge.mNode = nodes[j];
+                mNodes[nodes[i]].mEdges.push_back (edge);
+
+                edge.mNode = nodes[i];
+                mNodes[nodes[j]].mEdges.push_back (edge);
+            }
+    }
+
+    float PortalGraph::findCellPath (const Graph& graph, int start, int end)
+    {
+        if (!mSearch.findPath (graph, start, end, mPoints))
+            return -1;
+
+        float length = 0;
+
+        for (std::size_t i=1; i<mPoints.size(); ++i)
+            length += graph.getDistance (mPoints[i-1], mPoints[i]);
+
+        return length;
+    }
+
+    bool PortalGraph::findAbstractPath (const std::vector<std::pair<int, float> >& sources,
+        const std::map<int, float>& targets, const float *end,
+        const CellIndex& min, const CellIndex& max, std::vector<int>& nodes, float& cost)
+    {
+        if (++mSearchNumber==0)
+        {
+            // search numbers wrapped around
+            std::fill (mReached.begin(), mReached.end(), 0);
+            std::fill (mClosed.begin(), mClosed.end(), 0);
+            mSearchNumber = 1;
+        }
+
+        mOpen.clear();
+
+        for (std::vector<std::pair<int, float> >::const_iterator iter (sources.begin());
+            iter!=sources.end(); ++iter)
+        {
+            int node = iter->first;
+
+            if (mReached[node]==mSearchNumber && mCost[node]<=iter->second)
+                continue;
+
+            mCost[node] = iter->second;
+            mPredecessor[node] = -1;
+            mReached[node] = mSearchNumber;
+
+            mOpen.push_back (std::make_pair (iter->second + getDistance (mNodes[node].mPosition, end),
+                node));
+            std::push_heap (mOpen.begin(), mOpen.end(), Greater());
+        }
+
+        while (!mOpen.empty())
+        {
+            std::pair<float, int> entry = mOpen.front();
+            std::pop_heap (mOpen.begin(), mOpen.end(), Greater());
+            mOpen.pop_back();
+
+            // Negative entries stand for reaching the end point from the target node ~entry.
+            if (entry.second<0)
+            {
+                nodes.clear();
+
+                for (int node=~entry.second; node!=-1; node=mPredecessor[node])
+                    nodes.push_back (node);
+
+                std::reverse (nodes.begin(), nodes.end());
+                cost = entry.first;
+                return true;
+            }
+
+            int node = entry.second;
+
+            if (mClosed[node]==mSearchNumber)
+                continue;
+
+            mClosed[node] = mSearchNumber;
+
+            // copied, because expanding adds nodes
+            CellIndex cell = mNodes[node].mCell;
+            expand (cell);
+
+            std::map<int, float>::const_iterator target = targets.find (node);
+
+            if (target!=targets.end())
+            {
+                mOpen.push_back (std::make_pair (mCost[node] + target->second, ~node));
+                std::push_heap (mOpen.begin(), mOpen.end(), Greater());
+            }
+
+            for (std::size_t i=0; i<mNodes[node].mEdges.size(); ++i)
+            {
+                const Edge& edge = mNodes[node].mEdges[i];
+                const Node& neighbour = mNodes[edge.mNode];
+
+                if (neighbour.mCell.first<min.first || neighbour.mCell.first>max.first ||
+                    neighbour.mCell.second<min.second || neighbour.mCell.second>max.second)
+                    continue;
+
+                if (mClosed[edge.mNode]==mSearchNumber)
+                    continue;
+
+                float neighbourCost = mCost[node] + edge.mCost;
+
+                if (mReached[edge.mNode]==mSearchNumber && neighbourCost>=mCost[edge.mNode])
+                    continue;
+
+                mCost[edge.mNode] = neighbourCost;
+                mPredecessor[edge.mNode] = node;
+                mReached[edge.mNode] = mSearchNumber;
+
+                mOpen.push_back (std::make_pair (neighbourCost +
+                    getDistance (neighbour.mPosition, end), edge.mNode));
+                std::push_heap (mOpen.begin(), mOpen.end(), Greater());
+            }
+        }
+
+        return false;
+    }
+
+    void PortalGraph::cachePath (const std::vector<int>& nodes, float cost)
+    {
+        if (mMaxCachedPaths==0)
+            return;
+
+        std::pair<int, int> key (nodes.front(), nodes.back());
+
+        if (mPaths.find (key)==mPaths.end() && mPaths.size()>=mMaxCachedPaths)
+        {
+            PathCache::iterator leastUsed = mPaths.begin();
+
+            for (PathCache::iterator iter (mPaths.begin()); iter!=mPaths.end(); ++iter)
+                if (iter->second.mUses<leastUsed->second.mUses)
+                    leastUsed = iter;
+
+            mPaths.erase (leastUsed);
+
+            // give the remaining paths and the new one a similar chance
+            for (PathCache::iterator iter (mPaths.begin()); iter!=mPaths.end(); ++iter)
+                iter->second.mUses /= 2;
+        }
+
+        CachedPath& path = mPaths[key];
+        path.mNodes = nodes;
+        path.mCost = cost;
+        path.mUses = 1;
+    }
+
+    void PortalGraph::appendCellPath (const CellIndex& cell, int start, int end,
+        std::vector<ESM::Pathgrid::Point>& path)
+    {
+        GraphCache::GraphPtr graph = getGraph (cell);
+
+        if (!graph || !mSearch.findPath (*graph, start, end, mPoints))
+            return;
+
+        for (std::vector<int>::const_iterator iter (mPoints.begin()); iter!=mPoints.end(); ++iter)
+        {
+            const float *localPosition = graph->getPosition (*iter);
+
+            float position[3] =
+            {
+                localPosition[0] + cell.first * mCellSize,
+                localPosition[1] + cell.second * mCellSize,
+                localPosition[2]
+            };
+
+            ESM::Pathgrid::Point point = makePoint (position);
+
+            if (!path.empty() && path.back().mX==point.mX && path.back().mY==point.mY &&
+                path.back().mZ==point.mZ)
+                continue;
+
+            path.push_back (point);
+        }
+    }
+
+    bool PortalGraph::findPath (const float *start, const float *end,
+        std::vector<ESM::Pathgrid::Point>& path)
+    {
+        path.clear();
+
+        CellIndex startCell = getCell (start[0], start[1]);
+        CellIndex endCell = getCell (end[0], end[1]);
+
+        if (startCell==endCell)
+            return false;
+
+        GraphCache::GraphPtr startGraph = getGraph (startCell);
+        GraphCache::GraphPtr endGraph = getGraph (endCell);
+
+        if (!startGraph || !endGraph)
+            return false;
+
+        int startPoint = startGraph->getIndex().getClosestPoint (
+            start[0] - startCell.first * mCellSize, start[1] - startCell.second * mCellSize, start[2]);
+
+        int endPoint = endGraph->getIndex().getClosestPoint (
+            end[0] - endCell.first * mCellSize, end[1] - endCell.second * mCellSize, end[2]);
+
+        expand (startCell);
+        expand (endCell);
+
+        std::vector<std::pair<int, float> > sources;
+
+        const std::vector<int>& startNodes = mCells[startCell].mNodes;
+
+        for (std::vector<int>::const_iterator iter (startNodes.begin()); iter!=startNodes.end(); ++iter)
+        {
+            float cost = findCellPath (*startGraph, startPoint, mNodes[*iter].mPoint);
+
+            if (cost>=0)
+                sources.push_back (std::make_pair (*iter, cost));
+        }
+
+        std::map<int, float> targets;
+
+        const std::vector<int>& endNodes = mCells[endCell].mNodes;
+
+        for (std::vector<int>::const_iterator iter (endNodes.begin()); iter!=endNodes.end(); ++iter)
+        {
+            float cost = findCellPath (*endGraph, mNodes[*iter].mPoint, endPoint);
+
+            if (cost>=0)
+                targets.insert (std::make_pair (*iter, cost));
+        }
+
+        if (sources.empty() || targets.empty())
+            return false;
+
+        // Use the cheapest cached abstract path between the portals of the start and end cell.
+        CachedPath *cached = 0;
+        float cachedCost = 0;
+
+        for (std::vector<std::pair<int, float> >::const_iterator source (sources.begin());
+            source!=sources.end(); ++source)
+            for (std::map<int, float>::const_iterator target (targets.begin());
+                target!=targets.end(); ++target)
+            {
+                PathCache::iterator iter = mPaths.find (std::make_pair (source->first, target->first));
+
+                if (iter==mPaths.end())
+                    continue;
+
+                float cost = source->second + iter->second.mCost + target->second;
+
+                if (!cached || cost<cachedCost)
+                {
+                    cached = &iter->second;
+                    cachedCost = cost;
+                }
+            }
+
+        std::vector<int> nodes;
+
+        if (cached)
+        {
+            ++cached->mUses;
+            nodes = cached->mNodes;
+        }
+        else
+        {
+            CellIndex min (std::min (startCell.first, endCell.first) - mMargin,
+                std::min (startCell.second, endCell.second) - mMargin);
+            CellIndex max (std::max (startCell.first, endCell.first) + mMargin,
+                std::max (startCell.second, endCell.second) + mMargin);
+
+            float endPosition[3];
+            const float *localEnd = endGraph->getPosition (endPoint);
+            endPosition[0] = localEnd[0] + endCell.first * mCellSize;
+            endPosition[1] = localEnd[1] + endCell.second * mCellSize;
+            endPosition[2] = localEnd[2];
+
+            float cost = 0;
+
+            if (!findAbstractPath (sources, targets, endPosition, min, max, nodes, cost))
+                return false;
+
+            // only the part between the portals is independent of the start and end point
+            cachePath (nodes, cost - mCost[nodes.front()] - targets[nodes.back()]);
+        }
+
+        // Refine the abstract path: search the path grids of the traversed cells only.
+        appendCellPath (startCell, startPoint, mNodes[nodes.front()].mPoint, path);
+
+        for (std::size_t i=1; i<nodes.size(); ++i)
+        {
+            const Node& from = mNodes[nodes[i-1]];
+            const Node& to = mNodes[nodes[i]];
+
+            if (from.mCell==to.mCell)
+                appendCellPath (to.mCell, from.mPoint, to.mPoint, path);
+            else
+                path.push_back (makePoint (to.mPosition));
+        }
+
+        appendCellPath (endCell, mNodes[nodes.back()].mPoint, endPoint, path);
+
+        return !path.empty();
+    }
+
+    std::size_t PortalGraph::getCachedPathCount() const
+    {
+        return mPaths.size();
+    }
+
+    void PortalGraph::clear()
+    {
+        mNodes.clear();
+        mNodeIds.clear();
+        mCells.clear();
+        mBorders.clear();
+        mPaths.clear();
+
+        mCost.clear();
+        mPredecessor.clear();
+        mReached.clear();
+        mClosed.clear();
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef COMPONENTS_PATHGRID_PORTALGRAPH_H
+#define COMPONENTS_PATHGRID_PORTALGRAPH_H
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <components/esm/loadpgrd.hpp>
+
+#include "graph.hpp"
+
+namespace Pathgrid
+{
+    /// We keep access to the path grid records abstract here, so the portal graph can be used
+    /// without a game world.
+    class Storage
+    {
+        public:
+
+            virtual ~Storage() {}
+
+            virtual const ESM::Pathgrid *getExterior (int x, int y) const = 0;
+            ///< \return 0, if the cell has no path grid
+    };
+
+    /// \brief Paths across several exterior cells
+    ///
+    /// The path grids of neighbouring exterior cells are not connected. Points close to a cell
+    /// border are linked to the nearest point of the neighbouring path grid. These links are the
+    /// portals of the abstract graph; within a cell its portal points are connected by edges with
+    /// the length of the shortest path through the cell's path grid.
+    ///
+    /// Cells are added to the abstract graph on first use. A query searches the abstract graph
+    /// (within a margin around the start and end cell) and then searches the path grids of the
+    /// cells on the abstract path only. Abstract paths are cached per pair of start and end portal;
+    /// the least used ones are dropped, when the cache is full.
+    ///
+    /// Positions passed to and returned from the portal graph are in world coordinates.
+    class PortalGraph
+    {
+            typedef std::pair<int, int> CellIndex;
+
+            struct Edge
+            {
+                int mNode;
+                float mCost;
+            };
+
+            struct Node
+            {
+                CellIndex mCell;
+                int mPoint;
+                float mPosition[3]; ///< world coordinates
+                std::vector<Edge> mEdges;
+            };
+
+            struct Cell
+            {
+                std::vector<int> mNodes;
+                bool mExpanded; ///< all borders linked and edges between the portals added
+
+                Cell() : mExpanded (false) {}
+            };
+
+            struct CachedPath
+            {
+                std::vector<int> mNodes;
+                float mCost;
+                unsigned int mUses;
+            };
+
+            typedef std::map<CellIndex, Cell> CellMap;
+            typedef std::map<std::pair<int, int>, CachedPath> PathCache;
+
+            const Storage& mStorage;
+            GraphCache& mGraphs;
+            float mCellSize;
+            int mMargin;
+            std::size_t mMaxCachedPaths;
+
+            std::vector<Node> mNodes;
+            std::map<std::pair<CellIndex, int>, int> mNodeIds; // cell and point -> node
+            CellMap mCells;
+            std::set<std::pair<CellIndex, CellIndex> > mBorders; // linked already
+            PathCache mPaths;
+
+            // search state (reused between queries)
+            Search mSearch;
+            std::vector<int> mPoints;
+            std::vector<float> mCost;
+            std::vector<int> mPredecessor;
+            std::vector<unsigned int> mReached;
+            std::vector<unsigned int> mClosed;
+            std::vector<std::pair<float, int> > mOpen;
+            unsigned int mSearchNumber;
+
+            // not implemented
+            PortalGraph (const PortalGraph&);
+            PortalGraph& operator= (const PortalGraph&);
+
+            GraphCache::GraphPtr getGraph (const CellIndex& cell) const;
+
+            CellIndex getCell (float x, float y) const;
+
+            int getNode (const CellIndex& cell, int point, const float *localPosition);
+
+            void linkBorder (const CellIndex& cell1, const CellIndex& cell2);
+
+            void expand (const CellIndex& cell);
+
+            float findCellPath (const Graph& graph, int start, int end);
+            ///< \return length of the shortest path between two points of a cell (-1: none)
+
+            bool findAbstractPath (const std::vector<std::pair<int, float> >& sources,
+                const std::map<int, float>& targets, const float *end,
+                const CellIndex& min, const CellIndex& max, std::vector<int>& nodes, float& cost);
+
+            void cachePath (const std::vector<int>& nodes, float cost);
+
+            void appendCellPath (const CellIndex& cell, int start, int end,
+                std::vector<ESM::Pathgrid::Point>& path);
+
+        public:
+
+            PortalGraph (const Storage& storage, GraphCache& graphs, float cellSize, int margin = 2,
+                std::size_t maxCachedPaths = 256);
+            ///< \param margin Number of cells around the start and end cell considered in searches
+
+            bool findPath (const float *start, const float *end,
+                std::vector<ESM::Pathgrid::Point>& path);
+            ///< Find a path between two positions in different exterior cells.
+            ///
+            /// \param path Points from the path grid point closest to \a start to the one closest
+            /// to \a end.
+            /// \return false, if both positions are in the same cell or no path has been found.
+
+            std::size_t getCachedPathCount() const;
+
+            void clear();
+            ///< Discard the abstract graph and all cached paths.
+    };
+}
+
+#endif
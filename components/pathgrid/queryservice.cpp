@@ -0,0 +1,241 @@
+#include "queryservice.hpp"
+
+#include <boost/bind.hpp>
+
+namespace
+{
+    /// Number of updates a handed over result is kept for
+    const unsigned int sMaxResultAge = 300;
+}
+
+namespace Pathgrid
+{
+    QueryService::QueryService (int resultsPerUpdate)
+    : mResultsPerUpdate (resultsPerUpdate), mNextId (0), mUpdates (0), mActive (0),
+      mActiveCancelled (false), mQuit (false)
+    {
+        mThread = boost::thread (boost::bind (&QueryService::work, this));
+    }
+
+    QueryService::~QueryService()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock (mMutex);
+            mQuit = true;
+        }
+
+        mRequestAdded.notify_all();
+        mThread.join();
+    }
+
+    void QueryService::work()
+    {
+        while (true)
+        {
+            Request request;
+
+            {
+                boost::unique_lock<boost::mutex> lock (mMutex);
+
+                while (mRequests.empty() && !mQuit)
+                    mRequestAdded.wait (lock);
+
+                if (mQuit)
+                    return;
+
+                request = mRequests.front();
+                mRequests.pop_front();
+
+                mActive = request.mId;
+                mActiveCancelled = false;
+            }
+
+            Result result;
+            result.mId = request.mId;
+            result.mDelivered = 0;
+
+            solve (request, result);
+
+            boost::lock_guard<boost::mutex> lock (mMutex);
+
+            if (!mActiveCancelled)
+                mResults.push_back (result);
+
+            mActive = 0;
+        }
+    }
+
+    void QueryService::solve (const Request& request, Result& result)
+    {
+        const Graph& graph = *request.mGraph;
+        const SpatialIndex& index = graph.getIndex();
+
+        int start = index.getClosestPoint (request.mStart[0] - request.mOffset[0],
+            request.mStart[1] - request.mOffset[1], request.mStart[2]);
+
+        int goal = index.getClosestPoint (request.mGoal[0] - request.mOffset[0],
+            request.mGoal[1] - request.mOffset[1], request.mGoal[2]);
+
+        result.mFound = mSearch.findPath (graph, start, goal, mPoints);
+
+        if (!result.mFound)
+            return;
+
+        result.mPath.reserve (mPoints.size());
+
+        for (std::vector<int>::const_iterator iter (mPoints.begin()); iter!=mPoints.end(); ++iter)
+        {
+            const float *position = graph.getPosition (*iter);
+
+            ESM::Pathgrid::Point point;
+            point.mX = static_cast<int> (position[0] + request.mOffset[0]);
+            point.mY = static_cast<int> (position[1] + request.mOffset[1]);
+            point.mZ = static_cast<int> (position[2]);
+            point.mAutogenerated = 0;
+            point.mConnectionNum = 0;
+            point.mUnknown = 0;
+
+            result.mPath.push_back (point);
+        }
+    }
+
+    QueryService::RequestId QueryService::submit (const GraphCache::GraphPtr& graph, float xOffset,
+        float yOffset, const float *start, const float *goal)
+    {
+        if (++mNextId==0)
+            ++mNextId;
+
+        Request request;
+        request.mId = mNextId;
+        request.mGraph = graph;
+        request.mOffset[0] = xOffset;
+        request.mOffset[1] = yOffset;
+
+        for (int i=0; i<3; ++i)
+        {
+            request.mStart[i] = start[i];
+            request.mGoal[i] = goal[i];
+        }
+
+        mOutstanding.insert (request.mId);
+
+        {
+            boost::lock_guard<boost::mutex> lock (mMutex);
+            mRequests.push_back (request);
+        }
+
+        mRequestAdded.notify_one();
+
+        return request.mId;
+    }
+
+    void QueryService::cancel (RequestId id)
+    {
+        if (id==0)
+            return;
+
+        mDelivered.erase (id);
+
+        if (!mOutstanding.erase (id))
+            return;
+
+        boost::lock_guard<boost::mutex> lock (mMutex);
+
+        if (mActive==id)
+        {
+            mActiveCancelled = true;
+            return;
+        }
+
+        for (std::deque<Request>::iterator iter (mRequests.begin()); iter!=mRequests.end(); ++iter)
+            if (iter->mId==id)
+            {
+                mRequests.erase (iter);
+                return;
+            }
+
+        for (std::deque<Result>::iterator iter (mResults.begin()); iter!=mResults.end(); ++iter)
+            if (iter->mId==id)
+            {
+                mResults.erase (iter);
+                return;
+            }
+    }
+
+    void QueryService::update()
+    {
+        ++mUpdates;
+
+        for (std::map<RequestId, Result>::iterator iter (mDelivered.begin()); iter!=mDelivered.end();)
+        {
+            if (mUpdates-iter->second.mDelivered>sMaxResultAge)
+                mDelivered.erase (iter++);
+            else
+                ++iter;
+        }
+
+        std::deque<Result> results;
+
+        {
+            boost::lock_guard<boost::mutex> lock (mMutex);
+
+            while (!mResults.empty() &&
+                (mResultsPerUpdate<=0 || static_cast<int> (results.size())<mResultsPerUpdate))
+            {
+                results.push_back (Result());
+                results.back().mId = mResults.front().mId;
+                results.back().mFound = mResults.front().mFound;
+                results.back().mPath.swap (mResults.front().mPath);
+                mResults.pop_front();
+            }
+        }
+
+        for (std::deque<Result>::iterator iter (results.begin()); iter!=results.end(); ++iter)
+        {
+            mOutstanding.erase (iter->mId);
+
+            Result& result = mDelivered[iter->mId];
+            result.mId = iter->mId;
+            result.mFound = iter->mFound;
+            result.mPath.swap (iter->mPath);
+            result.mDelivered = mUpdates;
+        }
+    }
+
+    QueryService::Status QueryService::getResult (RequestId id, std::vector<ESM::Pathgrid::Point>& path)
+    {
+        std::map<RequestId, Result>::iterator iter = mDelivered.find (id);
+
+        if (iter==mDelivered.end())
+            return mOutstanding.count (id) ? Status_Pending : Status_Unknown;
+
+        Status status = iter->second.mFound ? Status_Found : Status_NotFound;
+        path.swap (iter->second.mPath);
+        mDelivered.erase (iter);
+
+        return status;
+    }
+
+    int QueryService::getQueueDepth()
+    {
+        boost::lock_guard<boost::mutex> lock (mMutex);
+        return static_cast<int> (mRequests.size()) + (mActive ? 1 : 0);
+    }
+
+    int QueryService::getWaitingResults()
+    {
+        boost::lock_guard<boost::mutex> lock (mMutex);
+        return static_cast<int> (mResults.size());
+    }
+
+    void QueryService::clear()
+    {
+        mOutstanding.clear();
+        mDelivered.clear();
+
+        boost::lock_guard<boost::mutex> lock (mMutex);
+        mRequests.clear();
+        mResults.clear();
+        mActiveCancelled = true;
+    }
+}
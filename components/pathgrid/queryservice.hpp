@@ -0,0 +1,121 @@
+#ifndef COMPONENTS_PATHGRID_QUERYSERVICE_H
+#define COMPONENTS_PATHGRID_QUERYSERVICE_H
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <components/esm/loadpgrd.hpp>
+
+#include "graph.hpp"
+
+namespace Pathgrid
+{
+    /// \brief Finds paths on a worker thread
+    ///
+    /// Requests carry the graph of the path grid to search. Graphs are immutable, so the worker
+    /// never touches anything the main thread may change. Finished paths are handed over by
+    /// update(), at most the given number per call, and can then be picked up by their request
+    /// id. Results that nobody picks up are dropped after a while.
+    ///
+    /// All functions except the worker itself have to be called from the same (main) thread.
+    class QueryService
+    {
+        public:
+
+            typedef unsigned int RequestId; ///< 0: no request
+
+            enum Status
+            {
+                Status_Pending,
+                Status_Found,
+                Status_NotFound,
+                Status_Unknown ///< never submitted, cancelled, picked up already or expired
+            };
+
+        private:
+
+            struct Request
+            {
+                RequestId mId;
+                GraphCache::GraphPtr mGraph;
+                float mOffset[2]; ///< of the path grid coordinates
+                float mStart[3];
+                float mGoal[3];
+            };
+
+            struct Result
+            {
+                RequestId mId;
+                bool mFound;
+                std::vector<ESM::Pathgrid::Point> mPath;
+                unsigned int mDelivered; ///< update count at hand-over
+            };
+
+            int mResultsPerUpdate;
+            RequestId mNextId;
+            unsigned int mUpdates;
+            std::set<RequestId> mOutstanding; // submitted, not yet delivered
+            std::map<RequestId, Result> mDelivered;
+
+            // only used by the worker thread
+            Search mSearch;
+            std::vector<int> mPoints;
+
+            boost::mutex mMutex;
+            boost::condition_variable mRequestAdded;
+            std::deque<Request> mRequests;
+            std::deque<Result> mResults;
+            RequestId mActive; ///< being solved by the worker
+            bool mActiveCancelled;
+            bool mQuit;
+            boost::thread mThread;
+
+            // not implemented
+            QueryService (const QueryService&);
+            QueryService& operator= (const QueryService&);
+
+            // boost::thread entry point
+            void work();
+
+            void solve (const Request& request, Result& result);
+
+        public:
+
+            QueryService (int resultsPerUpdate);
+            ///< \param resultsPerUpdate 0: no limit
+
+            ~QueryService();
+
+            RequestId submit (const GraphCache::GraphPtr& graph, float xOffset, float yOffset,
+                const float *start, const float *goal);
+            ///< Request a path between the path grid points closest to \a start and \a goal.
+            /// \param xOffset, yOffset Offset of the path grid coordinates (exterior cells)
+
+            void cancel (RequestId id);
+            ///< Discard the request and its result (if any).
+
+            void update();
+            ///< Hand over finished paths (call once per frame).
+
+            Status getResult (RequestId id, std::vector<ESM::Pathgrid::Point>& path);
+            ///< If the path has been handed over, move it to \a path (points in world coordinates).
+            /// The result can be picked up only once.
+
+            int getQueueDepth();
+            ///< Number of requests that are queued or being solved.
+
+            int getWaitingResults();
+            ///< Number of finished paths not handed over yet (because of the limit per update).
+
+            void clear();
+            ///< Discard all requests and results.
+    };
+}
+
+#endif
@@ -0,0 +1,186 @@
+#include "spatialindex.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const float sMinBucketSize = 64;
+    const int sMaxBuckets = 256; // per axis
+}
+
+namespace Pathgrid
+{
+    SpatialIndex::SpatialIndex (const std::vector<float>& positions)
+    : mPositions (positions), mOriginX (0), mOriginY (0), mBucketSize (sMinBucketSize), mWidth (1),
+      mHeight (1)
+    {
+        int points = static_cast<int> (mPositions.size()/3);
+
+        if (points>0)
+        {
+            float minX = mPositions[0];
+            float maxX = minX;
+            float minY = mPositions[1];
+            float maxY = minY;
+
+            for (int i=1; i<points; ++i)
+            {
+                minX = std::min (minX, mPositions[i*3]);
+                maxX = std::max (maxX, mPositions[i*3]);
+                minY = std::min (minY, mPositions[i*3+1]);
+                maxY = std::max (maxY, mPositions[i*3+1]);
+            }
+
+            float width = maxX - minX;
+            float height = maxY - minY;
+
+            mOriginX = minX;
+            mOriginY = minY;
+            mBucketSize = std::max (sMinBucketSize,
+                std::sqrt (width * height / std::max (points/2, 1)));
+
+            // long and narrow path grids
+            mBucketSize = std::max (mBucketSize, std::max (width, height) / (sMaxBuckets-1));
+
+            mWidth = std::min (static_cast<int> (width / mBucketSize) + 1, sMaxBuckets);
+            mHeight = std::min (static_cast<int> (height / mBucketSize) + 1, sMaxBuckets);
+        }
+
+        std::vector<int> buckets (points);
+        mOffsets.resize (mWidth*mHeight+1, 0);
+
+        for (int i=0; i<points; ++i)
+        {
+            buckets[i] = getBucketY (mPositions[i*3+1]) * mWidth + getBucketX (mPositions[i*3]);
+            ++mOffsets[buckets[i]+1];
+        }
+
+        for (int i=0; i<mWidth*mHeight; ++i)
+            mOffsets[i+1] += mOffsets[i];
+
+        // Points of each bucket stay in ascending order.
+        std::vector<int> next (mOffsets.begin(), mOffsets.end()-1);
+        mPoints.resize (points);
+
+        for (int i=0; i<points; ++i)
+            mPoints[next[buckets[i]]++] = i;
+    }
+
+    float SpatialIndex::getSquaredDistance (int point, float x, float y, float z) const
+    {
+        x -= mPositions[point*3];
+        y -= mPositions[point*3+1];
+        z -= mPositions[point*3+2];
+
+        return x*x + y*y + z*z;
+    }
+
+    int SpatialIndex::getBucketX (float x) const
+    {
+        return std::max (0, std::min (static_cast<int> (std::floor ((x - mOriginX) / mBucketSize)),
+            mWidth-1));
+    }
+
+    int SpatialIndex::getBucketY (float y) const
+    {
+        return std::max (0, std::min (static_cast<int> (std::floor ((y - mOriginY) / mBucketSize)),
+            mHeight-1));
+    }
+
+    int SpatialIndex::getClosestPoint (float x, float y, float z) const
+    {
+        if (mPoints.empty())
+            return -1;
+
+        int centreX = getBucketX (x);
+        int centreY = getBucketY (y);
+
+        // All points lie within the area covered by the buckets, so distances measured from the
+        // query position clamped to that area are lower bounds for the real distances.
+        float clampedX = std::max (mOriginX, std::min (x, mOriginX + mWidth * mBucketSize));
+        float clampedY = std::max (mOriginY, std::min (y, mOriginY + mHeight * mBucketSize));
+
+        int closest = -1;
+        float closestDistance = 0;
+
+        int maxRing = std::max (mWidth, mHeight);
+
+        for (int ring=0; ring<=maxRing; ++ring)
+        {
+            if (closest!=-1 && ring>0)
+            {
+                // distance to the nearest bucket of this ring
+                float bound = std::min (
+                    std::min (clampedX - (mOriginX + (centreX-ring+1) * mBucketSize),
+                        mOriginX + (centreX+ring) * mBucketSize - clampedX),
+                    std::min (clampedY - (mOriginY + (centreY-ring+1) * mBucketSize),
+                        mOriginY + (centreY+ring) * mBucketSize - clampedY));
+
+                if (bound>0 && bound*bound>closestDistance)
+                    break;
+            }
+
+            for (int bucketY=centreY-ring; bucketY<=centreY+ring; ++bucketY)
+            {
+                if (bucketY<0 || bucketY>=mHeight)
+                    continue;
+
+                // inner buckets have been searched already
+                bool edge = bucketY==centreY-ring || bucketY==centreY+ring;
+                int step = edge || ring==0 ? 1 : 2*ring;
+
+                for (int bucketX=centreX-ring; bucketX<=centreX+ring; bucketX+=step)
+                {
+                    if (bucketX<0 || bucketX>=mWidth)
+                        continue;
+
+                    int bucket = bucketY * mWidth + bucketX;
+
+                    for (int i=mOffsets[bucket]; i<mOffsets[bucket+1]; ++i)
+                    {
+                        int point = mPoints[i];
+                        float distance = getSquaredDistance (point, x, y, z);
+
+                        if (closest==-1 || distance<closestDistance ||
+                            (distance==closestDistance && point<closest))
+                        {
+                            closest = point;
+                            closestDistance = distance;
+                        }
+                    }
+                }
+            }
+        }
+
+        return closest;
+    }
+
+    void SpatialIndex::getPointsInRadius (float x, float y, float z, float radius,
+        std::vector<int>& points) const
+    {
+        points.clear();
+
+        if (mPoints.empty() || radius<0)
+            return;
+
+        int minX = getBucketX (x - radius);
+        int maxX = getBucketX (x + radius);
+        int minY = getBucketY (y - radius);
+        int maxY = getBucketY (y + radius);
+
+        float squaredRadius = radius * radius;
+
+        for (int bucketY=minY; bucketY<=maxY; ++bucketY)
+            for (int bucketX=minX; bucketX<=maxX; ++bucketX)
+            {
+                int bucket = bucketY * mWidth + bucketX;
+
+                for (int i=mOffsets[bucket]; i<mOffsets[bucket+1]; ++i)
+                    if (getSquaredDistance (mPoints[i], x, y, z)<=squaredRadius)
+                        points.push_back (mPoints[i]);
+            }
+
+        std::sort (points.begin(), points.end());
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef COMPONENTS_PATHGRID_SPATIALINDEX_H
+#define COMPONENTS_PATHGRID_SPATIALINDEX_H
+
+#include <vector>
+
+namespace Pathgrid
+{
+    /// \brief Uniform grid over the x/y positions of a set of points
+    ///
+    /// The bucket size is chosen so that a bucket holds about two points on average. Nearest
+    /// point queries search outwards from the query position and stop as soon as no closer point
+    /// can exist; radius queries only look at the buckets overlapping the radius.
+    class SpatialIndex
+    {
+            const std::vector<float>& mPositions; // x, y, z per point
+            float mOriginX;
+            float mOriginY;
+            float mBucketSize;
+            int mWidth; // in buckets
+            int mHeight;
+            std::vector<int> mOffsets; // first point per bucket + end marker
+            std::vector<int> mPoints; // point indices, sorted by bucket
+
+            float getSquaredDistance (int point, float x, float y, float z) const;
+
+            int getBucketX (float x) const;
+
+            int getBucketY (float y) const;
+
+        public:
+
+            SpatialIndex (const std::vector<float>& positions);
+            ///< \param positions x, y, z per point (must stay valid and unchanged while the index
+            /// is in use)
+
+            int getClosestPoint (float x, float y, float z) const;
+            ///< \return index of the closest point (the lowest index among equally close points)
+            /// or -1, if there are no points.
+
+            void getPointsInRadius (float x, float y, float z, float radius,
+                std::vector<int>& points) const;
+            ///< Replace the content of \a points with the indices of all points within \a radius
+            /// (in ascending order).
+    };
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "frameprofiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace Profiling
+{
+    FrameProfiler::FrameProfiler()
+    : mEpoch (boost::posix_time::microsec_clock::universal_time()), mFrames (History),
+      mFrameNumber (0), mTraceEmpty (true), mEnabled (false)
+    {
+        for (int i=0; i<MaxPhases; ++i)
+            mPhaseStart[i] = -1;
+    }
+
+    FrameProfiler::~FrameProfiler()
+    {
+        stopTrace();
+    }
+
+    void FrameProfiler::setEnabled (bool enabled)
+    {
+        mEnabled = enabled;
+    }
+
+    bool FrameProfiler::isEnabled() const
+    {
+        return mEnabled || mTrace.is_open();
+    }
+
+    boost::int64_t FrameProfiler::now() const
+    {
+        return (boost::posix_time::microsec_clock::universal_time()-mEpoch).total_microseconds();
+    }
+
+    void FrameProfiler::writeTraceEvent (const std::string& name, boost::int64_t start,
+        boost::int64_t duration)
+    {
+        mTrace
+            << (mTraceEmpty ? "" : ",\n")
+            << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"ts\":" << start << ",\"dur\":" << duration
+            << ",\"pid\":1,\"tid\":1}";
+
+        mTraceEmpty = false;
+    }
+
+    void FrameProfiler::writeTraceCounter (const std::string& name, boost::int64_t value)
+    {
+        mTrace
+            << (mTraceEmpty ? "" : ",\n")
+            << "{\"name\":\"" << name << "\",\"ph\":\"C\",\"ts\":" << now()
+            << ",\"pid\":1,\"args\":{\"value\":" << value << "}}";
+
+        mTraceEmpty = false;
+    }
+
+    void FrameProfiler::finishFrame()
+    {
+        if (!mFrameNumber)
+            return;
+
+        Frame& frame = mFrames[(mFrameNumber-1) % History];
+        frame.mDuration = now()-frame.mStart;
+
+        if (mTrace.is_open())
+            writeTraceEvent ("Frame", frame.mStart, frame.mDuration);
+    }
+
+    int FrameProfiler::getPhase (const char *name)
+    {
+        for (std::size_t i=0; i<mPhaseNames.size(); ++i)
+            if (mPhaseNames[i]==name)
+                return static_cast<int> (i);
+
+        if (mPhaseNames.size()>=MaxPhases)
+            return -1;
+
+        mPhaseNames.push_back (name);
+        return static_cast<int> (mPhaseNames.size())-1;
+    }
+
+    int FrameProfiler::getPhaseCount() const
+    {
+        return static_cast<int> (mPhaseNames.size());
+    }
+
+    const std::string& FrameProfiler::getPhaseName (int phase) const
+    {
+        return mPhaseNames.at (phase);
+    }
+
+    int FrameProfiler::getCounter (const char *name)
+    {
+        for (std::size_t i=0; i<mCounterNames.size(); ++i)
+            if (mCounterNames[i]==name)
+                return static_cast<int> (i);
+
+        if (mCounterNames.size()>=MaxCounters)
+            return -1;
+
+        mCounterNames.push_back (name);
+        return static_cast<int> (mCounterNames.size())-1;
+    }
+
+    int FrameProfiler::getCounterCount() const
+    {
+        return static_cast<int> (mCounterNames.size());
+    }
+
+    const std::string& FrameProfiler::getCounterName (int counter) const
+    {
+        return mCounterNames.at (counter);
+    }
+
+    void FrameProfiler::setCounter (int counter, boost::int64_t value)
+    {
+        assert (counter>=0 && counter<MaxCounters);
+
+        if (mFrameNumber)
+            mFrames[(mFrameNumber-1) % History].mCounters[counter] = value;
+
+        if (mTrace.is_open())
+            writeTraceCounter (mCounterNames[counter], value);
+    }
+
+    void FrameProfiler::beginFrame()
+    {
+        finishFrame();
+
+        Frame& frame = mFrames[mFrameNumber % History];
+        frame.mStart = now();
+        frame.mDuration = 0;
+
+        for (int i=0; i<MaxPhases; ++i)
+            frame.mPhases[i] = 0;
+
+        for (int i=0; i<MaxCounters; ++i)
+            frame.mCounters[i] = 0;
+
+        ++mFrameNumber;
+    }
+
+    void FrameProfiler::beginPhase (int phase)
+    {
+        assert (phase>=0 && phase<MaxPhases);
+        mPhaseStart[phase] = now();
+    }
+
+    void FrameProfiler::endPhase (int phase)
+    {
+        assert (phase>=0 && phase<MaxPhases);
+
+        if (mPhaseStart[phase]==-1)
+            return;
+
+        boost::int64_t duration = now()-mPhaseStart[phase];
+
+        if (mFrameNumber)
+            mFrames[(mFrameNumber-1) % History].mPhases[phase] += duration;
+
+        if (mTrace.is_open())
+            writeTraceEvent (mPhaseNames[phase], mPhaseStart[phase], duration);
+
+        mPhaseStart[phase] = -1;
+    }
+
+    unsigned int FrameProfiler::getFrameNumber() const
+    {
+        return mFrameNumber;
+    }
+
+    unsigned int FrameProfiler::getFrameCount() const
+    {
+        if (!mFrameNumber)
+            return 0;
+
+        return std::min (mFrameNumber-1, static_cast<unsigned int> (History)-1);
+    }
+
+    const FrameProfiler::Frame& FrameProfiler::getFrame (unsigned int age) const
+    {
+        assert (age<getFrameCount());
+        return mFrames[(mFrameNumber-2-age) % History];
+    }
+
+    bool FrameProfiler::startTrace (const std::string& file)
+    {
+        stopTrace();
+
+        mTrace.open (file.c_str());
+
+        if (!mTrace.is_open())
+        {
+            std::cerr << "Failed to open frame trace " << file << std::endl;
+            return false;
+        }
+
+        mTrace << "{\"traceEvents\":[\n";
+        mTraceEmpty = true;
+        return true;
+    }
+
+    void FrameProfiler::stopTrace()
+    {
+        if (mTrace.is_open())
+        {
+            mTrace << "\n]}\n";
+            mTrace.close();
+        }
+    }
+}
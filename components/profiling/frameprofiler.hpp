@@ -0,0 +1,175 @@
+#ifndef COMPONENTS_PROFILING_FRAMEPROFILER_H
+#define COMPONENTS_PROFILING_FRAMEPROFILER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace Profiling
+{
+    /// \brief Time spent in the phases of the most recent frames
+    ///
+    /// Phases are identified by name and get an index on first use. If a phase is entered several
+    /// times during one frame, the durations are added up. Optionally every phase is also written
+    /// to a trace file in the Chrome trace event format (chrome://tracing).
+    ///
+    /// Counters (e.g. queue lengths) are registered the same way and keep the last value set during
+    /// a frame.
+    ///
+    /// Phases are only timed while the profiler is enabled or a trace is written.
+    class FrameProfiler
+    {
+        public:
+
+            enum
+            {
+                MaxPhases = 16,
+                MaxCounters = 8,
+                History = 300 ///< number of frames kept, including the one in progress
+            };
+
+            struct Frame
+            {
+                boost::int64_t mStart; ///< microseconds since the profiler has been created
+                boost::int64_t mDuration; ///< microseconds
+                boost::int64_t mPhases[MaxPhases]; ///< microseconds spent in each phase
+                boost::int64_t mCounters[MaxCounters];
+            };
+
+        private:
+
+            boost::posix_time::ptime mEpoch;
+            std::vector<std::string> mPhaseNames;
+            std::vector<std::string> mCounterNames;
+            std::vector<Frame> mFrames; // ring buffer
+            unsigned int mFrameNumber; // number of started frames
+            boost::int64_t mPhaseStart[MaxPhases];
+            std::ofstream mTrace;
+            bool mTraceEmpty;
+            bool mEnabled;
+
+            // not implemented
+            FrameProfiler (const FrameProfiler&);
+            FrameProfiler& operator= (const FrameProfiler&);
+
+            boost::int64_t now() const;
+
+            void writeTraceEvent (const std::string& name, boost::int64_t start,
+                boost::int64_t duration);
+
+            void writeTraceCounter (const std::string& name, boost::int64_t value);
+
+            void finishFrame();
+
+        public:
+
+            FrameProfiler();
+
+            ~FrameProfiler();
+
+            void setEnabled (bool enabled);
+            ///< Time phases even if no trace is written (e.g. for displaying the timings)?
+
+            bool isEnabled() const;
+            ///< Are phases timed (enabled or writing a trace)?
+
+            int getPhase (const char *name);
+            ///< Return index of the phase \a name (registered on first use).
+            /// \return -1, if there are already MaxPhases other phases
+
+            int getPhaseCount() const;
+
+            const std::string& getPhaseName (int phase) const;
+
+            int getCounter (const char *name);
+            ///< Return index of the counter \a name (registered on first use).
+            /// \return -1, if there are already MaxCounters other counters
+
+            int getCounterCount() const;
+
+            const std::string& getCounterName (int counter) const;
+
+            void setCounter (int counter, boost::int64_t value);
+
+            void beginFrame();
+            ///< Finish the current frame (if any) and start the next one.
+
+            void beginPhase (int phase);
+
+            void endPhase (int phase);
+
+            unsigned int getFrameNumber() const;
+            ///< Number of frames started so far.
+
+            unsigned int getFrameCount() const;
+            ///< Number of finished frames that are available (at most History-1).
+
+            const Frame& getFrame (unsigned int age) const;
+            ///< \param age 0: most recently finished frame, must be less than getFrameCount()
+
+            bool startTrace (const std::string& file);
+            ///< Write all following frames and phases to \a file.
+            /// \return Could the file be opened?
+
+            void stopTrace();
+    };
+
+    /// \brief Name of a phase together with its index, which is looked up on first use
+    ///
+    /// Meant to be a static at the call site, so that the name is compared only once. The index is
+    /// only valid for the profiler it has been looked up with.
+    class Phase
+    {
+            const char *mName;
+            int mIndex; // -2: not looked up yet
+
+        public:
+
+            explicit Phase (const char *name) : mName (name), mIndex (-2) {}
+
+            int getIndex (FrameProfiler& profiler)
+            {
+                if (mIndex==-2)
+                    mIndex = profiler.getPhase (mName);
+
+                return mIndex;
+            }
+    };
+
+    /// \brief Time a phase from construction until destruction
+    class ScopedTimer
+    {
+            FrameProfiler *mProfiler;
+            int mPhase;
+
+            // not implemented
+            ScopedTimer (const ScopedTimer&);
+            ScopedTimer& operator= (const ScopedTimer&);
+
+        public:
+
+            ScopedTimer (FrameProfiler *profiler, Phase& phase)
+            : mProfiler (profiler), mPhase (-1)
+            {
+                if (mProfiler && mProfiler->isEnabled())
+                {
+                    mPhase = phase.getIndex (*mProfiler);
+
+                    if (mPhase!=-1)
+                        mProfiler->beginPhase (mPhase);
+                }
+            }
+            ///< \param profiler 0: do not time anything
+
+            ~ScopedTimer()
+            {
+                if (mPhase!=-1)
+                    mProfiler->endPhase (mPhase);
+            }
+    };
+}
+
+#endif
@@ -44,6 +44,7 @@
 using namespace ToUTF8;
 
 Utf8Encoder::Utf8Encoder(const FromType sourceEncoding):
+    mEncoding(sourceEncoding),
     mOutput(50*1024)
 {
     switch (sourceEncoding)
@@ -34,6 +34,11 @@ namespace ToUTF8
                 return getUtf8(str.c_str(), str.size());
             }
 
+            FromType getEncoding() const
+            {
+                return mEncoding;
+            }
+
             std::string getLegacyEnc(const char *input, size_t size);
             inline std::string getLegacyEnc(const std::string &str)
             {
@@ -47,6 +52,7 @@ namespace ToUTF8
             size_t getLength2(const char* input, bool &ascii);
             void copyFromArray2(const char*& chp, char* &out);
 
+            FromType mEncoding;
             std::vector<char> mOutput;
             signed char* translationArray;
     };
@@ -13,6 +13,8 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
 
+#include <cassert>
+
 namespace OEngine {
 namespace Physic
 {
@@ -46,6 +48,7 @@ namespace Physic
     void PhysicActor::enableCollisions(bool collision)
     {
         assert(mBody);
+        assert(!mEngine->isLocked());
         if(collision && !mCollisionMode) enableCollisionBody();
         if(!collision && mCollisionMode) disableCollisionBody();
         mCollisionMode = collision;
@@ -170,6 +173,7 @@ namespace Physic
     PhysicEngine::PhysicEngine(BulletShapeLoader* shapeLoader) :
         mDebugActive(0)
       , mSceneMgr(NULL)
+      , mLocked(false)
     {
         // Set up the collision configuration and dispatcher
         collisionConfiguration = new btDefaultCollisionConfiguration();
@@ -293,6 +297,8 @@ namespace Physic
         int x, int y, float yoffset,
         float triSize, float sqrtVerts)
     {
+        assert(!mLocked);
+
         const std::string name = "HeightField_"
             + boost::lexical_cast<std::string>(x) + "_"
             + boost::lexical_cast<std::string>(y);
@@ -336,6 +342,8 @@ namespace Physic
 
     void PhysicEngine::removeHeightField(int x, int y)
     {
+        assert(!mLocked);
+
         const std::string name = "HeightField_"
             + boost::lexical_cast<std::string>(x) + "_"
             + boost::lexical_cast<std::string>(y);
@@ -352,6 +360,8 @@ namespace Physic
     void PhysicEngine::adjustRigidBody(RigidBody* body, const Ogre::Vector3 &position, const Ogre::Quaternion &rotation,
         const Ogre::Vector3 &scaledBoxTranslation, const Ogre::Quaternion &boxRotation)
     {
+        assert(!mLocked);
+
         btTransform tr;
         Ogre::Quaternion boxrot = rotation * boxRotation;
         Ogre::Vector3 transrot = boxrot * scaledBoxTranslation;
@@ -423,6 +433,8 @@ namespace Physic
 
     void PhysicEngine::addRigidBody(RigidBody* body, bool addToMap, RigidBody* raycastingBody,bool actor)
     {
+        assert(!mLocked);
+
         if(!body && !raycastingBody)
             return; // nothing to do
 
@@ -449,6 +461,8 @@ namespace Physic
 
     void PhysicEngine::removeRigidBody(const std::string &name)
     {
+        assert(!mLocked);
+
         RigidBodyContainer::iterator it = mCollisionObjectMap.find(name);
         if (it != mCollisionObjectMap.end() )
         {
@@ -471,6 +485,8 @@ namespace Physic
 
     void PhysicEngine::deleteRigidBody(const std::string &name)
     {
+        assert(!mLocked);
+
         RigidBodyContainer::iterator it = mCollisionObjectMap.find(name);
         if (it != mCollisionObjectMap.end() )
         {
@@ -622,6 +638,8 @@ namespace Physic
 
     void PhysicEngine::stepSimulation(double deltaT)
     {
+        assert(!mLocked);
+
         // This seems to be needed for character controller objects
         dynamicsWorld->stepSimulation(deltaT,10, 1/60.0);
         if(isDebugCreated)
@@ -633,6 +651,8 @@ namespace Physic
     void PhysicEngine::addCharacter(const std::string &name, const std::string &mesh,
         const Ogre::Vector3 &position, float scale, const Ogre::Quaternion &rotation)
     {
+        assert(!mLocked);
+
         // Remove character with given name, so we don't make memory
         // leak when character would be added twice
         removeCharacter(name);
@@ -646,6 +666,8 @@ namespace Physic
 
     void PhysicEngine::removeCharacter(const std::string &name)
     {
+        assert(!mLocked);
+
         PhysicActorContainer::iterator it = mActorMap.find(name);
         if (it != mActorMap.end() )
         {
@@ -283,6 +283,20 @@ public:
          */
         void stepSimulation(double deltaT);
 
+        /**
+         * While locked, several threads trace through the collision world, so it must not change:
+         * adding, removing, moving or stepping bodies is not allowed (checked by assert).
+         */
+        void setLocked(bool locked)
+        {
+            mLocked = locked;
+        }
+
+        bool isLocked() const
+        {
+            return mLocked;
+        }
+
         /**
          * Empty events lists
          */
@@ -363,6 +377,8 @@ public:
         BtOgre::DebugDrawer* mDebugDrawer;
         bool isDebugCreated;
         bool mDebugActive;
+
+        bool mLocked;
     };
 
 